@@ -1,5 +1,6 @@
 #include "Logger.h"
 
+#include <mclib/util/Chat.h>
 #include <mclib/util/Utility.h>
 
 #include <iostream>
@@ -28,7 +29,7 @@ Logger::~Logger() {
 }
 
 void Logger::HandlePacket(mc::protocol::packets::in::ChatPacket* packet) {
-    std::string message = mc::util::ParseChatNode(packet->GetChatData());
+    std::string message = mc::util::ExtractChatText(packet->GetChatJson());
 
     if (!message.empty())
         std::cout << message << std::endl;
@@ -21,6 +21,7 @@ private:
 public:
     MCLIB_API Banner(BlockEntityType type, Vector3i position) : BlockEntity(type, position) { }
     MCLIB_API bool ImportNBT(nbt::NBT* nbt);
+    MCLIB_API bool ImportNBT(DataBuffer& in);
 
     DyeColor GetBaseColor() const noexcept { return m_Base; }
     const std::vector<Pattern>& GetPattern() const noexcept { return m_Patterns; }
@@ -4,6 +4,7 @@
 #include <mclib/common/AABB.h>
 #include <mclib/common/Types.h>
 #include <mclib/protocol/ProtocolState.h>
+#include <mclib/util/InternedString.h>
 
 #include <unordered_map>
 #include <string>
@@ -14,7 +15,7 @@ namespace block {
 
 class Block {
 protected:
-    std::string m_Name;
+    util::InternedString m_Name;
     u32 m_Data;
     bool m_Solid;
     AABB m_BoundingBox;
@@ -38,7 +39,8 @@ public:
         return m_Data == other.m_Data;
     }
 
-    virtual std::string GetName() const { return m_Name; }
+    virtual const std::string& GetName() const { return m_Name.GetString(); }
+    util::InternedString GetInternedName() const noexcept { return m_Name; }
 
     u32 GetType() const noexcept {
         return m_Data;
@@ -90,7 +92,7 @@ typedef Block* BlockPtr;
 class BlockRegistry {
 private:
     std::unordered_map<u32, BlockPtr> m_Blocks;
-    std::unordered_map<std::string, BlockPtr> m_BlockNames;
+    std::unordered_map<util::InternedString, BlockPtr> m_BlockNames;
 
     BlockRegistry() { }
 public:
@@ -116,10 +118,11 @@ public:
     }
 
     BlockPtr MCLIB_API GetBlock(const std::string& name) const;
+    BlockPtr MCLIB_API GetBlock(util::InternedString name) const;
 
     void RegisterBlock(BlockPtr block) {
         m_Blocks[block->GetType()] = block;
-        m_BlockNames[block->GetName()] = block;
+        m_BlockNames[block->m_Name] = block;
     }
 
     void MCLIB_API RegisterVanillaBlocks(protocol::Version protocolVersion);
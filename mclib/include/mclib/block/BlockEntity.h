@@ -4,6 +4,7 @@
 #include <mclib/mclib.h>
 #include <mclib/common/Vector.h>
 #include <mclib/nbt/NBT.h>
+#include <mclib/nbt/NBTView.h>
 #include <mclib/inventory/Slot.h>
 
 #include <string>
@@ -51,18 +52,32 @@ private:
     BlockEntityType m_Type;
     Vector3i m_Position;
     nbt::NBT m_NBT;
+    // The NBT as it was received. The tree is only built from it when GetNBT is called.
+    nbt::NBTView m_View;
+
+    static std::unique_ptr<BlockEntity> Create(BlockEntityType type, Vector3i position);
 
 protected:
     virtual MCLIB_API bool ImportNBT(nbt::NBT* nbt) { return true; }
+    // Imports from the NBT bytes. Builds the tree and imports from that unless a subclass reads the bytes itself.
+    virtual MCLIB_API bool ImportNBT(DataBuffer& in);
 
 public:
     MCLIB_API BlockEntity(BlockEntityType type, Vector3i position) noexcept;
+    virtual ~BlockEntity() { }
 
     MCLIB_API BlockEntityType GetType() const noexcept { return m_Type; }
     MCLIB_API Vector3i GetPosition() const noexcept { return m_Position; }
-    MCLIB_API nbt::NBT* GetNBT() noexcept { return &m_NBT; }
+    MCLIB_API nbt::NBT* GetNBT();
+    // View of the NBT the block entity was read from. Invalid if it was created from a tree.
+    const nbt::NBTView& GetNBTView() const noexcept { return m_View; }
 
     MCLIB_API static std::unique_ptr<BlockEntity> CreateFromNBT(nbt::NBT* nbt);
+    /**
+     * Reads the NBT at the read offset of in without building a tree for it.
+     * Returns null and consumes the NBT if it doesn't describe a block entity.
+     */
+    MCLIB_API static std::unique_ptr<BlockEntity> CreateFromNBT(DataBuffer& in);
 };
 using BlockEntityPtr = std::shared_ptr<BlockEntity>;
 
@@ -14,6 +14,7 @@ class Chest : public BlockEntity, public InventoryBlock, public Nameable {
 public:
     MCLIB_API Chest(BlockEntityType type, Vector3i position) : BlockEntity(type, position) { }
     MCLIB_API bool ImportNBT(nbt::NBT* nbt);
+    MCLIB_API bool ImportNBT(DataBuffer& in);
 };
 
 } // ns block
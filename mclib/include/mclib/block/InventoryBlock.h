@@ -3,6 +3,7 @@
 
 #include <mclib/inventory/Slot.h>
 #include <mclib/nbt/NBT.h>
+#include <mclib/nbt/NBTReader.h>
 
 #include <string>
 #include <unordered_map>
@@ -23,6 +24,26 @@ private:
     std::wstring m_LootTable;
     s64 m_LootTableSeed;
 
+protected:
+    // Reads the inventory fields from the NBT bytes. Blocks with more fields can extend it.
+    class Importer : public nbt::RootVisitor {
+    private:
+        InventoryBlock& m_Block;
+        inventory::SlotReader m_Items;
+        bool m_HasItems;
+
+    public:
+        Importer(InventoryBlock& block) : m_Block(block), m_HasItems(false) { }
+
+        MCLIB_API NBTVisitor* OnListBegin(const std::string& name, nbt::TagType elementType, s32 size) override;
+        void MCLIB_API OnString(const std::string& name, const std::string& value) override;
+        void MCLIB_API OnInt(const std::string& name, s32 value) override;
+        void MCLIB_API OnLong(const std::string& name, s64 value) override;
+
+        // Adds the items to the block once the NBT is read. Returns false if they are missing or don't have a slot.
+        bool MCLIB_API Finish();
+    };
+
 public:
     MCLIB_API bool ImportNBT(nbt::NBT* nbt);
 
@@ -13,6 +13,7 @@ private:
 public:
     MCLIB_API Sign(BlockEntityType type, Vector3i position) : BlockEntity(type, position) { }
     MCLIB_API bool ImportNBT(nbt::NBT* nbt);
+    MCLIB_API bool ImportNBT(DataBuffer& in);
 
     MCLIB_API const std::wstring& GetText(std::size_t index) const;
 };
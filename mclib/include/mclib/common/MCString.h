@@ -10,18 +10,23 @@ namespace mc {
 
 class DataBuffer;
 
+/**
+ * A protocol string. Stored as UTF-8, which is what is sent over the network, so reading and writing
+ * only copies the bytes. The UTF-16 form is only produced when GetUTF16 is called.
+ * Invalid UTF-8 is replaced with U+FFFD when the string is created or read.
+ */
 class MCString {
 private:
-    std::wstring m_UTF16;
+    std::string m_UTF8;
 
 public:
     MCLIB_API MCString();
-    MCLIB_API MCString(const std::string& str);
+    MCLIB_API MCString(const std::string& utf8);
+    MCLIB_API MCString(std::string&& utf8);
     MCLIB_API MCString(const std::wstring& str);
 
     std::wstring MCLIB_API GetUTF16() const;
-    std::string MCLIB_API GetUTF8() const;
-
+    const std::string& GetUTF8() const noexcept { return m_UTF8; }
 
     static MCString MCLIB_API FromUTF8(const std::string& utf8);
 
@@ -29,8 +34,13 @@ public:
     friend MCLIB_API DataBuffer& operator>>(DataBuffer& in, MCString& str);
 };
 
-MCLIB_API std::string utf16to8(std::wstring str);
-MCLIB_API std::wstring utf8to16(std::string str);
+// Both conversions replace invalid input with U+FFFD. Characters outside of the BMP become surrogate pairs if wchar_t is 16 bits.
+MCLIB_API std::string utf16to8(const std::wstring& str);
+MCLIB_API std::wstring utf8to16(const std::string& str);
+
+MCLIB_API bool IsValidUTF8(const char* data, std::size_t size);
+// Returns str with invalid sequences replaced by U+FFFD.
+MCLIB_API std::string SanitizeUTF8(const std::string& str);
 
 MCLIB_API DataBuffer& operator<<(DataBuffer& out, const MCString& pos);
 MCLIB_API DataBuffer& operator>>(DataBuffer& in, MCString& pos);
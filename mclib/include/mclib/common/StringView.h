@@ -0,0 +1,70 @@
+#ifndef MCLIB_COMMON_STRING_VIEW_H_
+#define MCLIB_COMMON_STRING_VIEW_H_
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string>
+
+namespace mc {
+
+/**
+ * Refers to characters that are owned by something else, like std::string_view.
+ * The characters have to outlive the view.
+ */
+class StringView {
+private:
+    const char* m_Data;
+    std::size_t m_Size;
+
+public:
+    StringView() noexcept : m_Data(""), m_Size(0) { }
+    StringView(const char* data, std::size_t size) noexcept : m_Data(data), m_Size(size) { }
+    StringView(const char* str) noexcept : m_Data(str), m_Size(std::strlen(str)) { }
+    StringView(const std::string& str) noexcept : m_Data(str.data()), m_Size(str.size()) { }
+
+    const char* data() const noexcept { return m_Data; }
+    std::size_t size() const noexcept { return m_Size; }
+    bool empty() const noexcept { return m_Size == 0; }
+
+    const char* begin() const noexcept { return m_Data; }
+    const char* end() const noexcept { return m_Data + m_Size; }
+
+    char operator[](std::size_t i) const noexcept { return m_Data[i]; }
+
+    std::string ToString() const { return std::string(m_Data, m_Size); }
+
+    int Compare(StringView other) const noexcept {
+        int result = m_Size == 0 || other.m_Size == 0 ? 0 : std::memcmp(m_Data, other.m_Data, std::min(m_Size, other.m_Size));
+
+        if (result != 0) return result;
+        if (m_Size == other.m_Size) return 0;
+        return m_Size < other.m_Size ? -1 : 1;
+    }
+
+    bool operator==(StringView other) const noexcept {
+        return m_Size == other.m_Size && (m_Size == 0 || std::memcmp(m_Data, other.m_Data, m_Size) == 0);
+    }
+    bool operator!=(StringView other) const noexcept { return !(*this == other); }
+    bool operator<(StringView other) const noexcept { return Compare(other) < 0; }
+};
+
+} // ns mc
+
+namespace std {
+template <> struct hash<mc::StringView> {
+    std::size_t operator()(mc::StringView str) const noexcept {
+        // FNV-1a
+        std::size_t result = (std::size_t)14695981039346656037ULL;
+
+        for (char c : str) {
+            result ^= (unsigned char)c;
+            result *= (std::size_t)1099511628211ULL;
+        }
+
+        return result;
+    }
+};
+}
+
+#endif
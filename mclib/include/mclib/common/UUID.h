@@ -4,6 +4,7 @@
 #include <mclib/mclib.h>
 #include <mclib/common/Types.h>
 
+#include <functional>
 #include <iosfwd>
 #include <string>
 
@@ -37,6 +38,14 @@ public:
         return false;
     }
 
+    bool operator==(const UUID& r) const {
+        return m_MostSigBits == r.m_MostSigBits && m_LeastSigBits == r.m_LeastSigBits;
+    }
+
+    bool operator!=(const UUID& r) const {
+        return !(*this == r);
+    }
+
     friend MCLIB_API DataBuffer& operator<<(DataBuffer& out, const UUID& uuid);
     friend MCLIB_API DataBuffer& operator>>(DataBuffer& in, UUID& uuid);
 };
@@ -49,4 +58,17 @@ MCLIB_API std::wostream& operator<<(std::wostream& out, const UUID& uuid);
 
 } // ns mc
 
+namespace std {
+
+template <>
+struct hash<mc::UUID> {
+    std::size_t operator()(const mc::UUID& uuid) const {
+        // Version 4 UUIDs are random, so mixing both halves is enough.
+        u64 bits = uuid.GetUpperBits() ^ (uuid.GetLowerBits() * 0x9E3779B97F4A7C15ULL);
+        return std::hash<u64>()(bits);
+    }
+};
+
+} // ns std
+
 #endif
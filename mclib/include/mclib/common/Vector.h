@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <cmath>
+#include <functional>
 #include <limits>
 #include <ostream>
 #include <sstream>
@@ -296,6 +297,19 @@ inline Vector3f ToVector3f(const Vector3d& v) {
     return Vector3f((float)v.x, (float)v.y, (float)v.z);
 }
 
+// Allows vectors to be used as keys in unordered containers
+template <typename T>
+struct Vector3Hash {
+    std::size_t operator()(const Vector3<T>& v) const noexcept {
+        std::hash<T> hasher;
+        std::size_t seed = hasher(v.x);
+
+        seed ^= hasher(v.y) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= hasher(v.z) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+};
+
 
 } // ns mc
 
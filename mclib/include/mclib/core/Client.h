@@ -11,6 +11,7 @@
 #include <mclib/network/Network.h>
 #include <mclib/protocol/packets/PacketDispatcher.h>
 #include <mclib/util/ObserverSubject.h>
+#include <mclib/util/TickScheduler.h>
 #include <mclib/world/World.h>
 #include <thread>
 
@@ -45,10 +46,12 @@ private:
     inventory::Hotbar m_Hotbar;
     std::unique_ptr<util::PlayerController> m_PlayerController;
     world::World m_World;
-    s64 m_LastUpdate;
+    util::TickScheduler m_TickScheduler;
     bool m_Connected;
     std::thread m_UpdateThread;
 
+    void Tick();
+
 public:
     MCLIB_API Client(protocol::packets::PacketDispatcher* dispatcher, protocol::Version version = protocol::Version::Minecraft_1_11_2);
     MCLIB_API ~Client();
@@ -73,6 +76,8 @@ public:
     inventory::Hotbar& GetHotbar() { return m_Hotbar; }
     util::PlayerController* GetPlayerController() { return m_PlayerController.get(); }
     world::World* GetWorld() { return &m_World; }
+    // Ticks every 50 ms. Each client gets its own phase so clients in one process don't tick together.
+    util::TickScheduler& GetTickScheduler() { return m_TickScheduler; }
 
 };
 
@@ -66,6 +66,8 @@ public:
 
     util::Yggdrasil* GetYggdrasil() { return m_Yggdrasil.get(); }
     network::Socket::Status MCLIB_API GetSocketState() const;
+    // Blocks until there is data to receive or the timeout in milliseconds passes.
+    bool MCLIB_API WaitForData(s64 timeout);
     ClientSettings& GetSettings() noexcept { return m_ClientSettings; }
     s32 GetDimension() const noexcept { return m_Dimension; }
     protocol::State GetProtocolState() const { return m_ProtocolState; }
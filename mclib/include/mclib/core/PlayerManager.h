@@ -4,10 +4,12 @@
 #include <mclib/common/UUID.h>
 #include <mclib/entity/EntityManager.h>
 #include <mclib/entity/Player.h>
+#include <mclib/util/InternedString.h>
 #include <mclib/util/ObserverSubject.h>
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 
 // TODO: Add properties, gamemode, and ping
@@ -20,13 +22,19 @@ class PlayerManager;
 class Player {
 private:
     UUID m_UUID;
-    std::wstring m_Name;
+    // Player names are shared by every client in the process.
+    util::InternedString m_Name;
     entity::PlayerEntityPtr m_Entity;
+    // The entity id the PlayerManager indexes this player by. Kept here because the entity can expire before the index is updated.
+    EntityId m_IndexedEntityId;
+    bool m_Indexed;
 
 public:
-    Player(UUID uuid, std::wstring name)
+    Player(UUID uuid, const std::wstring& name)
         : m_UUID(uuid),
-        m_Name(name)
+        m_Name(name),
+        m_IndexedEntityId(0),
+        m_Indexed(false)
     {
 
     }
@@ -35,7 +43,8 @@ public:
 
     void SetEntity(entity::PlayerEntityPtr entity) { m_Entity = entity; }
 
-    const std::wstring& GetName() const { return m_Name; }
+    std::wstring GetName() const { return m_Name.GetUTF16(); }
+    util::InternedString GetInternedName() const noexcept { return m_Name; }
     UUID GetUUID() const { return m_UUID; }
 
     friend class PlayerManager;
@@ -64,14 +73,19 @@ public:
 
 class PlayerManager : public protocol::packets::PacketHandler, public entity::EntityListener, public util::ObserverSubject<PlayerListener> {
 public:
-    typedef std::map<UUID, PlayerPtr> PlayerList;
+    typedef std::unordered_map<UUID, PlayerPtr> PlayerList;
     typedef PlayerList::iterator iterator;
 
 private:
     PlayerList m_Players;
+    // Players by the id of their entity. Updated when player entities spawn and get destroyed.
+    std::unordered_map<EntityId, PlayerPtr> m_EntityPlayers;
     entity::EntityManager* m_EntityManager;
     UUID m_ClientUUID;
 
+    void SetPlayerEntity(const PlayerPtr& player, entity::PlayerEntityPtr entity);
+    void RemoveFromEntityIndex(const PlayerPtr& player);
+
 public:
     MCLIB_API PlayerManager(protocol::packets::PacketDispatcher* dispatcher, entity::EntityManager* entityManager);
     MCLIB_API ~PlayerManager();
@@ -86,11 +100,11 @@ public:
 
     // Gets a player by their UUID. Fast method, just requires map lookup.
     PlayerPtr MCLIB_API GetPlayerByUUID(UUID uuid) const;
-    // Gets a player by their EntityId. Somewhat slow method, has to loop through player map to find the player with that eid.
-    // It should still be pretty fast though since there aren't many players on a server usually.
+    // Gets a player by their EntityId. Fast method, just requires map lookup.
     PlayerPtr MCLIB_API GetPlayerByEntityId(EntityId eid) const;
-    // Gets a player by their username.
+    // Gets a player by their username. Returns null for an empty name.
     PlayerPtr MCLIB_API GetPlayerByName(const std::wstring& name) const;
+    PlayerPtr MCLIB_API GetPlayerByName(util::InternedString name) const;
 
     void MCLIB_API OnPlayerSpawn(entity::PlayerEntityPtr entity, UUID uuid);
     void MCLIB_API OnEntityDestroy(entity::EntityPtr entity);
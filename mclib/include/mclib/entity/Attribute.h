@@ -3,6 +3,7 @@
 
 #include <mclib/common/Types.h>
 #include <mclib/common/UUID.h>
+#include <mclib/util/InternedString.h>
 
 #include <vector>
 #include <string>
@@ -44,11 +45,18 @@ public:
     using Modifiers = std::vector<Modifier>;
 
 private:
-    std::wstring m_Key;
+    util::InternedString m_Key;
     double m_Amount;
     Modifiers m_Modifiers;
 
 public:
+    Attribute(util::InternedString key, double amount)
+        : m_Key(key),
+          m_Amount(amount)
+    {
+
+    }
+
     Attribute(const std::wstring& key, double amount)
         : m_Key(key),
           m_Amount(amount)
@@ -56,7 +64,8 @@ public:
 
     }
 
-    inline const std::wstring& GetKey() const noexcept { return m_Key; }
+    inline std::wstring GetKey() const { return m_Key.GetUTF16(); }
+    inline util::InternedString GetInternedKey() const noexcept { return m_Key; }
     inline double GetBaseAmount() const noexcept { return m_Amount; }
     inline const Modifiers& GetModifiers() const noexcept { return m_Modifiers; }
 
@@ -2,8 +2,10 @@
 #define MCLIB_ENTITY_ENTITY_H_
 
 #include <mclib/common/DataBuffer.h>
+#include <mclib/common/MCString.h>
 #include <mclib/common/Types.h>
 #include <mclib/entity/Attribute.h>
+#include <mclib/entity/EntityStore.h>
 #include <mclib/entity/Metadata.h>
 
 #include <string>
@@ -111,9 +113,13 @@ enum class EntityType {
     Unknown
 };
 
+/**
+ * The position, velocity, rotation, vehicle and type of entities that are tracked by the EntityManager
+ * live in its EntityStore. Entities that aren't in a store, or were removed from one, keep them in the entity itself.
+ */
 class Entity {
 public:
-    using AttributeMap = std::unordered_map<std::wstring, Attribute>;
+    using AttributeMap = std::unordered_map<util::InternedString, Attribute>;
 
 protected:
     AttributeMap m_Attributes;
@@ -126,42 +132,186 @@ protected:
     EntityId m_VehicleId;
     EntityType m_Type;
 
+    EntityStore* m_Store;
+    EntityHandle m_Handle;
+
 public:
-    Entity(EntityId id, protocol::Version protocolVersion) noexcept : m_EntityId(id), m_VehicleId(-1), m_Type(EntityType::Unknown), m_Metadata(protocolVersion) { }
-    virtual ~Entity() { }
+    Entity(EntityId id, protocol::Version protocolVersion) noexcept
+        : m_Metadata(protocolVersion), m_EntityId(id), m_Yaw(0.0f), m_Pitch(0.0f), m_HeadPitch(0.0f), m_VehicleId(-1), m_Type(EntityType::Unknown), m_Store(nullptr)
+    {
+    }
+
+    virtual ~Entity() {
+        if (m_Store)
+            m_Store->Destroy(m_Handle);
+    }
+
+    // Copies aren't part of the store.
+    Entity(const Entity& rhs)
+        : m_Attributes(rhs.m_Attributes),
+          m_Metadata(rhs.m_Metadata),
+          m_Position(rhs.GetPosition()),
+          m_Velocity(rhs.GetVelocity()),
+          m_EntityId(rhs.m_EntityId),
+          m_Yaw(rhs.GetYaw()),
+          m_Pitch(rhs.GetPitch()),
+          m_HeadPitch(rhs.GetHeadPitch()),
+          m_VehicleId(rhs.GetVehicleId()),
+          m_Type(rhs.GetType()),
+          m_Store(nullptr)
+    {
+    }
+
+    Entity& operator=(const Entity& rhs) {
+        if (this == &rhs) return *this;
+
+        m_Attributes = rhs.m_Attributes;
+        m_Metadata = rhs.m_Metadata;
+        m_EntityId = rhs.m_EntityId;
+        SetPosition(rhs.GetPosition());
+        SetVelocity(rhs.GetVelocity());
+        SetYaw(rhs.GetYaw());
+        SetPitch(rhs.GetPitch());
+        SetHeadPitch(rhs.GetHeadPitch());
+        SetVehicleId(rhs.GetVehicleId());
+        SetType(rhs.GetType());
+        return *this;
+    }
+
+    // Moves take over the place of rhs in its store. rhs is left detached.
+    Entity(Entity&& rhs) noexcept
+        : m_Attributes(std::move(rhs.m_Attributes)),
+          m_Metadata(std::move(rhs.m_Metadata)),
+          m_Position(rhs.m_Position),
+          m_Velocity(rhs.m_Velocity),
+          m_EntityId(rhs.m_EntityId),
+          m_Yaw(rhs.m_Yaw),
+          m_Pitch(rhs.m_Pitch),
+          m_HeadPitch(rhs.m_HeadPitch),
+          m_VehicleId(rhs.m_VehicleId),
+          m_Type(rhs.m_Type),
+          m_Store(rhs.m_Store),
+          m_Handle(rhs.m_Handle)
+    {
+        rhs.m_Store = nullptr;
+        rhs.m_Handle = EntityHandle();
+    }
+
+    Entity& operator=(Entity&& rhs) noexcept {
+        if (this == &rhs) return *this;
+
+        if (m_Store)
+            m_Store->Destroy(m_Handle);
+
+        m_Attributes = std::move(rhs.m_Attributes);
+        m_Metadata = std::move(rhs.m_Metadata);
+        m_Position = rhs.m_Position;
+        m_Velocity = rhs.m_Velocity;
+        m_EntityId = rhs.m_EntityId;
+        m_Yaw = rhs.m_Yaw;
+        m_Pitch = rhs.m_Pitch;
+        m_HeadPitch = rhs.m_HeadPitch;
+        m_VehicleId = rhs.m_VehicleId;
+        m_Type = rhs.m_Type;
+        m_Store = rhs.m_Store;
+        m_Handle = rhs.m_Handle;
+
+        rhs.m_Store = nullptr;
+        rhs.m_Handle = EntityHandle();
+        return *this;
+    }
+
+    /**
+     * Moves the fields into the store. Used by the EntityManager.
+     * The store has to outlive the entity or the entity has to be detached first.
+     */
+    void Attach(EntityStore* store, EntityHandle handle) {
+        Detach();
+
+        store->SetPosition(handle, m_Position);
+        store->SetVelocity(handle, m_Velocity);
+        store->SetYaw(handle, m_Yaw);
+        store->SetPitch(handle, m_Pitch);
+        store->SetHeadPitch(handle, m_HeadPitch);
+        store->SetVehicleId(handle, m_VehicleId);
+        store->SetType(handle, m_Type);
+
+        m_Store = store;
+        m_Handle = handle;
+    }
+
+    // Copies the fields back out of the store and removes the entity from it.
+    void Detach() {
+        if (!m_Store) return;
 
-    Entity(const Entity& rhs) = default;
-    Entity& operator=(const Entity& rhs) = default;
-    Entity(Entity&& rhs) = default;
-    Entity& operator=(Entity&& rhs) = default;
+        m_Position = m_Store->GetPosition(m_Handle);
+        m_Velocity = m_Store->GetVelocity(m_Handle);
+        m_Yaw = m_Store->GetYaw(m_Handle);
+        m_Pitch = m_Store->GetPitch(m_Handle);
+        m_HeadPitch = m_Store->GetHeadPitch(m_Handle);
+        m_VehicleId = m_Store->GetVehicleId(m_Handle);
+        m_Type = m_Store->GetType(m_Handle);
+
+        m_Store->Destroy(m_Handle);
+        m_Store = nullptr;
+        m_Handle = EntityHandle();
+    }
+
+    EntityHandle GetHandle() const noexcept { return m_Handle; }
 
     EntityId GetEntityId() const noexcept { return m_EntityId; }
-    EntityId GetVehicleId() const noexcept { return m_VehicleId; }
-    const Vector3d& GetPosition() const noexcept { return m_Position; }
-    const Vector3d& GetVelocity() const noexcept { return m_Velocity; }
-    float GetYaw() const noexcept { return m_Yaw; }
-    float GetPitch() const noexcept { return m_Pitch; }
-    float GetHeadPitch() const noexcept { return m_HeadPitch; }
-    EntityType GetType() const noexcept { return m_Type; }
+    EntityId GetVehicleId() const noexcept { return m_Store ? m_Store->GetVehicleId(m_Handle) : m_VehicleId; }
+    Vector3d GetPosition() const noexcept { return m_Store ? m_Store->GetPosition(m_Handle) : m_Position; }
+    Vector3d GetVelocity() const noexcept { return m_Store ? m_Store->GetVelocity(m_Handle) : m_Velocity; }
+    float GetYaw() const noexcept { return m_Store ? m_Store->GetYaw(m_Handle) : m_Yaw; }
+    float GetPitch() const noexcept { return m_Store ? m_Store->GetPitch(m_Handle) : m_Pitch; }
+    float GetHeadPitch() const noexcept { return m_Store ? m_Store->GetHeadPitch(m_Handle) : m_HeadPitch; }
+    EntityType GetType() const noexcept { return m_Store ? m_Store->GetType(m_Handle) : m_Type; }
     const EntityMetadata& GetMetadata() const noexcept { return m_Metadata; }
     const AttributeMap& GetAttributes() const noexcept { return m_Attributes; }
 
-    Attribute GetAttribute(const std::wstring& key) {
+    Attribute GetAttribute(util::InternedString key) {
         auto iter = m_Attributes.find(key);
         if (iter == m_Attributes.end()) return Attribute(key, 0);
         return iter->second;
     }
 
-    void SetPosition(const Vector3d& pos) noexcept { m_Position = pos; }
-    void SetVelocity(const Vector3d& vel) noexcept { m_Velocity = vel; }
-    void SetYaw(float yaw) noexcept { m_Yaw = yaw; }
-    void SetPitch(float pitch) noexcept { m_Pitch = pitch; }
-    void SetHeadPitch(float pitch) noexcept { m_HeadPitch = pitch; }
-    void SetVehicleId(EntityId vid) noexcept { m_VehicleId = vid; }
-    void SetType(EntityType type) { m_Type = type; }
+    // Doesn't intern the key. A key that was never interned isn't an attribute of any entity.
+    Attribute GetAttribute(const std::wstring& key) {
+        return GetAttribute(util::InternedString::Find(utf16to8(key)));
+    }
+
+    void SetPosition(const Vector3d& pos) noexcept {
+        if (m_Store) m_Store->SetPosition(m_Handle, pos); else m_Position = pos;
+    }
+
+    void SetVelocity(const Vector3d& vel) noexcept {
+        if (m_Store) m_Store->SetVelocity(m_Handle, vel); else m_Velocity = vel;
+    }
+
+    void SetYaw(float yaw) noexcept {
+        if (m_Store) m_Store->SetYaw(m_Handle, yaw); else m_Yaw = yaw;
+    }
+
+    void SetPitch(float pitch) noexcept {
+        if (m_Store) m_Store->SetPitch(m_Handle, pitch); else m_Pitch = pitch;
+    }
+
+    void SetHeadPitch(float pitch) noexcept {
+        if (m_Store) m_Store->SetHeadPitch(m_Handle, pitch); else m_HeadPitch = pitch;
+    }
+
+    void SetVehicleId(EntityId vid) noexcept {
+        if (m_Store) m_Store->SetVehicleId(m_Handle, vid); else m_VehicleId = vid;
+    }
+
+    void SetType(EntityType type) {
+        if (m_Store) m_Store->SetType(m_Handle, type); else m_Type = type;
+    }
+
     void SetMetadata(const EntityMetadata& metadata) { m_Metadata = metadata; }
 
-    void SetAttribute(const std::wstring& key, const Attribute& attrib) { 
+    void SetAttribute(util::InternedString key, const Attribute& attrib) {
         m_Attributes.erase(key);
         m_Attributes.insert(std::make_pair(key, attrib));
     }
@@ -0,0 +1,92 @@
+#ifndef MCLIB_ENTITY_ENTITY_GRID_H_
+#define MCLIB_ENTITY_ENTITY_GRID_H_
+
+#include <mclib/mclib.h>
+#include <mclib/common/AABB.h>
+#include <mclib/common/Types.h>
+#include <mclib/common/Vector.h>
+
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+
+namespace mc {
+namespace entity {
+
+/**
+ * Buckets entity ids by the chunk section that they are in.
+ * Range queries only have to look at the entities in the cells that overlap the range.
+ */
+class EntityGrid {
+public:
+    enum { CellSize = 16 };
+
+    typedef std::unordered_map<Vector3i, std::vector<EntityId>, Vector3Hash<s64>> CellMap;
+
+private:
+    CellMap m_Cells;
+    std::unordered_map<EntityId, Vector3i> m_EntityCells;
+
+public:
+    static Vector3i GetCell(const Vector3d& position) {
+        return Vector3i(
+            (s64)std::floor(position.x / CellSize),
+            (s64)std::floor(position.y / CellSize),
+            (s64)std::floor(position.z / CellSize)
+        );
+    }
+
+    // Adds the entity or moves it to the cell of its new position.
+    void MCLIB_API Insert(EntityId eid, const Vector3d& position);
+    void MCLIB_API Remove(EntityId eid);
+    void MCLIB_API Clear();
+
+    // The entities in a cell or null if the cell is empty.
+    const std::vector<EntityId>* GetEntities(Vector3i cell) const {
+        auto iter = m_Cells.find(cell);
+        if (iter == m_Cells.end()) return nullptr;
+        return &iter->second;
+    }
+
+    // Calls func with the id of every entity in a cell that overlaps bounds.
+    template <typename Func>
+    void ForEachInBounds(const AABB& bounds, Func func) const {
+        Vector3i min = GetCell(bounds.min);
+        Vector3i max = GetCell(bounds.max);
+
+        // Scanning the occupied cells is cheaper than looking up a large range of empty ones.
+        if ((max.x - min.x + 1) * (max.y - min.y + 1) * (max.z - min.z + 1) > (s64)m_Cells.size()) {
+            for (const auto& kv : m_Cells) {
+                const Vector3i& cell = kv.first;
+
+                if (cell.x < min.x || cell.x > max.x || cell.y < min.y || cell.y > max.y || cell.z < min.z || cell.z > max.z)
+                    continue;
+
+                for (EntityId eid : kv.second)
+                    func(eid);
+            }
+            return;
+        }
+
+        for (s64 y = min.y; y <= max.y; ++y) {
+            for (s64 z = min.z; z <= max.z; ++z) {
+                for (s64 x = min.x; x <= max.x; ++x) {
+                    auto iter = m_Cells.find(Vector3i(x, y, z));
+                    if (iter == m_Cells.end()) continue;
+
+                    for (EntityId eid : iter->second)
+                        func(eid);
+                }
+            }
+        }
+    }
+
+    std::size_t GetSize() const { return m_EntityCells.size(); }
+    std::size_t GetCellCount() const { return m_Cells.size(); }
+    const CellMap& GetCells() const { return m_Cells; }
+};
+
+} // ns entity
+} // ns mc
+
+#endif
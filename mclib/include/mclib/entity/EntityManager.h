@@ -3,13 +3,18 @@
 
 #include <mclib/mclib.h>
 #include <mclib/entity/Entity.h>
+#include <mclib/entity/EntityGrid.h>
+#include <mclib/entity/EntityStore.h>
 #include <mclib/entity/Player.h>
 #include <mclib/protocol/packets/Packet.h>
 #include <mclib/protocol/packets/PacketHandler.h>
 #include <mclib/util/ObserverSubject.h>
 
 #include <array>
+#include <functional>
+#include <limits>
 #include <unordered_map>
+#include <vector>
 
 namespace mc {
 namespace entity {
@@ -25,6 +30,8 @@ public:
     virtual void OnEntityMove(EntityPtr entity, Vector3d oldPos, Vector3d newPos) { }
 };
 
+typedef std::function<bool(const EntityPtr&)> EntityFilter;
+
 class EntityManager : public protocol::packets::PacketHandler, public util::ObserverSubject<EntityListener> {
 public:
     using EntityMap = std::unordered_map<EntityId, EntityPtr>;
@@ -33,9 +40,22 @@ public:
 
 private:
     std::unordered_map<EntityId, EntityPtr> m_Entities;
+    // Dense storage of the position, velocity, rotation and type of every tracked entity.
+    EntityStore m_Store;
+    // Spatial index of the entity positions, updated whenever an entity moves.
+    EntityGrid m_Grid;
     // Entity Id for the client player
     EntityId m_EntityId;
+    std::shared_ptr<PlayerEntity> m_PlayerEntity;
     protocol::Version m_ProtocolVersion;
+    bool m_PredictionEnabled;
+    s64 m_MaxExtrapolation;
+
+    // Starts tracking the entity, replacing any entity with the same id.
+    void AddEntity(const EntityPtr& entity);
+    void RemoveEntity(EntityId eid);
+    // Teleports drop the motion history so they aren't interpolated.
+    void MoveEntity(const EntityPtr& entity, const Vector3d& position, bool teleport = false);
 
 public:
     MCLIB_API EntityManager(protocol::packets::PacketDispatcher* dispatcher, protocol::Version protocolVersion);
@@ -47,10 +67,7 @@ public:
     EntityManager& operator=(EntityManager&& rhs) = delete;
 
     std::shared_ptr<PlayerEntity> GetPlayerEntity() const {
-        auto iter = m_Entities.find(m_EntityId);
-        if (iter == m_Entities.end()) return nullptr;
-
-        return std::dynamic_pointer_cast<PlayerEntity>(iter->second);
+        return m_PlayerEntity;
     }
 
     EntityPtr GetEntity(EntityId eid) const {
@@ -59,6 +76,46 @@ public:
         return iter->second;
     }
 
+    /**
+     * Sets the position of an entity without notifying listeners.
+     * Use this instead of Entity::SetPosition so the entity can still be found by the range queries.
+     */
+    void MCLIB_API SetEntityPosition(EntityId eid, const Vector3d& position);
+
+    // The entities within radius of center that pass the filter.
+    std::vector<EntityPtr> MCLIB_API QueryRadius(const Vector3d& center, double radius, const EntityFilter& filter = nullptr) const;
+    // The entities inside of bounds that pass the filter.
+    std::vector<EntityPtr> MCLIB_API QueryAABB(const AABB& bounds, const EntityFilter& filter = nullptr) const;
+    /**
+     * The k closest entities to position that pass the filter, sorted by distance.
+     * The search starts at the cell of position and stops as soon as no closer entity can exist.
+     */
+    std::vector<EntityPtr> MCLIB_API Nearest(const Vector3d& position, std::size_t k, const EntityFilter& filter = nullptr,
+        double maxDistance = std::numeric_limits<double>::max()) const;
+
+    /**
+     * Position of an entity at time, in milliseconds of util::TickScheduler::GetTime.
+     * Positions between the last two updates of the entity are interpolated and later ones are extrapolated
+     * from its velocity for at most the max extrapolation time.
+     * Gives the last known position for entities that aren't tracked. Returns false if there's no entity with the id.
+     */
+    bool MCLIB_API PredictPosition(EntityId eid, s64 time, Vector3d& position) const;
+    // Predicts the positions of all entities at once if prediction is enabled. Called every tick by the client.
+    void MCLIB_API UpdatePredictions(s64 time);
+    /**
+     * The position predicted by the last UpdatePredictions, or the last known position if prediction is disabled.
+     * Returns false and leaves position as it is if there's no entity with the id.
+     */
+    bool MCLIB_API GetPredictedPosition(EntityId eid, Vector3d& position) const;
+
+    void SetPredictionEnabled(bool enabled) { m_PredictionEnabled = enabled; }
+    bool IsPredictionEnabled() const { return m_PredictionEnabled; }
+    void SetMaxExtrapolation(s64 time) { m_MaxExtrapolation = time; }
+    s64 GetMaxExtrapolation() const { return m_MaxExtrapolation; }
+
+    const EntityGrid& GetGrid() const { return m_Grid; }
+    const EntityStore& GetStore() const { return m_Store; }
+
     iterator begin() { return m_Entities.begin(); }
     iterator end() { return m_Entities.end(); }
 
@@ -0,0 +1,139 @@
+#ifndef MCLIB_ENTITY_ENTITY_STORE_H_
+#define MCLIB_ENTITY_ENTITY_STORE_H_
+
+#include <mclib/mclib.h>
+#include <mclib/common/Types.h>
+#include <mclib/common/Vector.h>
+
+#include <vector>
+
+namespace mc {
+namespace entity {
+
+enum class EntityType;
+
+/**
+ * Refers to an entity in an EntityStore.
+ * The generation changes when a slot is reused, so handles to destroyed entities stay invalid.
+ */
+struct EntityHandle {
+    static const u32 InvalidIndex = 0xFFFFFFFF;
+
+    u32 index;
+    u32 generation;
+
+    EntityHandle() noexcept : index(InvalidIndex), generation(0) { }
+    EntityHandle(u32 index, u32 generation) noexcept : index(index), generation(generation) { }
+
+    bool operator==(const EntityHandle& other) const noexcept {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const EntityHandle& other) const noexcept {
+        return !(*this == other);
+    }
+};
+
+/**
+ * Keeps the frequently used entity fields in dense arrays.
+ * Destroying an entity moves the last entity into its place, so the arrays never have holes and
+ * can be iterated directly. Handles stay valid when entities are moved around.
+ * The accessors expect valid handles.
+ */
+class EntityStore {
+private:
+    struct Slot {
+        u32 dense;
+        u32 generation;
+    };
+
+    std::vector<Slot> m_Slots;
+    std::vector<u32> m_FreeSlots;
+
+    // Dense arrays, all of them have one element per entity.
+    std::vector<u32> m_DenseSlots;
+    std::vector<EntityId> m_EntityIds;
+    std::vector<Vector3d> m_Positions;
+    std::vector<Vector3d> m_Velocities;
+    // Stored in radians
+    std::vector<float> m_Yaws;
+    std::vector<float> m_Pitches;
+    std::vector<float> m_HeadPitches;
+    std::vector<EntityId> m_VehicleIds;
+    std::vector<EntityType> m_Types;
+    // Motion history used for predicting positions. Times are in milliseconds.
+    std::vector<s64> m_UpdateTimes;
+    std::vector<Vector3d> m_PreviousPositions;
+    std::vector<s64> m_PreviousUpdateTimes;
+    std::vector<s64> m_VelocityTimes;
+    std::vector<Vector3d> m_PredictedPositions;
+
+public:
+    EntityHandle MCLIB_API Create(EntityId eid);
+    void MCLIB_API Destroy(EntityHandle handle);
+    void MCLIB_API Clear();
+
+    bool IsValid(EntityHandle handle) const noexcept {
+        return handle.index < m_Slots.size() && m_Slots[handle.index].generation == handle.generation;
+    }
+
+    // Index of the entity in the dense arrays. Changes when other entities are destroyed.
+    std::size_t GetIndex(EntityHandle handle) const noexcept { return m_Slots[handle.index].dense; }
+    EntityHandle GetHandle(std::size_t index) const noexcept {
+        u32 slot = m_DenseSlots[index];
+        return EntityHandle(slot, m_Slots[slot].generation);
+    }
+
+    std::size_t GetSize() const noexcept { return m_EntityIds.size(); }
+
+    EntityId GetEntityId(EntityHandle handle) const noexcept { return m_EntityIds[GetIndex(handle)]; }
+    const Vector3d& GetPosition(EntityHandle handle) const noexcept { return m_Positions[GetIndex(handle)]; }
+    const Vector3d& GetVelocity(EntityHandle handle) const noexcept { return m_Velocities[GetIndex(handle)]; }
+    float GetYaw(EntityHandle handle) const noexcept { return m_Yaws[GetIndex(handle)]; }
+    float GetPitch(EntityHandle handle) const noexcept { return m_Pitches[GetIndex(handle)]; }
+    float GetHeadPitch(EntityHandle handle) const noexcept { return m_HeadPitches[GetIndex(handle)]; }
+    EntityId GetVehicleId(EntityHandle handle) const noexcept { return m_VehicleIds[GetIndex(handle)]; }
+    EntityType GetType(EntityHandle handle) const noexcept { return m_Types[GetIndex(handle)]; }
+
+    void SetPosition(EntityHandle handle, const Vector3d& position) noexcept { m_Positions[GetIndex(handle)] = position; }
+    void SetVelocity(EntityHandle handle, const Vector3d& velocity) noexcept { m_Velocities[GetIndex(handle)] = velocity; }
+    void SetYaw(EntityHandle handle, float yaw) noexcept { m_Yaws[GetIndex(handle)] = yaw; }
+    void SetPitch(EntityHandle handle, float pitch) noexcept { m_Pitches[GetIndex(handle)] = pitch; }
+    void SetHeadPitch(EntityHandle handle, float pitch) noexcept { m_HeadPitches[GetIndex(handle)] = pitch; }
+    void SetVehicleId(EntityHandle handle, EntityId vid) noexcept { m_VehicleIds[GetIndex(handle)] = vid; }
+    void SetType(EntityHandle handle, EntityType type) noexcept { m_Types[GetIndex(handle)] = type; }
+
+    s64 GetUpdateTime(EntityHandle handle) const noexcept { return m_UpdateTimes[GetIndex(handle)]; }
+    s64 GetVelocityTime(EntityHandle handle) const noexcept { return m_VelocityTimes[GetIndex(handle)]; }
+    const Vector3d& GetPredictedPosition(EntityHandle handle) const noexcept { return m_PredictedPositions[GetIndex(handle)]; }
+
+    // Sets the position and keeps the previous one with its time for prediction.
+    void MCLIB_API RecordPosition(EntityHandle handle, const Vector3d& position, s64 time) noexcept;
+    // Sets the position and forgets the previous one, such as after a spawn or a teleport.
+    void MCLIB_API ResetPosition(EntityHandle handle, const Vector3d& position, s64 time) noexcept;
+    void SetVelocityTime(EntityHandle handle, s64 time) noexcept { m_VelocityTimes[GetIndex(handle)] = time; }
+
+    /**
+     * Position at time predicted from the motion history of the entity.
+     * Times between the last two updates are interpolated, later times are extrapolated for at most maxExtrapolation.
+     * Extrapolation uses the velocity sent by the server if it arrived after the last position update,
+     * otherwise the velocity observed between the last two updates.
+     */
+    Vector3d MCLIB_API PredictPosition(std::size_t index, s64 time, s64 maxExtrapolation) const noexcept;
+    // Predicts the position of every entity at time, read them back with GetPredictedPosition.
+    void MCLIB_API UpdatePredictions(s64 time, s64 maxExtrapolation) noexcept;
+
+    const std::vector<EntityId>& GetEntityIds() const noexcept { return m_EntityIds; }
+    const std::vector<Vector3d>& GetPositions() const noexcept { return m_Positions; }
+    const std::vector<Vector3d>& GetVelocities() const noexcept { return m_Velocities; }
+    const std::vector<float>& GetYaws() const noexcept { return m_Yaws; }
+    const std::vector<float>& GetPitches() const noexcept { return m_Pitches; }
+    const std::vector<EntityId>& GetVehicleIds() const noexcept { return m_VehicleIds; }
+    const std::vector<EntityType>& GetTypes() const noexcept { return m_Types; }
+    const std::vector<Vector3d>& GetPredictedPositions() const noexcept { return m_PredictedPositions; }
+};
+
+} // ns entity
+} // ns mc
+
+#endif
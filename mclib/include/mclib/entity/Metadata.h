@@ -7,8 +7,9 @@
 #include <mclib/common/Types.h>
 #include <mclib/protocol/ProtocolState.h>
 
-#include <array>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace mc {
 
@@ -16,6 +17,10 @@ class DataBuffer;
 
 namespace entity {
 
+/**
+ * Keeps the raw metadata of an entity and only decodes the fields that are read.
+ * Most metadata is never looked at, so parsing a packet only has to find where each field starts.
+ */
 class EntityMetadata {
 public:
     class Type {
@@ -102,11 +107,30 @@ public:
 private:
     enum DataType { Byte, VarInt, Float, String, Chat, OptChat, Slot, Boolean, Rotation, Position, OptPosition, Direction, OptUUID, OptBlockID, NBT, Particle, None };
 
-    enum { MetadataCount = 0xFE };
-    std::array<std::pair<std::unique_ptr<Type>, DataType>, MetadataCount> m_Metadata;
+    // A field that was present in the metadata. The value is decoded from the raw data when it is first read.
+    struct Field {
+        u8 index;
+        DataType type;
+        u32 offset;
+        u32 size;
+        mutable std::unique_ptr<Type> value;
+
+        Field(u8 index, DataType type, u32 offset, u32 size) : index(index), type(type), offset(offset), size(size) { }
+    };
+
+    // Sorted by index
+    std::vector<Field> m_Fields;
+    // The encoded values of all of the fields
+    std::string m_Data;
     protocol::Version m_ProtocolVersion;
 
+    static void SkipValue(DataBuffer& in, DataType type, protocol::Version protocolVersion);
+    static std::unique_ptr<Type> DecodeValue(DataBuffer& in, DataType type, protocol::Version protocolVersion);
+
     void CopyOther(const EntityMetadata& other);
+    const Field* GetField(std::size_t index) const;
+    MCLIB_API const Type* Decode(std::size_t index) const;
+
 public:
     MCLIB_API EntityMetadata(protocol::Version protocolVersion);
 
@@ -115,11 +139,15 @@ public:
     MCLIB_API EntityMetadata(EntityMetadata&& rhs) = default;
     MCLIB_API EntityMetadata& operator=(EntityMetadata&& rhs) = default;
 
+    // Decodes the field on first access. Returns null if the field isn't present or isn't a T.
     template <typename T>
-    T* GetIndex(std::size_t index) const {
-        return dynamic_cast<T*>(m_Metadata[index].first.get());
+    const T* GetIndex(std::size_t index) const {
+        return dynamic_cast<const T*>(Decode(index));
     }
 
+    bool HasIndex(std::size_t index) const { return GetField(index) != nullptr; }
+    std::size_t GetFieldCount() const { return m_Fields.size(); }
+
     void MCLIB_API SetProtocolVersion(protocol::Version version) { m_ProtocolVersion = version; }
 
     friend MCLIB_API DataBuffer& operator<<(DataBuffer& out, const EntityMetadata& metadata);
@@ -5,7 +5,10 @@
 #include <mclib/inventory/Slot.h>
 #include <mclib/protocol/packets/PacketHandler.h>
 
+#include <deque>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 namespace mc {
 namespace inventory {
@@ -14,33 +17,88 @@ class Inventory {
 public:
     static const MCLIB_API s32 HOTBAR_SLOT_START;
     static const MCLIB_API s32 PLAYER_INVENTORY_ID;
+    // Crafting, armor, main inventory, hotbar and offhand slots of the player's window.
+    static const MCLIB_API s32 PLAYER_INVENTORY_SIZE;
+    // The main inventory and hotbar that follow the slots of every other window.
+    static const MCLIB_API s32 PLAYER_SLOT_COUNT;
 
-    using ItemMap = std::map<s32, Slot>;
+    // Indexed by slot. Empty slots have an item id of -1.
+    using ItemList = std::vector<Slot>;
 
 private:
-    ItemMap m_Items;
+    // Where the items with the same id are and how many there are in total.
+    struct ItemIndex {
+        // Sorted slot indices
+        std::vector<s32> slots;
+        s32 count;
+    };
+
+    struct Transaction {
+        s16 action;
+        s32 index;
+        // The slot and cursor before the click, restored if the server rejects it.
+        Slot slot;
+        Slot cursor;
+    };
+
+    ItemList m_Items;
+    // Kept up to date by SetSlot, so queries don't have to look at every slot.
+    std::unordered_map<s32, ItemIndex> m_Index;
+    // Clicks that were sent but not confirmed yet, oldest first.
+    std::deque<Transaction> m_Pending;
     int m_WindowId;
     s16 m_CurrentAction;
-    Slot m_Cursor;
+    // The item held by the mouse. The InventoryManager shares one cursor between all of its windows.
+    std::shared_ptr<Slot> m_Cursor;
 
     MCLIB_API void HandleTransaction(core::Connection& conn, u16 action, bool accepted);
+    void PredictClick(s32 index);
+
+    void SetSlot(s32 index, const Slot& slot);
+    void Resize(s32 size);
+    void AddToIndex(s32 index, const Slot& slot);
+    void RemoveFromIndex(s32 index, const Slot& slot);
 
 public:
+    // The player's inventory gets all of its slots, other windows grow as slots are set.
     MCLIB_API Inventory(int windowId);
+    MCLIB_API Inventory(int windowId, s32 size);
 
     MCLIB_API Slot GetItem(s32 index) const;
-    MCLIB_API const ItemMap& GetItems() const noexcept { return m_Items; }
+    MCLIB_API const ItemList& GetItems() const noexcept { return m_Items; }
 
-    const Slot& GetCursorItem() const { return m_Cursor; }
+    const Slot& GetCursorItem() const { return *m_Cursor; }
 
     // Returns item slot index. Returns -1 if none are found.
     MCLIB_API s32 FindItemById(s32 itemId) const;
+    // Returns the sorted indices of every slot with the item.
+    MCLIB_API const std::vector<s32>& FindItemsById(s32 itemId) const;
+    // Returns the number of items with the id across all slots.
+    MCLIB_API s32 GetItemCount(s32 itemId) const;
 
     MCLIB_API bool Contains(s32 itemId) const;
     MCLIB_API bool Contains(Slot item) const;
     MCLIB_API bool ContainsAtLeast(s32 itemId, s32 amount) const;
     MCLIB_API bool ContainsAtLeast(Slot item, s32 amount) const;
 
+    /**
+     * Max stack sizes of items, shared by every inventory. Set them before clients start clicking.
+     * The size is 0 for items whose max stack isn't known.
+     */
+    static MCLIB_API void SetMaxStackSize(s32 itemId, s32 size);
+    static MCLIB_API s32 GetMaxStackSize(s32 itemId);
+
+    /**
+     * Left clicks a slot without waiting for earlier clicks to be confirmed.
+     * The result of the click is applied to the slots and cursor right away, so further clicks can be sent based on it.
+     * Placing items onto the same item is only predicted if its max stack size is known. Otherwise the slot and cursor
+     * are left as they are until the server sends them.
+     * If the server rejects a click, it's rolled back along with the clicks that were sent after it.
+     * Returns false if the slot isn't in the window.
+     */
+    MCLIB_API bool Click(core::Connection& conn, s32 index);
+    bool HasPendingClicks() const noexcept { return !m_Pending.empty(); }
+
     // Moves an item to the cursor. It will fail if something is already on cursor or if target slot is empty.
     MCLIB_API bool PickUp(core::Connection& conn, s32 index);
     // Place the current cursor item into a slot. 
@@ -54,7 +112,11 @@ class InventoryManager : public protocol::packets::PacketHandler {
 private:
     core::Connection* m_Connection;
     std::map<s32, std::unique_ptr<Inventory>> m_Inventories;
+    // The player only has one cursor, whichever window is open.
+    std::shared_ptr<Slot> m_Cursor;
 
+    Inventory* GetOrCreateInventory(s32 windowId);
+    void AddInventory(std::unique_ptr<Inventory> inventory);
     void SetSlot(s32 windowId, s32 slotIndex, const Slot& slot);
 
 public:
@@ -67,7 +129,10 @@ public:
     MCLIB_API void HandlePacket(protocol::packets::in::ConfirmTransactionPacket* packet);
 
     MCLIB_API Inventory* GetInventory(s32 windowId);
+    // Clicks the slots of a window in order without waiting for the server in between. Returns the number of clicks that were sent.
+    MCLIB_API std::size_t Click(s32 windowId, const std::vector<s32>& slots);
     MCLIB_API Inventory* GetPlayerInventory();
+    const Slot& GetCursorItem() const { return *m_Cursor; }
 };
 
 } // ns inventory
@@ -4,6 +4,8 @@
 #include <mclib/mclib.h>
 #include <mclib/common/Types.h>
 #include <mclib/nbt/NBT.h>
+#include <mclib/nbt/NBTDocument.h>
+#include <mclib/nbt/NBTReader.h>
 #include <mclib/protocol/ProtocolState.h>
 
 namespace mc {
@@ -14,19 +16,29 @@ namespace inventory {
 
 class Slot {
 private:
-    nbt::NBT m_NBT;
+    // Shared by copies of the slot. The tree is built from the document the first time that GetNBT is called.
+    mutable std::shared_ptr<const nbt::NBT> m_NBT;
+    // The NBT as it was read. Shared by copies of the slot.
+    std::shared_ptr<const nbt::NBTDocument> m_Document;
     s32 m_ItemId;
     s16 m_ItemDamage;
     u8 m_ItemCount;
 
 public:
-    Slot() noexcept : m_ItemId(-1), m_ItemCount(0), m_ItemDamage(0) { }
+    Slot() noexcept : m_ItemId(-1), m_ItemDamage(0), m_ItemCount(0) { }
     Slot(s32 itemId, u8 itemCount, s16 itemDamage) noexcept
-        : m_ItemId(itemId), m_ItemCount(itemCount), m_ItemDamage(itemDamage), m_NBT()
+        : m_ItemId(itemId), m_ItemDamage(itemDamage), m_ItemCount(itemCount)
     { }
 
-    Slot(s32 itemId, u8 itemCount, s16 itemDamage, nbt::NBT nbt) noexcept
-        : m_ItemId(itemId), m_ItemCount(itemCount), m_ItemDamage(itemDamage), m_NBT(nbt)
+    Slot(s32 itemId, u8 itemCount, s16 itemDamage, nbt::NBT nbt)
+        : m_ItemId(itemId), m_ItemDamage(itemDamage), m_ItemCount(itemCount)
+    {
+        if (nbt.HasData())
+            m_NBT = std::make_shared<const nbt::NBT>(std::move(nbt));
+    }
+
+    Slot(s32 itemId, u8 itemCount, s16 itemDamage, std::shared_ptr<const nbt::NBTDocument> document) noexcept
+        : m_Document(std::move(document)), m_ItemId(itemId), m_ItemDamage(itemDamage), m_ItemCount(itemCount)
     { }
 
     Slot(const Slot& rhs) = default;
@@ -37,7 +49,10 @@ public:
     s32 GetItemId() const noexcept { return m_ItemId; }
     u8 GetItemCount() const noexcept { return m_ItemCount; }
     s16 GetItemDamage() const noexcept { return m_ItemDamage; }
-    const nbt::NBT& GetNBT() const noexcept { return m_NBT; }
+    MCLIB_API const nbt::NBT& GetNBT() const;
+    bool HasNBT() const noexcept { return m_NBT || m_Document; }
+    // The NBT as it was read, or null if the slot was created from a tree or has no NBT.
+    const nbt::NBTDocument* GetNBTDocument() const noexcept { return m_Document.get(); }
 
     static MCLIB_API Slot FromNBT(nbt::TagCompound& compound);
 
@@ -45,6 +60,44 @@ public:
     void Deserialize(DataBuffer& in, protocol::Version version);
 };
 
+/**
+ * Collects items from NBT item compounds, such as the Items list of a chest, without building a tree for them.
+ * Return it from NBTVisitor::OnListBegin for a list of items, or return BeginItem() from
+ * NBTVisitor::OnCompoundBegin for a single item. Only the tag compound of an item is kept, as an NBTDocument.
+ */
+class SlotReader : public nbt::NBTVisitor {
+public:
+    struct Item {
+        // The value of the Slot tag or -1 if the item doesn't have one.
+        s32 index;
+        Slot slot;
+    };
+
+private:
+    std::vector<Item> m_Items;
+    std::shared_ptr<nbt::NBTDocument> m_Tag;
+    std::unique_ptr<nbt::NBTDocumentBuilder> m_TagBuilder;
+    bool m_InItem;
+    s32 m_Index;
+    s16 m_Id;
+    s16 m_Damage;
+    u8 m_Count;
+
+public:
+    SlotReader() : m_InItem(false), m_Index(-1), m_Id(-1), m_Damage(0), m_Count(0) { }
+
+    const std::vector<Item>& GetItems() const noexcept { return m_Items; }
+
+    nbt::NBTVisitor* BeginItem() { m_InItem = true; return this; }
+
+    MCLIB_API nbt::NBTVisitor* OnCompoundBegin(const std::string& name) override;
+    void MCLIB_API OnCompoundEnd() override;
+    nbt::NBTVisitor* OnListBegin(const std::string& /*name*/, nbt::TagType /*elementType*/, s32 /*size*/) override { return nullptr; }
+
+    void MCLIB_API OnByte(const std::string& name, u8 value) override;
+    void MCLIB_API OnShort(const std::string& name, s16 value) override;
+};
+
 
 } // ns inventory
 } // ns mc
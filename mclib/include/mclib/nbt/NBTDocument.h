@@ -0,0 +1,165 @@
+#ifndef MCLIB_NBT_NBT_DOCUMENT_H_
+#define MCLIB_NBT_NBT_DOCUMENT_H_
+
+#include <mclib/mclib.h>
+#include <mclib/common/StringView.h>
+#include <mclib/common/Types.h>
+#include <mclib/nbt/NBTReader.h>
+#include <mclib/nbt/Tag.h>
+#include <mclib/util/Arena.h>
+
+#include <string>
+#include <vector>
+
+namespace mc {
+
+class DataBuffer;
+
+namespace nbt {
+
+class NBT;
+
+/**
+ * A tree of tags that all live in the arena of the document, so destroying it frees a few blocks
+ * instead of every tag on its own. Names are interned UTF-8, each distinct name is stored once.
+ * The tree can't be changed after it was read.
+ */
+class NBTDocument {
+public:
+    class Node {
+    private:
+        TagType m_Type;
+        // The type of the elements of a list.
+        TagType m_ElementType;
+        // Number of children or array elements.
+        u32 m_Size;
+        StringView m_Name;
+
+        union {
+            s64 m_Integer;
+            double m_Floating;
+            const char* m_Bytes;
+            const s32* m_Ints;
+            const Node* m_Children;
+        };
+
+        friend class NBTDocument;
+        friend class NBTDocumentBuilder;
+
+    public:
+        TagType GetType() const noexcept { return m_Type; }
+        StringView GetName() const noexcept { return m_Name; }
+
+        u8 GetByte() const noexcept { return m_Type == TagType::Byte ? (u8)m_Integer : 0; }
+        s16 GetShort() const noexcept { return m_Type == TagType::Short ? (s16)m_Integer : 0; }
+        s32 GetInt() const noexcept { return m_Type == TagType::Int ? (s32)m_Integer : 0; }
+        s64 GetLong() const noexcept { return m_Type == TagType::Long ? m_Integer : 0; }
+        float GetFloat() const noexcept { return m_Type == TagType::Float ? (float)m_Floating : 0.0f; }
+        double GetDouble() const noexcept { return m_Type == TagType::Double ? m_Floating : 0.0; }
+        StringView GetString() const noexcept { return m_Type == TagType::String ? StringView(m_Bytes, m_Size) : StringView(); }
+        StringView GetByteArray() const noexcept { return m_Type == TagType::ByteArray ? StringView(m_Bytes, m_Size) : StringView(); }
+        // The values of an int array, GetSize of them.
+        const s32* GetIntArray() const noexcept { return m_Type == TagType::IntArray ? m_Ints : nullptr; }
+
+        // Number of children of a compound, elements of a list or values of an array.
+        std::size_t GetSize() const noexcept { return m_Size; }
+        TagType GetElementType() const noexcept { return m_ElementType; }
+
+        // Children of a compound or list in the order they were read.
+        const Node* begin() const noexcept { return IsContainer() ? m_Children : nullptr; }
+        const Node* end() const noexcept { return IsContainer() ? m_Children + m_Size : nullptr; }
+
+        const Node* operator[](std::size_t index) const noexcept {
+            return IsContainer() && index < m_Size ? m_Children + index : nullptr;
+        }
+
+        // Child of a compound or null.
+        MCLIB_API const Node* Find(StringView name) const noexcept;
+        const Node* operator[](const char* name) const noexcept { return Find(name); }
+
+        bool IsContainer() const noexcept { return m_Type == TagType::Compound || m_Type == TagType::List; }
+    };
+
+private:
+    util::Arena m_Arena;
+    const Node* m_Root;
+    // Open addressing table of the interned names, its size is a power of two.
+    std::vector<StringView> m_Names;
+    std::size_t m_NameCount;
+
+    StringView Intern(StringView name);
+    void WritePayload(DataBuffer& out, const Node& node) const;
+
+    friend class NBTDocumentBuilder;
+
+public:
+    MCLIB_API NBTDocument();
+
+    NBTDocument(const NBTDocument& other) = delete;
+    NBTDocument& operator=(const NBTDocument& other) = delete;
+    MCLIB_API NBTDocument(NBTDocument&& other) noexcept;
+    MCLIB_API NBTDocument& operator=(NBTDocument&& other) noexcept;
+
+    /**
+     * Reads the NBT at the read offset of in, replacing the current tree.
+     * Returns false if there is no NBT data, which is sent as a single end tag.
+     * Throws std::runtime_error on unknown tag types.
+     */
+    bool MCLIB_API Read(DataBuffer& in);
+    void MCLIB_API Write(DataBuffer& out) const;
+
+    // The root compound or null if nothing was read.
+    const Node* GetRoot() const noexcept { return m_Root; }
+    bool HasData() const noexcept { return m_Root != nullptr && m_Root->GetSize() > 0; }
+
+    // Builds a tag tree from the document.
+    MCLIB_API NBT ToNBT() const;
+
+    std::size_t GetMemoryUsage() const noexcept { return m_Arena.GetCapacity() + m_Names.capacity() * sizeof(StringView); }
+};
+
+/**
+ * Builds an NBTDocument from the tags it visits, like NBTTreeBuilder does for a tag tree.
+ * The compound that it is returned for becomes the root of the document.
+ */
+class NBTDocumentBuilder : public NBTVisitor {
+private:
+    struct Frame {
+        NBTDocument::Node node;
+        std::vector<NBTDocument::Node> children;
+    };
+
+    NBTDocument& m_Document;
+    // The compounds and lists that are being read. Frames are reused so their children keep their capacity.
+    std::vector<Frame> m_Frames;
+    std::size_t m_Depth;
+
+    NBTDocument::Node& Add(TagType type, const std::string& name);
+    void Begin(TagType type, TagType elementType, const std::string& name);
+    void End();
+
+public:
+    MCLIB_API NBTDocumentBuilder(NBTDocument& document);
+
+    bool IsFinished() const noexcept { return m_Depth == 0 && m_Document.m_Root != nullptr; }
+
+    MCLIB_API NBTVisitor* OnCompoundBegin(const std::string& name) override;
+    void MCLIB_API OnCompoundEnd() override;
+    MCLIB_API NBTVisitor* OnListBegin(const std::string& name, TagType elementType, s32 size) override;
+    void MCLIB_API OnListEnd() override;
+
+    void MCLIB_API OnByte(const std::string& name, u8 value) override;
+    void MCLIB_API OnShort(const std::string& name, s16 value) override;
+    void MCLIB_API OnInt(const std::string& name, s32 value) override;
+    void MCLIB_API OnLong(const std::string& name, s64 value) override;
+    void MCLIB_API OnFloat(const std::string& name, float value) override;
+    void MCLIB_API OnDouble(const std::string& name, double value) override;
+    void MCLIB_API OnByteArray(const std::string& name, const std::string& value) override;
+    void MCLIB_API OnString(const std::string& name, const std::string& value) override;
+    void MCLIB_API OnIntArray(const std::string& name, const std::vector<s32>& value) override;
+};
+
+} // ns nbt
+} // ns mc
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef MCLIB_NBT_NBT_FILE_H_
+#define MCLIB_NBT_NBT_FILE_H_
+
+#include <mclib/mclib.h>
+#include <mclib/common/Types.h>
+#include <mclib/nbt/NBTReader.h>
+#include <mclib/util/Stream.h>
+
+#include <string>
+#include <vector>
+
+namespace mc {
+namespace nbt {
+
+class NBT;
+
+/**
+ * Writes the tags it visits to a stream, so an NBT can be written tag by tag without building it first.
+ * Passing it to NBTReader::Read copies an NBT, such as from a compressed file into an uncompressed one.
+ * Flush has to be called after the last tag.
+ */
+class NBTWriter : public NBTVisitor {
+private:
+    util::OutputStream& m_Out;
+    std::vector<u8> m_Buffer;
+    std::size_t m_BufferSize;
+    // Whether each of the compounds and lists that are being written is a list.
+    std::vector<bool> m_InList;
+
+    void WriteBytes(const void* data, std::size_t size);
+    void WriteHeader(TagType type, const std::string& name);
+
+    template <typename T>
+    void WriteValue(T value);
+
+public:
+    MCLIB_API NBTWriter(util::OutputStream& out, std::size_t bufferSize = 64 * 1024);
+
+    // Writes the buffered bytes to the stream and flushes it.
+    void MCLIB_API Flush();
+
+    MCLIB_API NBTVisitor* OnCompoundBegin(const std::string& name) override;
+    void MCLIB_API OnCompoundEnd() override;
+    MCLIB_API NBTVisitor* OnListBegin(const std::string& name, TagType elementType, s32 size) override;
+    void MCLIB_API OnListEnd() override;
+
+    void MCLIB_API OnByte(const std::string& name, u8 value) override;
+    void MCLIB_API OnShort(const std::string& name, s16 value) override;
+    void MCLIB_API OnInt(const std::string& name, s32 value) override;
+    void MCLIB_API OnLong(const std::string& name, s64 value) override;
+    void MCLIB_API OnFloat(const std::string& name, float value) override;
+    void MCLIB_API OnDouble(const std::string& name, double value) override;
+    void MCLIB_API OnByteArray(const std::string& name, const std::string& value) override;
+    void MCLIB_API OnString(const std::string& name, const std::string& value) override;
+    void MCLIB_API OnIntArray(const std::string& name, const std::vector<s32>& value) override;
+};
+
+/**
+ * Reads an NBT file, such as level.dat, player data or a structure, into a visitor.
+ * Gzip and zlib files are inflated in chunks as they are parsed, so they are never in memory as a whole.
+ * Uncompressed files are mapped into memory if mapFile is set, otherwise they are read in chunks too.
+ * Returns false if the file doesn't contain an NBT. Throws std::runtime_error if the file can't be read or is malformed.
+ */
+MCLIB_API bool ReadNBTFile(const std::string& path, NBTVisitor& visitor, bool mapFile = true);
+MCLIB_API bool ReadNBTFile(const std::string& path, NBT& nbt, bool mapFile = true);
+
+// Writes an NBT file. Minecraft uses gzip for its NBT files. Throws std::runtime_error if the file can't be written.
+MCLIB_API void WriteNBTFile(const std::string& path, const NBT& nbt, util::Compression compression = util::Compression::Gzip);
+
+} // ns nbt
+} // ns mc
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef MCLIB_NBT_NBT_READER_H_
+#define MCLIB_NBT_NBT_READER_H_
+
+#include <mclib/mclib.h>
+#include <mclib/common/Types.h>
+#include <mclib/nbt/Tag.h>
+#include <mclib/util/Stream.h>
+
+#include <string>
+#include <vector>
+
+namespace mc {
+
+class DataBuffer;
+
+namespace nbt {
+
+/**
+ * Receives the tags of an NBT as they are read. Names and strings are UTF-8 and only valid during the call.
+ * List elements have empty names.
+ */
+class NBTVisitor {
+public:
+    virtual ~NBTVisitor() { }
+
+    // Returns the visitor for the tags inside of the compound: this, another visitor or null to skip the compound.
+    virtual NBTVisitor* OnCompoundBegin(const std::string& /*name*/) { return this; }
+    // Called on the visitor that was returned by OnCompoundBegin.
+    virtual void OnCompoundEnd() { }
+    // Returns the visitor for the elements of the list, like OnCompoundBegin.
+    virtual NBTVisitor* OnListBegin(const std::string& /*name*/, TagType /*elementType*/, s32 /*size*/) { return this; }
+    virtual void OnListEnd() { }
+
+    virtual void OnByte(const std::string& /*name*/, u8 /*value*/) { }
+    virtual void OnShort(const std::string& /*name*/, s16 /*value*/) { }
+    virtual void OnInt(const std::string& /*name*/, s32 /*value*/) { }
+    virtual void OnLong(const std::string& /*name*/, s64 /*value*/) { }
+    virtual void OnFloat(const std::string& /*name*/, float /*value*/) { }
+    virtual void OnDouble(const std::string& /*name*/, double /*value*/) { }
+    virtual void OnByteArray(const std::string& /*name*/, const std::string& /*value*/) { }
+    virtual void OnString(const std::string& /*name*/, const std::string& /*value*/) { }
+    virtual void OnIntArray(const std::string& /*name*/, const std::vector<s32>& /*value*/) { }
+};
+
+// Only visits the tags directly inside of the root compound. Nested compounds and lists are skipped unless a subclass handles them.
+class RootVisitor : public NBTVisitor {
+private:
+    bool m_InRoot;
+
+public:
+    RootVisitor() : m_InRoot(false) { }
+
+    NBTVisitor* OnCompoundBegin(const std::string& /*name*/) override {
+        if (m_InRoot) return nullptr;
+
+        m_InRoot = true;
+        return this;
+    }
+
+    NBTVisitor* OnListBegin(const std::string& /*name*/, TagType /*elementType*/, s32 /*size*/) override { return nullptr; }
+};
+
+/**
+ * Walks the bytes of an NBT and reports every tag to a visitor without building a tree.
+ * Skipped compounds and lists are stepped over without decoding their values.
+ * Reads from a DataBuffer, from memory such as a mapped file, or from a stream that is read in chunks.
+ */
+class NBTReader {
+private:
+    DataBuffer* m_Buffer;
+    const u8* m_Data;
+    std::size_t m_Size;
+    std::size_t m_Offset;
+    util::InputStream* m_Stream;
+    // Holds the bytes that were read from the stream. m_Offset and m_Size are the parsed and read ends.
+    std::vector<u8> m_StreamBuffer;
+
+    template <typename Func>
+    bool Parse(Func func);
+
+public:
+    MCLIB_API NBTReader(DataBuffer& in);
+    MCLIB_API NBTReader(const u8* data, std::size_t size);
+    // Reads ahead in the stream, so it shouldn't be read from directly while the reader is used.
+    MCLIB_API NBTReader(util::InputStream& in, std::size_t bufferSize = 64 * 1024);
+
+    /**
+     * Reads the named root tag at the read offset.
+     * Returns false if there is no NBT data, which is sent as a single end tag.
+     * Throws std::runtime_error on unknown tag types and if the data ends early.
+     */
+    bool MCLIB_API Read(NBTVisitor& visitor);
+    // Moves the read offset past the NBT. Returns false if there is no NBT data.
+    bool MCLIB_API Skip();
+
+    // Offset after the last NBT that was read from memory.
+    std::size_t GetOffset() const noexcept { return m_Offset; }
+};
+
+// Builds a TagCompound from the tags it visits. Used to keep parts of an NBT that are needed as a tree.
+class NBTTreeBuilder : public NBTVisitor {
+private:
+    TagCompound m_Root;
+    // The compounds and lists that are being read. The first one is the root.
+    std::vector<Tag*> m_Stack;
+
+    void Add(TagType type, TagPtr tag);
+
+public:
+    TagCompound& GetRoot() { return m_Root; }
+    bool MCLIB_API IsFinished() const { return m_Stack.empty(); }
+
+    MCLIB_API NBTVisitor* OnCompoundBegin(const std::string& name) override;
+    void MCLIB_API OnCompoundEnd() override;
+    MCLIB_API NBTVisitor* OnListBegin(const std::string& name, TagType elementType, s32 size) override;
+    void MCLIB_API OnListEnd() override;
+
+    void MCLIB_API OnByte(const std::string& name, u8 value) override;
+    void MCLIB_API OnShort(const std::string& name, s16 value) override;
+    void MCLIB_API OnInt(const std::string& name, s32 value) override;
+    void MCLIB_API OnLong(const std::string& name, s64 value) override;
+    void MCLIB_API OnFloat(const std::string& name, float value) override;
+    void MCLIB_API OnDouble(const std::string& name, double value) override;
+    void MCLIB_API OnByteArray(const std::string& name, const std::string& value) override;
+    void MCLIB_API OnString(const std::string& name, const std::string& value) override;
+    void MCLIB_API OnIntArray(const std::string& name, const std::vector<s32>& value) override;
+};
+
+} // ns nbt
+} // ns mc
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef MCLIB_NBT_NBT_VIEW_H_
+#define MCLIB_NBT_NBT_VIEW_H_
+
+#include <mclib/mclib.h>
+#include <mclib/common/StringView.h>
+#include <mclib/common/Types.h>
+#include <mclib/nbt/Tag.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mc {
+
+class DataBuffer;
+
+namespace nbt {
+
+class NBT;
+
+/**
+ * Read-only view of a tag in the bytes of an NBT. Values are decoded when they are read and nothing is copied
+ * out of the bytes, names and strings are UTF-8 views into them.
+ * Children are found through an index of their offsets that is built the first time a compound or list is accessed.
+ * Compound children are sorted by name in the index so lookups are a binary search.
+ * Views of the same NBT share the bytes and the indexes, which live as long as any of the views.
+ * Building the indexes isn't synchronized, so views of the same NBT shouldn't be used from several threads at once.
+ */
+class NBTView {
+private:
+    struct Child {
+        StringView name;
+        TagType type;
+        u32 offset;
+
+        bool operator<(const Child& other) const noexcept { return name < other.name; }
+    };
+
+    struct Document {
+        std::string data;
+        // Children of the compounds and lists that were accessed, by the offset of their payload.
+        std::unordered_map<u32, std::vector<Child>> indexes;
+    };
+
+    std::shared_ptr<Document> m_Document;
+    StringView m_Name;
+    TagType m_Type;
+    // Offset of the payload in the bytes.
+    u32 m_Offset;
+
+    NBTView(std::shared_ptr<Document> document, StringView name, TagType type, u32 offset)
+        : m_Document(std::move(document)), m_Name(name), m_Type(type), m_Offset(offset) { }
+
+    const char* GetPayload() const noexcept { return m_Document->data.data() + m_Offset; }
+    const std::vector<Child>& GetChildren() const;
+
+public:
+    // Views nothing, IsValid returns false.
+    NBTView() : m_Type(TagType::End), m_Offset(0) { }
+
+    /**
+     * Copies the NBT at the read offset of in and moves the read offset past it.
+     * Returns an invalid view if there is no NBT data, which is sent as a single end tag.
+     * Throws std::runtime_error if the NBT is malformed or ends early.
+     */
+    MCLIB_API static NBTView Read(DataBuffer& in);
+    // Views the NBT that data starts with. Throws std::runtime_error if it is malformed.
+    MCLIB_API static NBTView Parse(std::string data);
+
+    bool IsValid() const noexcept { return m_Type != TagType::End; }
+    explicit operator bool() const noexcept { return IsValid(); }
+
+    TagType GetType() const noexcept { return m_Type; }
+    StringView GetName() const noexcept { return m_Name; }
+
+    // The value of the tag or 0 if the tag has a different type.
+    u8 MCLIB_API GetByte() const noexcept;
+    s16 MCLIB_API GetShort() const noexcept;
+    s32 MCLIB_API GetInt() const noexcept;
+    s64 MCLIB_API GetLong() const noexcept;
+    float MCLIB_API GetFloat() const noexcept;
+    double MCLIB_API GetDouble() const noexcept;
+    // The value of a string tag or an empty string.
+    StringView MCLIB_API GetString() const noexcept;
+    // The bytes of a byte array tag or an empty string.
+    StringView MCLIB_API GetByteArray() const noexcept;
+    std::vector<s32> MCLIB_API GetIntArray() const;
+
+    // Number of children of a compound, elements of a list or values of an array. 0 for other tags.
+    std::size_t MCLIB_API GetSize() const;
+    // The type of the elements of a list.
+    TagType MCLIB_API GetElementType() const noexcept;
+
+    // Element of a list or child of a compound in name order. Invalid if index is out of range.
+    NBTView MCLIB_API operator[](std::size_t index) const;
+    // Child of a compound. Invalid if there is no child with that name.
+    NBTView MCLIB_API Find(StringView name) const;
+    NBTView operator[](const char* name) const { return Find(name); }
+
+    // Builds a tree from the viewed compound.
+    MCLIB_API NBT ToNBT() const;
+};
+
+} // ns nbt
+} // ns mc
+
+#endif
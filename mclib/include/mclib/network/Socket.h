@@ -68,6 +68,13 @@ public:
 
     void MCLIB_API Disconnect();
 
+    /**
+     * Blocks until data can be received, the socket closes or the timeout in milliseconds passes.
+     * Sleeps for the timeout if the socket isn't connected.
+     * Returns true if the socket is ready to be read.
+     */
+    bool MCLIB_API WaitForData(s64 timeout);
+
     std::size_t MCLIB_API Send(const std::string& data);
     std::size_t MCLIB_API Send(DataBuffer& buffer);
 
@@ -509,7 +509,10 @@ public:
     enum class ChatPosition { ChatBox, SystemMessage, Hotbar };
 
 private:
-    json m_ChatData;
+    std::string m_ChatJson;
+    // Parsed from m_ChatJson the first time it's requested.
+    mutable json m_ChatData;
+    mutable bool m_ChatParsed;
     ChatPosition m_Position;
 
 public:
@@ -518,7 +521,9 @@ public:
     void MCLIB_API Dispatch(PacketHandler* handler);
 
     ChatPosition GetChatPosition() const { return m_Position; }
-    const nlohmann::json& GetChatData() const { return m_ChatData; }
+    // The chat component as it was received. util::ExtractChatText reads the text from it without parsing it into json.
+    const std::string& GetChatJson() const { return m_ChatJson; }
+    MCLIB_API const nlohmann::json& GetChatData() const;
 };
 
 class MultiBlockChangePacket : public InboundPacket { // 0x10
@@ -681,6 +686,7 @@ public:
     void MCLIB_API Dispatch(PacketHandler* handler);
 
     std::wstring GetChannel() const { return m_Channel.GetUTF16(); }
+    const std::string& GetChannelUTF8() const { return m_Channel.GetUTF8(); }
     std::string GetData() const { return m_Data; }
 };
 
@@ -1609,7 +1615,7 @@ public:
 class EntityPropertiesPacket : public InboundPacket { // 0x4A
 private:
     EntityId m_EntityId;
-    std::map<std::wstring, mc::entity::Attribute> m_Properties;
+    std::unordered_map<util::InternedString, mc::entity::Attribute> m_Properties;
 
 public:
     MCLIB_API EntityPropertiesPacket();
@@ -1617,7 +1623,7 @@ public:
     void MCLIB_API Dispatch(PacketHandler* handler);
 
     EntityId GetEntityId() const { return m_EntityId; }
-    const std::map<std::wstring, mc::entity::Attribute>& GetProperties() const { return m_Properties; }
+    const std::unordered_map<util::InternedString, mc::entity::Attribute>& GetProperties() const { return m_Properties; }
 };
 
 class EntityEffectPacket : public InboundPacket { // 0x4B
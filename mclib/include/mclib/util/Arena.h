@@ -0,0 +1,85 @@
+#ifndef MCLIB_UTIL_ARENA_H_
+#define MCLIB_UTIL_ARENA_H_
+
+#include <mclib/mclib.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace mc {
+namespace util {
+
+/**
+ * Hands out memory from a few large blocks and frees all of it at once.
+ * Nothing is freed individually and no destructors are run, so only trivially destructible objects can be stored.
+ * Blocks grow from the initial size up to the maximum size as more memory is needed.
+ */
+class Arena {
+private:
+    std::vector<std::unique_ptr<char[]>> m_Blocks;
+    char* m_Current;
+    std::size_t m_Remaining;
+    std::size_t m_NextBlockSize;
+    std::size_t m_MaxBlockSize;
+    std::size_t m_Used;
+    std::size_t m_Capacity;
+
+    void* AllocateBlock(std::size_t size, std::size_t alignment);
+
+public:
+    MCLIB_API Arena(std::size_t initialBlockSize = 256, std::size_t maxBlockSize = 64 * 1024);
+
+    Arena(const Arena& other) = delete;
+    Arena& operator=(const Arena& other) = delete;
+    MCLIB_API Arena(Arena&& other) noexcept;
+    MCLIB_API Arena& operator=(Arena&& other) noexcept;
+
+    void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) {
+        std::size_t padding = (alignment - ((std::uintptr_t)m_Current & (alignment - 1))) & (alignment - 1);
+
+        if (size + padding > m_Remaining)
+            return AllocateBlock(size, alignment);
+
+        char* result = m_Current + padding;
+
+        m_Current = result + size;
+        m_Remaining -= size + padding;
+        m_Used += size;
+        return result;
+    }
+
+    // Uninitialized storage for count objects of type T.
+    template <typename T>
+    T* Allocate(std::size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena doesn't run destructors");
+
+        return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // Copies size bytes into the arena.
+    const char* Copy(const char* data, std::size_t size) {
+        if (size == 0) return "";
+
+        char* result = static_cast<char*>(Allocate(size, 1));
+        std::memcpy(result, data, size);
+        return result;
+    }
+
+    // Frees every block. Everything allocated before is invalid afterwards.
+    void MCLIB_API Clear();
+
+    // Bytes that were allocated, without the padding and the unused ends of blocks.
+    std::size_t GetUsed() const noexcept { return m_Used; }
+    // Bytes held in blocks.
+    std::size_t GetCapacity() const noexcept { return m_Capacity; }
+    std::size_t GetBlockCount() const noexcept { return m_Blocks.size(); }
+};
+
+} // ns util
+} // ns mc
+
+#endif
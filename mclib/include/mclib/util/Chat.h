@@ -0,0 +1,39 @@
+#ifndef MCLIB_UTIL_CHAT_H_
+#define MCLIB_UTIL_CHAT_H_
+
+#include <mclib/mclib.h>
+
+#include <string>
+#include <vector>
+
+namespace mc {
+namespace util {
+
+// A run of chat text with a single style. Styles are inherited from the parent components.
+struct ChatSpan {
+    std::string text;
+    // Color name such as "red", empty if no component sets one.
+    std::string color;
+    bool bold;
+    bool italic;
+    bool underlined;
+    bool strikethrough;
+    bool obfuscated;
+
+    ChatSpan() : bold(false), italic(false), underlined(false), strikethrough(false), obfuscated(false) { }
+};
+
+/**
+ * Reads chat component JSON in a single pass without building a JSON tree.
+ * Text comes first and extra components after it. Common translation keys such as chat.type.text are formatted,
+ * other keys are replaced by their arguments separated by spaces.
+ * Malformed JSON results in empty text.
+ */
+MCLIB_API std::string ExtractChatText(const std::string& json);
+// Like ExtractChatText, but keeps the style of each piece of text.
+MCLIB_API std::vector<ChatSpan> ExtractChatSpans(const std::string& json);
+
+} // ns util
+} // ns mc
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <mclib/core/Connection.h>
 #include <mclib/protocol/packets/PacketHandler.h>
+#include <mclib/util/InternedString.h>
 
 #include <unordered_map>
 #include <functional>
@@ -20,7 +21,7 @@ public:
     };
 
 private:
-    typedef std::unordered_map<std::wstring, std::function<void(const std::string&)>> HandlerMap;
+    typedef std::unordered_map<InternedString, std::function<void(const std::string&)>> HandlerMap;
 
     HandlerMap m_Handlers;
     // Filled out during ping response
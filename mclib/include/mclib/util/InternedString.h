@@ -0,0 +1,71 @@
+#ifndef MCLIB_UTIL_INTERNED_STRING_H_
+#define MCLIB_UTIL_INTERNED_STRING_H_
+
+#include <mclib/mclib.h>
+#include <mclib/common/StringView.h>
+#include <mclib/common/Types.h>
+
+#include <functional>
+#include <string>
+
+namespace mc {
+namespace util {
+
+/**
+ * A UTF-8 string that is stored once for the whole process. Equal strings share their storage and id,
+ * so comparing and hashing them only compares the ids.
+ * Interned strings are never freed, so this is meant for identifiers like block names, channels, attribute keys and player names.
+ * Attribute keys and player names come from the server, so every distinct one that a server sends stays in memory
+ * until the process exits. Use Find for lookups, which doesn't intern anything.
+ * Interning is thread-safe. Strings that were interned before are found under a shared lock.
+ */
+class InternedString {
+public:
+    struct Entry {
+        std::string value;
+        u32 id;
+    };
+
+private:
+    // Null for the empty string.
+    const Entry* m_Entry;
+
+    explicit InternedString(const Entry* entry) noexcept : m_Entry(entry) { }
+
+public:
+    InternedString() noexcept : m_Entry(nullptr) { }
+    MCLIB_API explicit InternedString(StringView str);
+    explicit InternedString(const char* str) : InternedString(StringView(str)) { }
+    explicit InternedString(const std::string& str) : InternedString(StringView(str)) { }
+    MCLIB_API explicit InternedString(const std::wstring& str);
+
+    // Returns the interned string if it was interned before, otherwise the empty string. Doesn't intern anything.
+    static MCLIB_API InternedString Find(StringView str);
+
+    // 0 for the empty string.
+    u32 GetId() const noexcept { return m_Entry ? m_Entry->id : 0; }
+    MCLIB_API const std::string& GetString() const noexcept;
+    MCLIB_API std::wstring GetUTF16() const;
+    bool empty() const noexcept { return m_Entry == nullptr; }
+
+    // The number of strings that have been interned.
+    static MCLIB_API std::size_t GetCount();
+
+    bool operator==(InternedString other) const noexcept { return m_Entry == other.m_Entry; }
+    bool operator!=(InternedString other) const noexcept { return m_Entry != other.m_Entry; }
+    // Orders by id, which is the order the strings were interned in.
+    bool operator<(InternedString other) const noexcept { return GetId() < other.GetId(); }
+};
+
+} // ns util
+} // ns mc
+
+namespace std {
+template <> struct hash<mc::util::InternedString> {
+    std::size_t operator()(mc::util::InternedString str) const noexcept {
+        return std::hash<u32>()(str.GetId());
+    }
+};
+}
+
+#endif
@@ -27,7 +27,7 @@ public:
     template <typename Func, typename... Args>
     void NotifyListeners(Func f, Args... args) {
         for (T* listener : m_Listeners)
-            std::bind(f, listener, args...)();
+            (listener->*f)(args...);
     }
 };
 
@@ -0,0 +1,127 @@
+#ifndef MCLIB_UTIL_PATH_PLANNER_H_
+#define MCLIB_UTIL_PATH_PLANNER_H_
+
+#include <mclib/util/Pathfinder.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace mc {
+namespace util {
+
+struct PathPlannerStats {
+    // Sections whose walkability was copied from an identical interned chunk
+    std::size_t sharedSections;
+    // Sections whose walkability was read block by block
+    std::size_t builtSections;
+    // Requests that continued an existing search towards the same goal
+    std::size_t reusedSearches;
+    // Requests that had to start a new search
+    std::size_t newSearches;
+
+    PathPlannerStats() : sharedSections(0), builtSections(0), reusedSearches(0), newSearches(0) { }
+};
+
+/**
+ * Plans paths for many bots on a pool of worker threads.
+ *
+ * Every client has a World of its own, so worlds are grouped by a key that names the server world they are in,
+ * like the server address and dimension. The worlds with the same key share one walkability grid and one set of
+ * searches, so bots on the same server don't each track the blocks around them or plan towards the same goal again.
+ * The walkability is kept in immutable sections that the workers read without touching any world. Sections of
+ * interned chunks are built once and also shared between grids.
+ *
+ * Searches are cached per goal. D* Lite searches backwards from the goal, so bots that head to the same
+ * goal share the costs that were already found and only expand the nodes that are new to the search.
+ *
+ * RegisterWorld, UnregisterWorld and Submit must be called from the thread that updates that world.
+ * Worlds with the same key can be updated on different threads.
+ */
+class PathPlanner {
+private:
+    class WorldGrid;
+    class WorldLink;
+    class SectionView;
+    struct Search;
+
+    // Sections are only written while nothing else holds them, otherwise they are copied first.
+    typedef std::shared_ptr<WalkabilityGrid::Section> SectionPtr;
+    // Called with true if the planner is destroyed before a worker runs it.
+    typedef std::function<void(bool cancelled)> Task;
+
+    PathCosts m_Costs;
+    std::size_t m_MaxSearches;
+
+    // Guards the registered worlds and the number of searches
+    std::mutex m_WorldMutex;
+    std::unordered_map<world::World*, std::unique_ptr<WorldLink>> m_Worlds;
+    std::unordered_map<std::string, std::weak_ptr<WorldGrid>> m_SharedGrids;
+    std::size_t m_SearchCount;
+    u64 m_SearchCounter;
+
+    std::mutex m_SectionMutex;
+    std::unordered_map<const world::Chunk*, std::pair<std::weak_ptr<const world::Chunk>, SectionPtr>> m_SharedSections;
+    std::size_t m_InsertsSincePrune;
+
+    std::mutex m_StatsMutex;
+    PathPlannerStats m_Stats;
+
+    std::mutex m_TaskMutex;
+    std::condition_variable m_TaskCondition;
+    std::deque<Task> m_Tasks;
+    std::vector<std::thread> m_Workers;
+    bool m_Stopping;
+
+    void WorkerThread();
+    SectionPtr GetSection(const world::ConstChunkPtr& chunk);
+
+    // These expect the world mutex to be held.
+    std::shared_ptr<WorldGrid> AddWorld(world::World& world, const std::string& key);
+    void RemoveWorld(std::unordered_map<world::World*, std::unique_ptr<WorldLink>>::iterator iter);
+    void EvictOldestSearch();
+
+public:
+    // Uses one worker per hardware thread if workers is 0.
+    MCLIB_API PathPlanner(std::size_t workers = 0, const PathCosts& costs = PathCosts());
+    // Plans that are still queued are completed with an empty path.
+    MCLIB_API ~PathPlanner();
+
+    PathPlanner(const PathPlanner& rhs) = delete;
+    PathPlanner& operator=(const PathPlanner& rhs) = delete;
+
+    /**
+     * Starts tracking the walkability of a world. The loaded columns are read right away.
+     * Worlds with the same key share their grid and searches. An empty key gives the world a grid of its own.
+     * Registering the world again with another key moves it, e.g. after it changed dimension.
+     */
+    void MCLIB_API RegisterWorld(world::World& world, const std::string& key = "");
+    void MCLIB_API UnregisterWorld(world::World& world);
+
+    // Limits how many goals are remembered by the planner over all worlds. The least recently used search is dropped.
+    void SetMaxSearches(std::size_t searches) { m_MaxSearches = searches; }
+
+    /**
+     * Queues a plan from start to goal. The future holds the path without the start, which is
+     * empty if there is no path or the search hit its expansion limit. Submitting again continues the search.
+     * The world is registered without a key if it isn't registered yet.
+     */
+    MCLIB_API std::future<std::vector<Vector3i>> Submit(world::World& world, Vector3i start, Vector3i goal);
+
+    PathPlannerStats MCLIB_API GetStats();
+};
+
+} // ns util
+} // ns mc
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef MCLIB_UTIL_PATHFINDER_H_
+#define MCLIB_UTIL_PATHFINDER_H_
+
+#include <mclib/common/Vector.h>
+#include <mclib/util/ObserverSubject.h>
+#include <mclib/world/World.h>
+
+#include <array>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mc {
+namespace util {
+
+class PathGridListener {
+public:
+    virtual ~PathGridListener() { }
+
+    // Called when a block changes. Paths through nodes near the block might have changed.
+    virtual void OnGridChange(Vector3i /*position*/) { }
+    // Called when a column is loaded or unloaded. Any node in the column might have changed.
+    virtual void OnGridColumnChange(s32 /*chunkX*/, s32 /*chunkZ*/) { }
+};
+
+/**
+ * Walkability of the blocks that paths are planned over.
+ */
+class WalkabilityGrid : public ObserverSubject<PathGridListener> {
+public:
+    enum CellFlags : u8 {
+        Passable = 1 << 0,
+        Supporting = 1 << 1
+    };
+
+    // Flags of a 16x16x16 section, indexed by (y * 16 + z) * 16 + x
+    typedef std::array<u8, 16 * 16 * 16> Section;
+
+    virtual ~WalkabilityGrid() { }
+
+    virtual u8 GetCell(Vector3i position) = 0;
+
+    // The player can move through the block.
+    bool IsPassable(Vector3i position) {
+        return (GetCell(position) & Passable) != 0;
+    }
+
+    // The player can stand on top of the block.
+    bool IsSupporting(Vector3i position) {
+        return (GetCell(position) & Supporting) != 0;
+    }
+
+    // The player can stand with their feet in this block.
+    bool IsStandable(Vector3i position) {
+        return IsPassable(position) &&
+            IsPassable(position + Vector3i(0, 1, 0)) &&
+            IsSupporting(position - Vector3i(0, 1, 0));
+    }
+
+    // Derived from block solidity and bounding boxes. Liquids are neither passable nor supporting.
+    static u8 MCLIB_API GetFlags(block::BlockPtr block);
+    static void MCLIB_API FillSection(const world::Chunk* chunk, Section& section);
+
+    static Vector3i GetSectionKey(Vector3i position) {
+        return Vector3i(position.x >> 4, position.y >> 4, position.z >> 4);
+    }
+
+    static std::size_t GetSectionIndex(Vector3i position) {
+        return (std::size_t)(((position.y & 15) * 16 + (position.z & 15)) * 16 + (position.x & 15));
+    }
+};
+
+/**
+ * Caches which blocks can be walked through and stood on.
+ * Unloaded chunks and columns compressed by eviction are never walkable. Kept up to date by listening to the world.
+ */
+class PathGrid : public world::WorldListener, public WalkabilityGrid {
+private:
+    world::World& m_World;
+    // Sections are keyed by chunk coordinates and filled in when a cell in them is first checked.
+    std::unordered_map<Vector3i, std::unique_ptr<Section>, Vector3Hash<s64>> m_Sections;
+
+    void EraseColumn(s32 chunkX, s32 chunkZ);
+
+public:
+    MCLIB_API PathGrid(world::World& world);
+    MCLIB_API ~PathGrid();
+
+    PathGrid(const PathGrid& rhs) = delete;
+    PathGrid& operator=(const PathGrid& rhs) = delete;
+
+    u8 MCLIB_API GetCell(Vector3i position) override;
+
+    void MCLIB_API Clear();
+
+    world::World& GetWorld() { return m_World; }
+
+    void MCLIB_API OnBlockChange(Vector3i position, block::BlockPtr newBlock, block::BlockPtr oldBlock) override;
+    void MCLIB_API OnColumnLoad(const world::ChunkColumn& column, u16 changedMask) override;
+    void MCLIB_API OnChunkUnload(world::ChunkColumnPtr chunk) override;
+    void MCLIB_API OnChunkEvict(world::ChunkColumnPtr chunk, bool compressed) override;
+};
+
+struct PathCosts {
+    // Cost of walking one block straight
+    double walk;
+    // Cost of walking one block diagonally
+    double diagonal;
+    // Extra cost of jumping up one block
+    double jump;
+    // Extra cost for each block dropped down
+    double drop;
+    // Highest drop that will be taken
+    s32 maxDrop;
+    bool allowDiagonal;
+
+    PathCosts() : walk(1.0), diagonal(1.4142), jump(1.0), drop(1.0), maxDrop(3), allowDiagonal(true) { }
+};
+
+/**
+ * Plans paths over a WalkabilityGrid with D* Lite.
+ * The search runs backwards from the goal, so moving the start and changing blocks only repairs
+ * the part of the search that changed instead of planning from scratch.
+ * Positions are the blocks that the player's feet are in.
+ */
+class Pathfinder : public PathGridListener {
+public:
+    typedef std::pair<double, double> Key;
+
+private:
+    struct Node {
+        double g;
+        double rhs;
+        Key key;
+        bool queued;
+
+        Node();
+    };
+
+    typedef std::unordered_map<Vector3i, Node, Vector3Hash<s64>> NodeMap;
+
+    WalkabilityGrid& m_Grid;
+    PathCosts m_Costs;
+    NodeMap m_Nodes;
+    // Positions of the nodes in each column, keyed by chunk coordinates with y = 0, so a column change doesn't scan every node.
+    std::unordered_map<Vector3i, std::vector<Vector3i>, Vector3Hash<s64>> m_ColumnNodes;
+    std::set<std::pair<Key, Vector3i>> m_Queue;
+    Vector3i m_Start;
+    Vector3i m_Goal;
+    Vector3i m_LastStart;
+    double m_KeyModifier;
+    bool m_HasGoal;
+    bool m_NeedsReset;
+    std::size_t m_MaxExpansions;
+    std::vector<Vector3i> m_ChangedBlocks;
+    std::vector<std::pair<s32, s32>> m_ChangedColumns;
+    // Scratch buffers so expanding a node doesn't allocate
+    std::vector<std::pair<Vector3i, double>> m_Successors;
+    std::vector<std::pair<Vector3i, double>> m_Predecessors;
+
+    Node& GetNode(Vector3i position);
+    NodeMap::iterator AddNode(Vector3i position);
+    void ClearNodes();
+    double GetG(Vector3i position) const;
+    double Heuristic(Vector3i from, Vector3i to) const;
+    Key CalculateKey(Vector3i position, const Node& node) const;
+    void UpdateVertex(Vector3i position);
+    bool ComputeShortestPath();
+    void Reset();
+    void ApplyChanges();
+
+    // The neighbors that can be moved to from position, with the cost of each move
+    void GetSuccessors(Vector3i position, std::vector<std::pair<Vector3i, double>>& out);
+    // The neighbors that can move to position, with the cost of each move
+    void GetPredecessors(Vector3i position, std::vector<std::pair<Vector3i, double>>& out);
+
+public:
+    MCLIB_API Pathfinder(WalkabilityGrid& grid, const PathCosts& costs = PathCosts());
+    MCLIB_API ~Pathfinder();
+
+    Pathfinder(const Pathfinder& rhs) = delete;
+    Pathfinder& operator=(const Pathfinder& rhs) = delete;
+
+    // The cost of moving from one block to a neighbor. Infinite if the move isn't possible.
+    double MCLIB_API GetCost(Vector3i from, Vector3i to);
+
+    void MCLIB_API SetGoal(Vector3i goal);
+    void MCLIB_API SetStart(Vector3i start);
+    void MCLIB_API ClearGoal();
+    bool HasGoal() const { return m_HasGoal; }
+    Vector3i GetGoal() const { return m_Goal; }
+
+    // Limits how many nodes a single plan can expand before giving up, for goals that can't be reached.
+    void SetMaxExpansions(std::size_t expansions) { m_MaxExpansions = expansions; }
+
+    /**
+     * Plans or repairs the path from the start to the goal. Returns false if there is no path yet.
+     * Cheap to call every tick, only nodes near blocks that changed since the last call are searched again.
+     * A search that hits the expansion limit continues where it stopped on the next call.
+     */
+    bool MCLIB_API Plan();
+    // The next block to move to from the start. Returns the start if there is no path.
+    Vector3i MCLIB_API GetNextStep();
+    // The full path from the start to the goal, excluding the start. Empty if there is no path.
+    std::vector<Vector3i> MCLIB_API GetPath(std::size_t maxLength = 1024);
+
+    void MCLIB_API OnGridChange(Vector3i position) override;
+    void MCLIB_API OnGridColumnChange(s32 chunkX, s32 chunkZ) override;
+};
+
+} // ns util
+} // ns mc
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef MCLIB_UTIL_STREAM_H_
+#define MCLIB_UTIL_STREAM_H_
+
+#include <mclib/mclib.h>
+#include <mclib/common/Types.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct z_stream_s;
+
+namespace mc {
+namespace util {
+
+// The streams throw std::runtime_error when reading or writing fails.
+class InputStream {
+public:
+    virtual ~InputStream() { }
+
+    // Reads up to size bytes into data. Returns the number of bytes read, which is only 0 at the end of the stream.
+    virtual std::size_t Read(void* data, std::size_t size) = 0;
+};
+
+class OutputStream {
+public:
+    virtual ~OutputStream() { }
+
+    virtual void Write(const void* data, std::size_t size) = 0;
+    virtual void Flush() { }
+};
+
+class FileInputStream : public InputStream {
+private:
+    FILE* m_File;
+
+public:
+    // Throws std::runtime_error if the file can't be opened.
+    MCLIB_API FileInputStream(const std::string& path);
+    MCLIB_API ~FileInputStream();
+
+    FileInputStream(const FileInputStream& other) = delete;
+    FileInputStream& operator=(const FileInputStream& other) = delete;
+
+    std::size_t MCLIB_API Read(void* data, std::size_t size) override;
+};
+
+class FileOutputStream : public OutputStream {
+private:
+    FILE* m_File;
+
+public:
+    // Creates or truncates the file. Throws std::runtime_error if the file can't be opened.
+    MCLIB_API FileOutputStream(const std::string& path);
+    MCLIB_API ~FileOutputStream();
+
+    FileOutputStream(const FileOutputStream& other) = delete;
+    FileOutputStream& operator=(const FileOutputStream& other) = delete;
+
+    void MCLIB_API Write(const void* data, std::size_t size) override;
+    void MCLIB_API Flush() override;
+};
+
+enum class Compression { None, Zlib, Gzip };
+
+// Detects the compression from the first bytes of the data.
+MCLIB_API Compression DetectCompression(const u8* data, std::size_t size);
+
+/**
+ * Inflates zlib or gzip data from another stream as it is read.
+ * The format is detected from the header. Reads ahead in the other stream, so it shouldn't be read from directly afterwards.
+ */
+class InflateStream : public InputStream {
+private:
+    InputStream& m_In;
+    std::unique_ptr<z_stream_s> m_Stream;
+    std::vector<u8> m_Input;
+    bool m_Finished;
+
+public:
+    MCLIB_API InflateStream(InputStream& in, std::size_t bufferSize = 64 * 1024);
+    MCLIB_API ~InflateStream();
+
+    InflateStream(const InflateStream& other) = delete;
+    InflateStream& operator=(const InflateStream& other) = delete;
+
+    std::size_t MCLIB_API Read(void* data, std::size_t size) override;
+};
+
+/**
+ * Deflates everything that is written to it into another stream.
+ * Finish has to be called after the last write to complete the compressed data.
+ */
+class DeflateStream : public OutputStream {
+private:
+    OutputStream& m_Out;
+    std::unique_ptr<z_stream_s> m_Stream;
+    std::vector<u8> m_Output;
+    bool m_Finished;
+
+    void Deflate(int flush);
+
+public:
+    // Level is a zlib compression level from 0 to 9 or -1 for the default.
+    MCLIB_API DeflateStream(OutputStream& out, Compression compression = Compression::Gzip, int level = -1, std::size_t bufferSize = 64 * 1024);
+    MCLIB_API ~DeflateStream();
+
+    DeflateStream(const DeflateStream& other) = delete;
+    DeflateStream& operator=(const DeflateStream& other) = delete;
+
+    void MCLIB_API Write(const void* data, std::size_t size) override;
+    // Flushes the compressed data that is pending so far, which makes the compression slightly worse.
+    void MCLIB_API Flush() override;
+    // Writes the end of the compressed data and flushes the other stream.
+    void MCLIB_API Finish();
+};
+
+/**
+ * Maps a file into memory read-only, so it can be parsed in place without reading it.
+ */
+class MappedFile {
+private:
+    const u8* m_Data;
+    std::size_t m_Size;
+
+public:
+    MCLIB_API MappedFile();
+    MCLIB_API ~MappedFile();
+
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    // Returns false if the file can't be mapped, such as when it is empty.
+    bool MCLIB_API Open(const std::string& path);
+    void MCLIB_API Close();
+
+    const u8* GetData() const noexcept { return m_Data; }
+    std::size_t GetSize() const noexcept { return m_Size; }
+};
+
+} // ns util
+} // ns mc
+
+#endif
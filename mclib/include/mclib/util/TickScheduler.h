@@ -0,0 +1,65 @@
+#ifndef MCLIB_UTIL_TICK_SCHEDULER_H_
+#define MCLIB_UTIL_TICK_SCHEDULER_H_
+
+#include <mclib/mclib.h>
+#include <mclib/common/Types.h>
+
+namespace mc {
+namespace util {
+
+enum class TickPolicy {
+    // Run every tick that was missed, up to the catch up limit
+    CatchUp,
+    // Run a single tick and drop the ones that were missed
+    Skip
+};
+
+/**
+ * Schedules ticks on fixed boundaries of a monotonic clock.
+ * Tick n happens at n * interval + phase, so ticks don't drift when an update runs late.
+ * Bots in the same process should use different phases so they don't all tick on the same millisecond.
+ */
+class TickScheduler {
+private:
+    s64 m_Interval;
+    s64 m_Phase;
+    TickPolicy m_Policy;
+    u32 m_MaxCatchUp;
+    s64 m_NextTick;
+    bool m_Started;
+    u64 m_Ticks;
+    u64 m_SkippedTicks;
+
+public:
+    MCLIB_API TickScheduler(s64 interval = 50, TickPolicy policy = TickPolicy::Skip);
+
+    // Milliseconds from a monotonic clock, unaffected by changes to the system time.
+    static s64 MCLIB_API GetTime();
+
+    // Offset of the tick boundaries in milliseconds. Restarts the schedule.
+    void MCLIB_API SetPhase(s64 phase);
+    void MCLIB_API SetPolicy(TickPolicy policy, u32 maxCatchUp = 5);
+    // The first tick happens on the next boundary after the next call to Poll.
+    void Reset() { m_Started = false; }
+
+    /**
+     * Returns the number of ticks to run now and moves the schedule past them.
+     * Always 0 or 1 with the skip policy.
+     */
+    u32 MCLIB_API Poll(s64 now);
+
+    // Milliseconds until the next tick is due. 0 if it's already due or the schedule hasn't started.
+    s64 MCLIB_API GetTimeUntilNextTick(s64 now) const;
+
+    s64 GetInterval() const { return m_Interval; }
+    s64 GetPhase() const { return m_Phase; }
+    s64 GetNextTick() const { return m_NextTick; }
+    u64 GetTickCount() const { return m_Ticks; }
+    // Ticks that were dropped because they were too late
+    u64 GetSkippedTicks() const { return m_SkippedTicks; }
+};
+
+} // ns util
+} // ns mc
+
+#endif
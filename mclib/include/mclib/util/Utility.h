@@ -8,9 +8,13 @@
 #include <mclib/core/Client.h>
 #include <mclib/core/Connection.h>
 #include <mclib/core/PlayerManager.h>
+#include <mclib/util/PathPlanner.h>
+#include <mclib/util/Pathfinder.h>
+#include <mclib/world/BlockCache.h>
 #include <mclib/world/World.h>
 
 #include <fstream>
+#include <memory>
 #include <string>
 #include <queue>
 #include <utility>
@@ -42,20 +46,50 @@ private:
     float m_Pitch;
     AABB m_BoundingBox;
     EntityId m_EntityId;
-    u64 m_LastUpdate;
     Vector3d m_TargetPos;
     bool m_Sprinting;
     bool m_LoadedIn;
     bool m_HandleFall;
 
     double m_MoveSpeed;
+    double m_StepHeight;
+    // Whether the last vertical move ended on a block. Blocks are only stepped up from the ground.
+    bool m_OnGround;
+    // Milliseconds simulated by each update
+    s64 m_TickTime;
 
     std::queue<Vector3d> m_DigQueue;
 
+    // Blocks around the player that are used for collision checks.
+    // Sized to hold the broadphase of a move, see UpdateBlockCacheRadius.
+    world::BlockCache m_BlockCache;
+    // Block bounding boxes found by the broadphase of the current move
+    std::vector<AABB> m_Colliders;
+
+    // Created by the first SetPathGoal without a shared planner, so controllers that never look for paths
+    // or use the planner don't cache the world.
+    std::unique_ptr<PathGrid> m_PathGrid;
+    std::unique_ptr<Pathfinder> m_Pathfinder;
+    bool m_HasPathGoal;
+    Vector3i m_PathGoal;
+
+    // Plans are requested from the shared planner instead of the local pathfinder when it's set.
+    PathPlanner* m_PathPlanner;
+    std::future<std::vector<Vector3i>> m_PathRequest;
+    std::vector<Vector3i> m_PlannedPath;
+    Vector3i m_PlannedStart;
+    Vector3i m_PlannedGoal;
+
     // todo: gravity
-    const float FallSpeed = 8.3f * (50.0f / 1000.0f);
+    const double FallSpeed = 8.3; // m/s
+    const double EyeHeight = 1.62;
 
-    std::vector<std::pair<block::BlockPtr, mc::Vector3i>> GetNearbyBlocks(const s32 radius);
+    const std::vector<std::pair<block::BlockPtr, mc::Vector3i>>& GetNearbyBlocks();
+    void GatherColliders(const AABB& area);
+    Vector3d SweepAxes(AABB& bounds, Vector3d delta) const;
+    void UpdateBlockCacheRadius();
+    void UpdatePlannedPath(Vector3i feet);
+    Pathfinder& GetLocalPathfinder();
 
 public:
     MCLIB_API PlayerController(core::Connection* connection, world::World& world, core::PlayerManager& playerManager);
@@ -63,10 +97,18 @@ public:
 
     void MCLIB_API OnClientSpawn(core::PlayerPtr player);
     bool MCLIB_API ClearPath(Vector3d target);
+    // Returns true if no block is between the player's eyes and the target.
+    bool MCLIB_API HasLineOfSight(Vector3d target) const;
+    // Raycasts from the player's eyes in the direction that the player is looking.
+    world::RaycastResult MCLIB_API GetTargetBlock(double maxDistance) const;
 
     void MCLIB_API Dig(Vector3d target);
     void MCLIB_API Attack(EntityId id);
     void MCLIB_API Move(Vector3d delta);
+    // Sweeps the player bounding box along delta and returns how far it can move before hitting blocks.
+    // Resolves y, then x, then z, and steps up blocks that are at most the step height tall.
+    // Like vanilla, the step is only taken on the ground or when the player lands during this move.
+    Vector3d MCLIB_API ResolveCollisions(Vector3d delta);
 
     bool MCLIB_API HandleJump();
     bool MCLIB_API HandleFall();
@@ -85,10 +127,26 @@ public:
     void MCLIB_API SetPitch(float pitch);
     void MCLIB_API LookAt(Vector3d target);
     void MCLIB_API SetMoveSpeed(double speed);
+    void MCLIB_API SetStepHeight(double height);
+    // Update is called once per tick, so movement is simulated in fixed steps of this many milliseconds.
+    void MCLIB_API SetTickTime(s64 time);
     void MCLIB_API SetTargetPosition(Vector3d target);
     void MCLIB_API SetHandleFall(bool handle);
+
+    // Walks to the goal along a planned path instead of in a straight line.
+    void MCLIB_API SetPathGoal(Vector3i goal);
+    void MCLIB_API ClearPathGoal();
+    bool HasPathGoal() const { return m_HasPathGoal; }
+    Vector3i GetPathGoal() const { return m_PathGoal; }
+    // Null until a path goal is set without a shared planner, and while the planner is set.
+    Pathfinder* GetPathfinder() { return m_Pathfinder.get(); }
+    // Shares path planning with other controllers. The planner must outlive this controller.
+    // The local path grid and pathfinder are released while a planner is set.
+    // Controllers whose worlds are registered with the same key share the walkability and searches, see PathPlanner::RegisterWorld.
+    void MCLIB_API SetPathPlanner(PathPlanner* planner, const std::string& worldKey = "");
 };
 
+// Aims and paths at the predicted position of the target if prediction is enabled on the entity manager.
 class PlayerFollower : public core::PlayerListener, public core::ClientListener {
 private:
     core::Client* m_Client;
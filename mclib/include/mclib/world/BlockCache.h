@@ -0,0 +1,66 @@
+#ifndef MCLIB_WORLD_BLOCK_CACHE_H_
+#define MCLIB_WORLD_BLOCK_CACHE_H_
+
+#include <mclib/world/World.h>
+
+#include <utility>
+#include <vector>
+
+namespace mc {
+namespace world {
+
+/**
+ * Caches the blocks in a small cube around a moving center.
+ * Only the blocks that enter the cube are read from the world when the center moves,
+ * and block changes in the world update the cache directly.
+ */
+class BlockCache : public WorldListener {
+public:
+    typedef std::pair<block::BlockPtr, Vector3i> BlockPosition;
+
+private:
+    World& m_World;
+    s64 m_Radius;
+    s64 m_Size;
+    // Indexed by world position modulo the size, so moving the center doesn't move the cached blocks.
+    std::vector<block::BlockPtr> m_Blocks;
+    Vector3i m_Min;
+    bool m_Valid;
+    std::vector<BlockPosition> m_SolidBlocks;
+    bool m_SolidDirty;
+
+    std::size_t GetIndex(Vector3i position) const;
+    bool Overlaps(const ChunkColumnMetadata& meta) const;
+
+public:
+    // The cube covers radius blocks on each side of the center block, excluding the last block on the positive side.
+    MCLIB_API BlockCache(World& world, s32 radius);
+    MCLIB_API ~BlockCache();
+
+    BlockCache(const BlockCache& rhs) = delete;
+    BlockCache& operator=(const BlockCache& rhs) = delete;
+
+    // Resizes the cube. The blocks are read again on the next SetCenter.
+    void MCLIB_API SetRadius(s32 radius);
+    s32 GetRadius() const { return (s32)m_Radius; }
+
+    // Moves the cube and reads the blocks that entered it.
+    void MCLIB_API SetCenter(Vector3d center);
+    void MCLIB_API Invalidate();
+
+    bool MCLIB_API Contains(Vector3i position) const;
+    // Reads from the world if the position isn't cached.
+    block::BlockPtr MCLIB_API GetBlock(Vector3i position) const;
+    // All of the solid blocks in the cube, ordered by position.
+    MCLIB_API const std::vector<BlockPosition>& GetSolidBlocks();
+
+    void MCLIB_API OnBlockChange(Vector3i position, block::BlockPtr newBlock, block::BlockPtr oldBlock) override;
+    void MCLIB_API OnColumnLoad(const ChunkColumn& column, u16 changedMask) override;
+    void MCLIB_API OnChunkUnload(ChunkColumnPtr chunk) override;
+    void MCLIB_API OnChunkEvict(ChunkColumnPtr chunk, bool compressed) override;
+};
+
+} // ns world
+} // ns mc
+
+#endif
@@ -7,8 +7,11 @@
 #include "mclib/nbt/NBT.h"
 
 #include <array>
+#include <atomic>
 #include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace mc {
 
@@ -30,15 +33,93 @@ struct ChunkColumnMetadata {
  */
 class Chunk {
 private:
-    std::vector<u32> m_Palette;
-    std::vector<u64> m_Data;
-    u8 m_BitsPerBlock;
+    // Mutable so a compressed chunk can be inflated when it's read.
+    mutable std::vector<u32> m_Palette;
+    mutable std::vector<u64> m_Data;
+    mutable std::string m_Compressed;
+    mutable u8 m_BitsPerBlock;
+    // IsEmpty from when the chunk was compressed, so it can be answered without inflating.
+    bool m_CompressedEmpty;
+    bool m_Interned;
+    // Atomic because interned chunks are read by the clients of every world that shares them.
+    mutable std::atomic<bool> m_Accessed;
+    mutable std::atomic<bool> m_Inflated;
+
+    void ReadData(DataBuffer& in) const;
+    void Inflate() const;
+
+    u32 ReadValue(std::size_t index) const;
+    void WriteValue(std::size_t index, u32 value);
+    void InitializeData();
+    // Rewrites the data with a different number of bits per block.
+    void Repack(u8 bitsPerBlock);
+    // Gets the value that is stored in the data for a block type. Adds it to the palette if needed.
+    u32 GetPaletteValue(u32 blockType);
 
 public:
+    // Number of bits per block used when the palette doesn't fit in 8 bits.
+    enum { GlobalPaletteBits = 13 };
+
     MCLIB_API Chunk();
 
     MCLIB_API Chunk(const Chunk& other);
     MCLIB_API Chunk& operator=(const Chunk& other);
+
+    /**
+     * Compares the raw palette and block data. Two equal chunks can share storage.
+     */
+    bool MCLIB_API operator==(const Chunk& other) const;
+    bool operator!=(const Chunk& other) const { return !(*this == other); }
+
+    /**
+     * Hash of the raw palette and block data. Equal chunks have equal hashes.
+     */
+    std::size_t MCLIB_API GetHash() const;
+
+    /**
+     * Interned chunks are shared between columns, possibly of worlds on other threads, and must not be modified.
+     * They are never compressed, so reading them doesn't inflate anything.
+     * ChunkColumn::SetBlock copies them before writing.
+     */
+    bool IsInterned() const { return m_Interned; }
+    void SetInterned(bool interned) { m_Interned = interned; }
+
+    /**
+     * Approximate number of bytes used by this chunk, including its palette and block data.
+     */
+    std::size_t MCLIB_API GetMemoryUsage() const;
+
+    /**
+     * Writes the palette and block data in a compact form that can be read back with Deserialize.
+     * This isn't the network format, light data isn't stored.
+     */
+    void MCLIB_API Serialize(DataBuffer& out) const;
+    void MCLIB_API Deserialize(DataBuffer& in);
+
+    /**
+     * Compresses the palette and block data with zlib.
+     * The chunk is inflated again the next time a block is read or written.
+     * The chunk stays uncompressed if zlib fails.
+     */
+    void MCLIB_API Compress();
+    // Inflates the chunk if it's compressed. Throws std::runtime_error if the compressed data is corrupt.
+    void MCLIB_API Decompress();
+    bool IsCompressed() const { return !m_Compressed.empty(); }
+    // Number of bytes saved by compressing this chunk. 0 if it isn't compressed.
+    std::size_t MCLIB_API GetCompressionSavings() const;
+
+    // Returns whether a block was read or written since the last call.
+    bool ConsumeAccessed() { return m_Accessed.exchange(false, std::memory_order_relaxed); }
+    // Returns whether the chunk was inflated since the last call.
+    bool ConsumeInflated() { return m_Inflated.exchange(false, std::memory_order_relaxed); }
+
+    /**
+     * Returns true if the palette only contains air, so every block in this chunk is air.
+     * Can return false for an air chunk if the palette still has unused types.
+     * Doesn't inflate a compressed chunk.
+     */
+    bool MCLIB_API IsEmpty() const;
+
     /**
      * Position is relative to this chunk position
      */
@@ -49,6 +130,12 @@ public:
     */
     void MCLIB_API SetBlock(Vector3i chunkPosition, block::BlockPtr block);
 
+    /**
+     * Sets multiple blocks at once. The palette is only updated once for each new block type.
+     * Positions are relative to this chunk position
+     */
+    void MCLIB_API SetBlocks(const std::vector<std::pair<Vector3i, block::BlockPtr>>& blocks);
+
     /**
      * chunkIndex is the index (0-16) of this chunk in the ChunkColumn
      */
@@ -56,6 +143,9 @@ public:
 };
 
 typedef std::shared_ptr<Chunk> ChunkPtr;
+typedef std::shared_ptr<const Chunk> ConstChunkPtr;
+
+class ChunkInterner;
 
 /**
  * Stores a 16x256x16 area. Uses chunks (16x16x16) to store the data vertically.
@@ -65,15 +155,14 @@ class ChunkColumn {
 public:
     enum { ChunksPerColumn = 16 };
 
-    typedef std::array<ChunkPtr, ChunksPerColumn>::iterator iterator;
-    typedef std::array<ChunkPtr, ChunksPerColumn>::reference reference;
-    typedef std::array<ChunkPtr, ChunksPerColumn>::const_iterator const_iterator;
-    typedef std::array<ChunkPtr, ChunksPerColumn>::const_reference const_reference;
-
 private:
     std::array<ChunkPtr, ChunksPerColumn> m_Chunks;
     ChunkColumnMetadata m_Metadata;
     std::map<Vector3i, block::BlockEntityPtr> m_BlockEntities;
+    std::string m_CompressedChunks;
+    u64 m_LastAccess;
+
+    ChunkPtr& GetWritableChunk(s32 chunkIndex);
 
 public:
     MCLIB_API ChunkColumn(ChunkColumnMetadata metadata);
@@ -83,29 +172,17 @@ public:
     ChunkColumn(ChunkColumn&& rhs) = default;
     ChunkColumn& operator=(ChunkColumn&& rhs) = default;
 
-    iterator MCLIB_API begin() {
-        return m_Chunks.begin();
-    }
-
-    iterator MCLIB_API end() {
-        return m_Chunks.end();
-    }
-
-    reference MCLIB_API operator[](std::size_t index) {
+    /**
+     * The chunks can be shared with other columns, so they are read-only.
+     * Blocks are changed through SetBlock and SetBlocks, which copy shared chunks first.
+     * All of the chunks are null while the column is compressed.
+     */
+    ConstChunkPtr operator[](std::size_t index) const {
         return m_Chunks[index];
     }
 
-    const_iterator MCLIB_API begin() const {
-        return m_Chunks.begin();
-    }
-
-    const_iterator MCLIB_API end() const {
-        return m_Chunks.end();
-    }
-
-    const_reference MCLIB_API operator[](std::size_t index) const {
-        return m_Chunks[index];
-    }
+    // Replaces the chunks whose bit is set in the mask with the chunks of another column.
+    void MCLIB_API ReplaceChunks(const ChunkColumn& other, u16 mask);
 
     void MCLIB_API AddBlockEntity(block::BlockEntityPtr blockEntity) {
         m_BlockEntities.insert(std::make_pair(blockEntity->GetPosition(), blockEntity));
@@ -117,8 +194,55 @@ public:
 
     /**
      * Position is relative to this ChunkColumn position.
+     * The column is decompressed first if it's compressed.
      */
     block::BlockPtr MCLIB_API GetBlock(Vector3i position);
+
+    /**
+     * Position is relative to this ChunkColumn position.
+     * Creates the chunk if it's null and copies it first if it's interned.
+     * The column is decompressed first if it's compressed.
+     */
+    void MCLIB_API SetBlock(Vector3i position, block::BlockPtr block);
+
+    /**
+     * Positions are relative to this ChunkColumn position.
+     * The blocks are grouped by chunk and each chunk is updated in a single pass.
+     */
+    void MCLIB_API SetBlocks(const std::vector<std::pair<Vector3i, block::BlockPtr>>& blocks);
+
+    /**
+     * Replaces each chunk in this column with a shared copy from the interner.
+     */
+    void MCLIB_API Intern(ChunkInterner& interner);
+
+    /**
+     * Compresses the chunks that weren't accessed since the last call.
+     * Interned chunks that are still shared with other columns are skipped, the rest are replaced by a private copy first.
+     * Adds the number of compressed chunks and of chunks that were inflated since the last call to the counters.
+     */
+    void MCLIB_API CompressIdleChunks(u64& compressions, u64& inflations);
+
+    /**
+     * Approximate number of bytes used by this column and its chunks.
+     * Interned chunks are counted in full even though they are shared.
+     */
+    std::size_t MCLIB_API GetMemoryUsage() const;
+
+    /**
+     * Packs all of the chunks into a zlib compressed buffer and releases them.
+     * The metadata and block entities are kept uncompressed.
+     * The chunks are null until Decompress is called, which GetBlock, SetBlock and SetBlocks do on their own.
+     * The column stays uncompressed if zlib fails.
+     */
+    void MCLIB_API Compress();
+    // Throws std::runtime_error if the compressed data is corrupt.
+    void MCLIB_API Decompress();
+    bool IsCompressed() const { return !m_CompressedChunks.empty(); }
+
+    // Used by World to find the least recently used columns.
+    u64 GetLastAccess() const { return m_LastAccess; }
+    void SetLastAccess(u64 access) { m_LastAccess = access; }
     const ChunkColumnMetadata& GetMetadata() const { return m_Metadata; }
 
     MCLIB_API block::BlockEntityPtr GetBlockEntity(Vector3i worldPos);
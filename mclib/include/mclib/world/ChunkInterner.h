@@ -0,0 +1,53 @@
+#ifndef MCLIB_WORLD_CHUNK_INTERNER_H_
+#define MCLIB_WORLD_CHUNK_INTERNER_H_
+
+#include <mclib/world/Chunk.h>
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace mc {
+namespace world {
+
+/**
+ * Shares identical chunks between chunk columns.
+ * Flat worlds and deep stone layers send the same chunk data many times, so only one copy is kept.
+ * Interned chunks are immutable, ChunkColumn::SetBlock copies them before writing.
+ * Can be shared between multiple worlds. Only weak references are held, so unloaded chunks are freed.
+ */
+class ChunkInterner {
+private:
+    std::unordered_multimap<std::size_t, std::weak_ptr<Chunk>> m_Chunks;
+    std::mutex m_Mutex;
+    std::size_t m_Hits;
+    std::size_t m_Misses;
+    std::size_t m_InsertsSincePrune;
+
+    void Prune();
+
+public:
+    MCLIB_API ChunkInterner();
+
+    ChunkInterner(const ChunkInterner& rhs) = delete;
+    ChunkInterner& operator=(const ChunkInterner& rhs) = delete;
+
+    /**
+     * Returns a shared chunk with the same data as the one passed in.
+     * The passed in chunk is stored and returned if no equal chunk exists yet.
+     */
+    ChunkPtr MCLIB_API Intern(ChunkPtr chunk);
+
+    // Number of distinct chunks that are still alive
+    std::size_t MCLIB_API GetSize();
+
+    // Number of chunks that were replaced by an existing copy
+    std::size_t GetHits() const { return m_Hits; }
+    // Number of chunks that were stored as a new copy
+    std::size_t GetMisses() const { return m_Misses; }
+};
+
+} // ns world
+} // ns mc
+
+#endif
@@ -2,28 +2,119 @@
 #define MCLIB_WORLD_WORLD_H_
 
 #include <mclib/world/Chunk.h>
+#include <mclib/world/ChunkInterner.h>
 #include <mclib/protocol/packets/PacketHandler.h>
 #include <mclib/protocol/packets/PacketDispatcher.h>
 #include <mclib/util/ObserverSubject.h>
 
+#include <functional>
 #include <map>
 
 namespace mc {
 namespace world {
 
+struct BlockChange {
+    Vector3i position;
+    block::BlockPtr newBlock;
+    block::BlockPtr oldBlock;
+
+    BlockChange(Vector3i position, block::BlockPtr newBlock, block::BlockPtr oldBlock)
+        : position(position), newBlock(newBlock), oldBlock(oldBlock)
+    {
+
+    }
+};
+
 class MCLIB_API WorldListener {
 public:
     // yIndex is the chunk section index of the column, 0 means bottom chunk, 15 means top
+    // Called for every chunk of a full column and for each chunk of a partial update.
+    // Calls the ChunkPtr overload by default. The chunk can be shared with other columns, so it must not be changed.
+    virtual void OnChunkLoad(ConstChunkPtr chunk, const ChunkColumnMetadata& meta, u16 yIndex) {
+        OnChunkLoad(std::const_pointer_cast<Chunk>(chunk), meta, yIndex);
+    }
+    // Kept for listeners that were written before chunks were shared. Override the ConstChunkPtr overload instead.
     virtual void OnChunkLoad(ChunkPtr chunk, const ChunkColumnMetadata& meta, u16 yIndex) { }
+    // Called once per chunk data packet after OnChunkLoad, with the column that is stored in the world.
+    // Bit n of changedMask is set if chunk n was sent. Chunks that aren't in the mask are air for a full column,
+    // and unchanged for a partial update.
+    virtual void OnColumnLoad(const ChunkColumn& /*column*/, u16 /*changedMask*/) { }
     virtual void OnChunkUnload(ChunkColumnPtr chunk) { }
     virtual void OnBlockChange(Vector3i position, block::BlockPtr newBlock, block::BlockPtr oldBlock) { }
+    // Called once with all of the changes from a multi block change or explosion, after OnBlockChange was called for each of them.
+    virtual void OnBlockChanges(const std::vector<BlockChange>& /*changes*/) { }
+    // Called when a column is evicted to stay under the memory budget.
+    // A compressed column stays in the world until it's restored with World::RestoreChunk or evicted again.
+    // A column that isn't compressed is removed from the world.
+    virtual void OnChunkEvict(ChunkColumnPtr /*chunk*/, bool /*compressed*/) { }
+};
+
+enum class EvictionPolicy {
+    // Evict the columns that were accessed the longest time ago
+    LeastRecentlyUsed,
+    // Evict the columns that are furthest from the eviction center
+    Distance
+};
+
+enum class ChunkStoragePolicy {
+    // Chunks are always kept uncompressed
+    Uncompressed,
+    // Chunks that aren't read or written for the idle time are compressed
+    CompressIdle
 };
 
+struct ChunkStorageStats {
+    // Number of chunks that are currently compressed
+    std::size_t compressedChunks;
+    // Number of bytes saved by the currently compressed chunks
+    std::size_t bytesSaved;
+    // Number of times a chunk was compressed
+    u64 compressions;
+    // Number of times a compressed chunk was accessed and had to be inflated
+    u64 inflations;
+
+    ChunkStorageStats() : compressedChunks(0), bytesSaved(0), compressions(0), inflations(0) { }
+
+    // The fraction of compressed chunks that were accessed again
+    double GetHitRate() const { return compressions > 0 ? (double)inflations / compressions : 0.0; }
+};
+
+struct RaycastResult {
+    bool hit;
+    // Position of the block that was hit
+    Vector3i position;
+    // Point where the ray hit the block bounding box
+    Vector3d point;
+    // Face of the block that was hit
+    Face face;
+    double distance;
+    block::BlockPtr block;
+
+    RaycastResult() : hit(false), face(Face::Bottom), distance(0.0), block(nullptr) { }
+};
+
+// Return true if the block should be tested against the ray
+typedef std::function<bool(block::BlockPtr block, Vector3i position)> RaycastFilter;
+
 class World : public protocol::packets::PacketHandler, public util::ObserverSubject<WorldListener> {
 private:
     typedef std::pair<s32, s32> ChunkCoord;
 
     std::map<ChunkCoord, ChunkColumnPtr> m_Chunks;
+    std::shared_ptr<ChunkInterner> m_ChunkInterner;
+    std::size_t m_MemoryBudget;
+    EvictionPolicy m_EvictionPolicy;
+    Vector3d m_EvictionCenter;
+    bool m_CompressEvicted;
+    // Restoring a column doesn't change the blocks of the world, so the const getters can do it.
+    mutable u64 m_AccessCounter;
+    ChunkStoragePolicy m_StoragePolicy;
+    s64 m_IdleTime;
+    s64 m_LastIdleCheck;
+    ChunkStorageStats m_StorageStats;
+
+    void EvictColumn(std::map<ChunkCoord, ChunkColumnPtr>::iterator iter, bool compress);
+    void RestoreColumn(const ChunkColumnPtr& column) const;
 
     bool MCLIB_API SetBlock(Vector3i position, u32 blockData);
 
@@ -45,14 +136,70 @@ public:
     void MCLIB_API HandlePacket(protocol::packets::in::RespawnPacket* packet);
 
     /**
-     * Pos can be any world position inside of the chunk
+     * Identical chunks from incoming chunk data are shared through the interner.
+     * The same interner can be given to multiple worlds. Set to null to disable.
+     */
+    void SetChunkInterner(std::shared_ptr<ChunkInterner> interner) { m_ChunkInterner = interner; }
+    std::shared_ptr<ChunkInterner> GetChunkInterner() const { return m_ChunkInterner; }
+
+    /**
+     * Limits the approximate memory used by the loaded columns. 0 means no limit.
+     * Columns are evicted according to the eviction policy when a new column pushes the usage over the budget,
+     * until the usage is back under 7/8 of the budget.
+     * Compressed columns are removed furthest from the eviction center first once they use more than half of the budget,
+     * or when there are no uncompressed columns left to evict.
+     */
+    void SetMemoryBudget(std::size_t bytes) { m_MemoryBudget = bytes; }
+    std::size_t GetMemoryBudget() const { return m_MemoryBudget; }
+    void SetEvictionPolicy(EvictionPolicy policy) { m_EvictionPolicy = policy; }
+    EvictionPolicy GetEvictionPolicy() const { return m_EvictionPolicy; }
+    // Used by the distance policy and for removing compressed columns. The client sets this to the player position every update.
+    void SetEvictionCenter(Vector3d center) { m_EvictionCenter = center; }
+    // Compress evicted columns instead of removing them from the world.
+    void SetCompressEvicted(bool compress) { m_CompressEvicted = compress; }
+    bool GetCompressEvicted() const { return m_CompressEvicted; }
+
+    // Approximate number of bytes used by all of the loaded columns, including compressed ones.
+    std::size_t MCLIB_API GetMemoryUsage() const;
+    // Evicts columns until the memory usage is below 7/8 of the budget, if it's over the budget.
+    void MCLIB_API EnforceMemoryBudget();
+
+    /**
+     * Chunks that aren't read or written for idleTime milliseconds are compressed with the CompressIdle policy.
+     * They are inflated transparently on the next access.
+     */
+    void SetStoragePolicy(ChunkStoragePolicy policy, s64 idleTime = 30000) { m_StoragePolicy = policy; m_IdleTime = idleTime; }
+    ChunkStoragePolicy GetStoragePolicy() const { return m_StoragePolicy; }
+    const ChunkStorageStats& GetStorageStats() const { return m_StorageStats; }
+
+    // Compresses the chunks that weren't accessed since the last call and updates the storage stats.
+    void MCLIB_API CompressIdleChunks();
+    // Runs the periodic storage work. Called by the client every tick.
+    void MCLIB_API Update();
+
+    /**
+     * Pos can be any world position inside of the chunk.
+     * The column is returned as it's stored, so it can be compressed by eviction. Use RestoreChunk to read its chunks.
      */
     ChunkColumnPtr MCLIB_API GetChunk(Vector3i pos) const;
 
+    /**
+     * Gets the column like GetChunk, restores it if it was compressed by eviction and marks it as recently used.
+     */
+    ChunkColumnPtr MCLIB_API RestoreChunk(Vector3i pos);
+
+    // The column is restored through RestoreChunk if it was compressed by eviction.
     block::BlockPtr MCLIB_API GetBlock(Vector3d pos) const;
     block::BlockPtr MCLIB_API GetBlock(Vector3f pos) const;
     block::BlockPtr MCLIB_API GetBlock(Vector3i pos) const;
 
+    /**
+     * Walks the blocks along the ray and returns the first block bounding box that is hit within maxDistance.
+     * Air and unloaded chunks are skipped without reading blocks. Blocks are only tested if they pass the filter.
+     * The direction doesn't need to be normalized. Columns compressed by eviction are restored.
+     */
+    MCLIB_API RaycastResult Raycast(Vector3d origin, Vector3d direction, double maxDistance, RaycastFilter filter = nullptr);
+
     MCLIB_API block::BlockEntityPtr GetBlockEntity(Vector3i pos) const;
     // Gets all of the known block entities in loaded chunks
     MCLIB_API std::vector<block::BlockEntityPtr> GetBlockEntities() const;
@@ -1,5 +1,8 @@
 #include <mclib/block/Banner.h>
 
+#include <mclib/common/MCString.h>
+#include <mclib/nbt/NBTReader.h>
+
 namespace mc {
 namespace block {
 
@@ -37,5 +40,85 @@ bool Banner::ImportNBT(nbt::NBT* nbt) {
     return true;
 }
 
+bool Banner::ImportNBT(DataBuffer& in) {
+    class PatternVisitor : public nbt::NBTVisitor {
+    public:
+        std::vector<Pattern>& patterns;
+        s32 color;
+        std::string section;
+        int found;
+        bool valid;
+
+        PatternVisitor(std::vector<Pattern>& patterns) : patterns(patterns), color(0), found(0), valid(true) { }
+
+        NBTVisitor* OnCompoundBegin(const std::string& /*name*/) override {
+            found = 0;
+            return this;
+        }
+
+        void OnCompoundEnd() override {
+            if (found != 3) {
+                valid = false;
+                return;
+            }
+
+            Pattern pattern;
+
+            pattern.color = static_cast<DyeColor>(color);
+            pattern.section = utf8to16(section);
+
+            patterns.push_back(pattern);
+        }
+
+        void OnInt(const std::string& name, s32 value) override {
+            if (name == "Color") {
+                color = value;
+                found |= 1;
+            }
+        }
+
+        void OnString(const std::string& name, const std::string& value) override {
+            if (name == "Pattern") {
+                section = value;
+                found |= 2;
+            }
+        }
+    };
+
+    class BannerVisitor : public nbt::RootVisitor {
+    public:
+        Banner& banner;
+        PatternVisitor patterns;
+        bool hasBase;
+
+        BannerVisitor(Banner& banner) : banner(banner), patterns(banner.m_Patterns), hasBase(false) { }
+
+        NBTVisitor* OnListBegin(const std::string& name, nbt::TagType elementType, s32 /*size*/) override {
+            if (name == "Patterns" && elementType == nbt::TagType::Compound)
+                return &patterns;
+            return nullptr;
+        }
+
+        void OnString(const std::string& name, const std::string& value) override {
+            if (name == "CustomName")
+                banner.SetCustomName(utf8to16(value));
+        }
+
+        void OnInt(const std::string& name, s32 value) override {
+            if (name == "Base") {
+                banner.m_Base = static_cast<DyeColor>(value);
+                hasBase = true;
+            }
+        }
+    };
+
+    BannerVisitor visitor(*this);
+    nbt::NBTReader reader(in);
+
+    reader.Read(visitor);
+
+    return visitor.hasBase && visitor.patterns.valid;
+}
+
 } // ns block
 } // ns mc
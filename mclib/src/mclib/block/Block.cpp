@@ -1467,6 +1467,14 @@ void BlockRegistry::ClearRegistry() {
 }
 
 BlockPtr BlockRegistry::GetBlock(const std::string& name) const {
+    // Names that were never interned can't belong to a block.
+    util::InternedString interned = util::InternedString::Find(name);
+    if (interned.empty()) return nullptr;
+
+    return GetBlock(interned);
+}
+
+BlockPtr BlockRegistry::GetBlock(util::InternedString name) const {
     auto iter = m_BlockNames.find(name);
     if (iter == m_BlockNames.end()) return nullptr;
     return iter->second;
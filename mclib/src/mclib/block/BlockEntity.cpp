@@ -21,43 +21,48 @@
 #include <mclib/block/Sign.h>
 #include <mclib/block/Skull.h>
 
+#include <mclib/common/DataBuffer.h>
+#include <mclib/common/MCString.h>
+#include <mclib/nbt/NBTReader.h>
+#include <mclib/util/InternedString.h>
+
 #include <unordered_map>
 
 namespace mc {
 namespace block {
 
-static const std::unordered_map<std::wstring, BlockEntityType> blockEntityTypes =
+static const std::unordered_map<util::InternedString, BlockEntityType> blockEntityTypes =
 {
-    { L"minecraft:banner", BlockEntityType::Banner },
-    { L"minecraft:beacon", BlockEntityType::Beacon },
-    { L"minecraft:bed", BlockEntityType::Bed },
-    { L"minecraft:cauldron", BlockEntityType::Cauldron },
-    { L"minecraft:brewing_stand", BlockEntityType::BrewingStand },
-    { L"minecraft:chest", BlockEntityType::Chest },
-    { L"minecraft:comparator", BlockEntityType::Comparator },
-    { L"minecraft:command_block", BlockEntityType::CommandBlock },
-    { L"minecraft:daylight_detector", BlockEntityType::DaylightSensor },
-    { L"minecraft:dispenser", BlockEntityType::Dispenser },
-    { L"minecraft:dropper", BlockEntityType::Dropper },
-    { L"minecraft:enchanting_table", BlockEntityType::EnchantingTable },
-    { L"minecraft:ender_chest", BlockEntityType::EnderChest },
-    { L"minecraft:end_gateway", BlockEntityType::EndGateway },
-    { L"minecraft:end_portal", BlockEntityType::EndPortal },
-    { L"minecraft:flower_pot", BlockEntityType::FlowerPot },
-    { L"minecraft:furnace", BlockEntityType::Furnace },
-    { L"minecraft:hopper", BlockEntityType::Hopper },
-    { L"minecraft:jukebox", BlockEntityType::Jukebox },
-    { L"minecraft:mob_spawner", BlockEntityType::MonsterSpawner },
-    { L"minecraft:noteblock", BlockEntityType::Noteblock },
-    { L"minecraft:piston", BlockEntityType::Piston },
-    { L"minecraft:sign", BlockEntityType::Sign },
-    { L"minecraft:skull", BlockEntityType::Skull },
-    { L"minecraft:structure_block", BlockEntityType::StructureBlock },
-    { L"minecraft:trapped_chest", BlockEntityType::TrappedChest }
+    { util::InternedString("minecraft:banner"), BlockEntityType::Banner },
+    { util::InternedString("minecraft:beacon"), BlockEntityType::Beacon },
+    { util::InternedString("minecraft:bed"), BlockEntityType::Bed },
+    { util::InternedString("minecraft:cauldron"), BlockEntityType::Cauldron },
+    { util::InternedString("minecraft:brewing_stand"), BlockEntityType::BrewingStand },
+    { util::InternedString("minecraft:chest"), BlockEntityType::Chest },
+    { util::InternedString("minecraft:comparator"), BlockEntityType::Comparator },
+    { util::InternedString("minecraft:command_block"), BlockEntityType::CommandBlock },
+    { util::InternedString("minecraft:daylight_detector"), BlockEntityType::DaylightSensor },
+    { util::InternedString("minecraft:dispenser"), BlockEntityType::Dispenser },
+    { util::InternedString("minecraft:dropper"), BlockEntityType::Dropper },
+    { util::InternedString("minecraft:enchanting_table"), BlockEntityType::EnchantingTable },
+    { util::InternedString("minecraft:ender_chest"), BlockEntityType::EnderChest },
+    { util::InternedString("minecraft:end_gateway"), BlockEntityType::EndGateway },
+    { util::InternedString("minecraft:end_portal"), BlockEntityType::EndPortal },
+    { util::InternedString("minecraft:flower_pot"), BlockEntityType::FlowerPot },
+    { util::InternedString("minecraft:furnace"), BlockEntityType::Furnace },
+    { util::InternedString("minecraft:hopper"), BlockEntityType::Hopper },
+    { util::InternedString("minecraft:jukebox"), BlockEntityType::Jukebox },
+    { util::InternedString("minecraft:mob_spawner"), BlockEntityType::MonsterSpawner },
+    { util::InternedString("minecraft:noteblock"), BlockEntityType::Noteblock },
+    { util::InternedString("minecraft:piston"), BlockEntityType::Piston },
+    { util::InternedString("minecraft:sign"), BlockEntityType::Sign },
+    { util::InternedString("minecraft:skull"), BlockEntityType::Skull },
+    { util::InternedString("minecraft:structure_block"), BlockEntityType::StructureBlock },
+    { util::InternedString("minecraft:trapped_chest"), BlockEntityType::TrappedChest }
 };
 
-BlockEntityType GetTypeFromString(const std::wstring& str) {
-    auto iter = blockEntityTypes.find(str);
+BlockEntityType GetTypeFromString(const std::string& str) {
+    auto iter = blockEntityTypes.find(util::InternedString::Find(str));
     if (iter == blockEntityTypes.end()) return BlockEntityType::Unknown;
 
     return iter->second;
@@ -69,23 +74,7 @@ BlockEntity::BlockEntity(BlockEntityType type, Vector3i position) noexcept
 
 }
 
-std::unique_ptr<BlockEntity> BlockEntity::CreateFromNBT(nbt::NBT* nbt) {
-    auto idTag = nbt->GetTag<nbt::TagString>(L"id");
-    auto xTag = nbt->GetTag<nbt::TagInt>(L"x");
-    auto yTag = nbt->GetTag<nbt::TagInt>(L"y");
-    auto zTag = nbt->GetTag<nbt::TagInt>(L"z");
-
-    if (idTag == nullptr || xTag == nullptr || yTag == nullptr || zTag == nullptr)
-        return nullptr;
-
-    std::wstring id = idTag->GetValue();
-    auto x = xTag->GetValue();
-    auto y = yTag->GetValue();
-    auto z = zTag->GetValue();
-
-    Vector3i position(x, y, z);
-    BlockEntityType type = GetTypeFromString(id);
-
+std::unique_ptr<BlockEntity> BlockEntity::Create(BlockEntityType type, Vector3i position) {
     std::unique_ptr<BlockEntity> entity;
 
     switch (type) {
@@ -152,16 +141,114 @@ std::unique_ptr<BlockEntity> BlockEntity::CreateFromNBT(nbt::NBT* nbt) {
         case BlockEntityType::TrappedChest:
             entity = std::make_unique<Chest>(type, position);
             break;
-        
+
         default:
-            entity = std::make_unique<BlockEntity>(type, position);
+            break;
     }
 
+    return entity;
+}
+
+std::unique_ptr<BlockEntity> BlockEntity::CreateFromNBT(nbt::NBT* nbt) {
+    auto idTag = nbt->GetTag<nbt::TagString>(L"id");
+    auto xTag = nbt->GetTag<nbt::TagInt>(L"x");
+    auto yTag = nbt->GetTag<nbt::TagInt>(L"y");
+    auto zTag = nbt->GetTag<nbt::TagInt>(L"z");
+
+    if (idTag == nullptr || xTag == nullptr || yTag == nullptr || zTag == nullptr)
+        return nullptr;
+
+    std::wstring id = idTag->GetValue();
+    auto x = xTag->GetValue();
+    auto y = yTag->GetValue();
+    auto z = zTag->GetValue();
+
+    Vector3i position(x, y, z);
+    BlockEntityType type = GetTypeFromString(utf16to8(id));
+
+    std::unique_ptr<BlockEntity> entity = Create(type, position);
+
+    if (!entity)
+        entity = std::make_unique<BlockEntity>(type, position);
+
     entity->ImportNBT(nbt);
     entity->m_NBT = *nbt;
 
     return entity;
 }
 
+namespace {
+
+// Reads the id and position of a block entity.
+class HeaderVisitor : public nbt::RootVisitor {
+public:
+    std::string id;
+    s32 x, y, z;
+    int found;
+
+    HeaderVisitor() : x(0), y(0), z(0), found(0) { }
+
+    void OnString(const std::string& name, const std::string& value) override {
+        if (name == "id") {
+            id = value;
+            found |= 1;
+        }
+    }
+
+    void OnInt(const std::string& name, s32 value) override {
+        if (name == "x") {
+            x = value;
+            found |= 2;
+        } else if (name == "y") {
+            y = value;
+            found |= 4;
+        } else if (name == "z") {
+            z = value;
+            found |= 8;
+        }
+    }
+};
+
+} // ns
+
+std::unique_ptr<BlockEntity> BlockEntity::CreateFromNBT(DataBuffer& in) {
+    std::size_t begin = in.GetReadOffset();
+    HeaderVisitor header;
+    nbt::NBTReader reader(in);
+
+    if (!reader.Read(header) || header.found != 0xF) return nullptr;
+
+    Vector3i position(header.x, header.y, header.z);
+    BlockEntityType type = GetTypeFromString(header.id);
+    std::unique_ptr<BlockEntity> entity = Create(type, position);
+
+    std::string raw(in.begin() + begin, in.begin() + in.GetReadOffset());
+
+    if (entity) {
+        DataBuffer data(raw);
+
+        entity->ImportNBT(data);
+    } else {
+        entity = std::make_unique<BlockEntity>(type, position);
+    }
+
+    entity->m_View = nbt::NBTView::Parse(std::move(raw));
+
+    return entity;
+}
+
+bool BlockEntity::ImportNBT(DataBuffer& in) {
+    in >> m_NBT;
+    return ImportNBT(&m_NBT);
+}
+
+nbt::NBT* BlockEntity::GetNBT() {
+    // The tree might have been built by the import already.
+    if (!m_NBT.HasData() && m_View)
+        m_NBT = m_View.ToNBT();
+
+    return &m_NBT;
+}
+
 } // ns block
 } // ns mc
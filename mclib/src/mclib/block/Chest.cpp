@@ -1,5 +1,7 @@
 #include <mclib/block/Chest.h>
 
+#include <mclib/common/MCString.h>
+
 namespace mc {
 namespace block {
 
@@ -13,5 +15,28 @@ bool Chest::ImportNBT(nbt::NBT* nbt) {
     return InventoryBlock::ImportNBT(nbt);
 }
 
+bool Chest::ImportNBT(DataBuffer& in) {
+    class ChestImporter : public Importer {
+    public:
+        Chest& chest;
+
+        ChestImporter(Chest& chest) : Importer(chest), chest(chest) { }
+
+        void OnString(const std::string& name, const std::string& value) override {
+            if (name == "CustomName")
+                chest.SetCustomName(utf8to16(value));
+            else
+                Importer::OnString(name, value);
+        }
+    };
+
+    ChestImporter importer(*this);
+    nbt::NBTReader reader(in);
+
+    reader.Read(importer);
+
+    return importer.Finish();
+}
+
 } // ns block
 } // ns mc
@@ -1,5 +1,7 @@
 #include <mclib/block/InventoryBlock.h>
 
+#include <mclib/common/MCString.h>
+
 namespace mc {
 namespace block {
 
@@ -33,5 +35,41 @@ bool InventoryBlock::ImportNBT(nbt::NBT* nbt) {
     return true;
 }
 
+nbt::NBTVisitor* InventoryBlock::Importer::OnListBegin(const std::string& name, nbt::TagType elementType, s32 /*size*/) {
+    if (name != "Items" || elementType != nbt::TagType::Compound) return nullptr;
+
+    m_HasItems = true;
+    return &m_Items;
+}
+
+void InventoryBlock::Importer::OnString(const std::string& name, const std::string& value) {
+    if (name == "Lock")
+        m_Block.m_Lock = utf8to16(value);
+    else if (name == "LootTable")
+        m_Block.m_LootTable = utf8to16(value);
+}
+
+void InventoryBlock::Importer::OnInt(const std::string& name, s32 value) {
+    if (name == "LootTableSeed")
+        m_Block.m_LootTableSeed = value;
+}
+
+void InventoryBlock::Importer::OnLong(const std::string& name, s64 value) {
+    if (name == "LootTableSeed")
+        m_Block.m_LootTableSeed = value;
+}
+
+bool InventoryBlock::Importer::Finish() {
+    if (!m_HasItems) return false;
+
+    for (const auto& item : m_Items.GetItems()) {
+        if (item.index < 0) return false;
+
+        m_Block.m_Items.insert(std::make_pair((u8)item.index, item.slot));
+    }
+
+    return true;
+}
+
 } // ns block
 } // ns mc
@@ -1,5 +1,8 @@
 #include <mclib/block/Sign.h>
 
+#include <mclib/common/MCString.h>
+#include <mclib/nbt/NBTReader.h>
+
 namespace mc {
 namespace block {
 
@@ -23,6 +26,32 @@ bool Sign::ImportNBT(nbt::NBT* nbt) {
     return textCount == 4;
 }
 
+bool Sign::ImportNBT(DataBuffer& in) {
+    class TextVisitor : public nbt::RootVisitor {
+    public:
+        std::array<std::wstring, 4>& text;
+        s32 count;
+
+        TextVisitor(std::array<std::wstring, 4>& text) : text(text), count(0) { }
+
+        void OnString(const std::string& name, const std::string& value) override {
+            if (name.size() != 5 || name.compare(0, 4, "Text") != 0) return;
+            if (name[4] < '1' || name[4] > '4') return;
+
+            text[name[4] - '1'] = utf8to16(value);
+            ++count;
+        }
+    };
+
+    TextVisitor visitor(m_Text);
+    nbt::NBTReader reader(in);
+
+    reader.Read(visitor);
+
+    // There must be 4 text lines to be considered valid.
+    return visitor.count == 4;
+}
+
 const std::wstring& Sign::GetText(std::size_t index) const {
     return m_Text[index];
 }
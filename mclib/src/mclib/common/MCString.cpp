@@ -2,61 +2,269 @@
 
 #include <mclib/common/DataBuffer.h>
 #include <mclib/common/VarInt.h>
-#include <codecvt>
-#include <locale>
+
+#include <cstring>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MCLIB_UTF8_SSE2
+#endif
 
 namespace mc {
 
+namespace {
+
+const u32 ReplacementCharacter = 0xFFFD;
+
+// Number of ASCII bytes at the start of data. Most protocol strings are entirely ASCII.
+std::size_t CountASCII(const u8* data, std::size_t size) {
+    std::size_t i = 0;
+
+#ifdef MCLIB_UTF8_SSE2
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(data + i));
+
+        if (_mm_movemask_epi8(chunk) != 0) break;
+    }
+#endif
+
+    for (; i + 8 <= size; i += 8) {
+        u64 word;
+
+        std::memcpy(&word, data + i, sizeof(word));
+        if (word & 0x8080808080808080ULL) break;
+    }
+
+    while (i < size && data[i] < 0x80)
+        ++i;
+
+    return i;
+}
+
+/**
+ * Decodes the multi-byte sequence at data[i] and moves i past it.
+ * Invalid sequences, overlong encodings, surrogates and values above U+10FFFF only consume their first byte
+ * and decode to U+FFFD with valid set to false.
+ */
+u32 DecodeSequence(const u8* data, std::size_t size, std::size_t& i, bool& valid) {
+    u8 lead = data[i];
+    std::size_t length;
+    u32 codePoint;
+    u32 min;
+
+    if ((lead & 0xE0) == 0xC0) {
+        length = 2;
+        codePoint = lead & 0x1F;
+        min = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        length = 3;
+        codePoint = lead & 0x0F;
+        min = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        length = 4;
+        codePoint = lead & 0x07;
+        min = 0x10000;
+    } else {
+        length = 0;
+    }
+
+    if (length == 0 || size - i < length) {
+        ++i;
+        valid = false;
+        return ReplacementCharacter;
+    }
+
+    for (std::size_t k = 1; k < length; ++k) {
+        u8 c = data[i + k];
+
+        if ((c & 0xC0) != 0x80) {
+            ++i;
+            valid = false;
+            return ReplacementCharacter;
+        }
+
+        codePoint = (codePoint << 6) | (c & 0x3F);
+    }
+
+    if (codePoint < min || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+        ++i;
+        valid = false;
+        return ReplacementCharacter;
+    }
+
+    i += length;
+    return codePoint;
+}
+
+void EncodeCodePoint(u32 codePoint, std::string& out) {
+    if (codePoint < 0x80) {
+        out.push_back((char)codePoint);
+    } else if (codePoint < 0x800) {
+        out.push_back((char)(0xC0 | (codePoint >> 6)));
+        out.push_back((char)(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+        out.push_back((char)(0xE0 | (codePoint >> 12)));
+        out.push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (codePoint & 0x3F)));
+    } else {
+        out.push_back((char)(0xF0 | (codePoint >> 18)));
+        out.push_back((char)(0x80 | ((codePoint >> 12) & 0x3F)));
+        out.push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (codePoint & 0x3F)));
+    }
+}
+
+} // ns
+
 MCString::MCString() {
 
 }
 
-MCString::MCString(const std::string& str) : m_UTF16(str.begin(), str.end())
+MCString::MCString(const std::string& utf8) : m_UTF8(utf8)
 {
+    if (!IsValidUTF8(m_UTF8.data(), m_UTF8.size()))
+        m_UTF8 = SanitizeUTF8(m_UTF8);
 }
 
-MCString::MCString(const std::wstring& str) : m_UTF16(str)
+MCString::MCString(std::string&& utf8) : m_UTF8(std::move(utf8))
 {
+    if (!IsValidUTF8(m_UTF8.data(), m_UTF8.size()))
+        m_UTF8 = SanitizeUTF8(m_UTF8);
 }
 
-std::wstring MCString::GetUTF16() const { return m_UTF16; }
-std::string MCString::GetUTF8() const {
-    return utf16to8(m_UTF16);
+MCString::MCString(const std::wstring& str) : m_UTF8(utf16to8(str))
+{
+}
+
+std::wstring MCString::GetUTF16() const {
+    return utf8to16(m_UTF8);
 }
 
 MCString MCString::FromUTF8(const std::string& utf8) {
-    return MCString(utf8to16(utf8));
+    return MCString(utf8);
 }
 
 DataBuffer& operator<<(DataBuffer& out, const MCString& str) {
-    std::string utf8 = utf16to8(str.m_UTF16);
-
-    VarInt bytes = (s32)utf8.size();
+    VarInt bytes = (s32)str.m_UTF8.size();
     out << bytes;
-    out << utf8;
+    out << str.m_UTF8;
 
     return out;
 }
+
 DataBuffer& operator>>(DataBuffer& in, MCString& str) {
     VarInt bytes;
     in >> bytes;
 
-    std::string utf8;
-    in.ReadSome(utf8, bytes.GetInt());
+    in.ReadSome(str.m_UTF8, bytes.GetInt());
 
-    str.m_UTF16 = utf8to16(utf8);
+    if (!IsValidUTF8(str.m_UTF8.data(), str.m_UTF8.size()))
+        str.m_UTF8 = SanitizeUTF8(str.m_UTF8);
 
     return in;
 }
 
-std::string utf16to8(std::wstring str) {
-    std::wstring_convert<std::codecvt_utf8<wchar_t>> myconv;
-    return myconv.to_bytes(str);
+bool IsValidUTF8(const char* data, std::size_t size) {
+    const u8* bytes = (const u8*)data;
+    std::size_t i = 0;
+    bool valid = true;
+
+    while (true) {
+        i += CountASCII(bytes + i, size - i);
+        if (i == size) return true;
+
+        DecodeSequence(bytes, size, i, valid);
+        if (!valid) return false;
+    }
+}
+
+std::string SanitizeUTF8(const std::string& str) {
+    const u8* bytes = (const u8*)str.data();
+    std::size_t size = str.size();
+    std::string result;
+    std::size_t i = 0;
+
+    result.reserve(size);
+
+    while (i < size) {
+        std::size_t ascii = CountASCII(bytes + i, size - i);
+
+        result.append(str, i, ascii);
+        i += ascii;
+
+        if (i == size) break;
+
+        bool valid = true;
+        EncodeCodePoint(DecodeSequence(bytes, size, i, valid), result);
+    }
+
+    return result;
+}
+
+std::string utf16to8(const std::wstring& str) {
+    typedef std::make_unsigned<wchar_t>::type Unit;
+    std::string result;
+    std::size_t size = str.size();
+
+    result.reserve(size);
+
+    for (std::size_t i = 0; i < size; ++i) {
+        u32 c = (Unit)str[i];
+
+        if (c < 0x80) {
+            result.push_back((char)c);
+            continue;
+        }
+
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < size) {
+            u32 low = (Unit)str[i + 1];
+
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            }
+        }
+
+        // Unpaired surrogates can't be encoded.
+        if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF)
+            c = ReplacementCharacter;
+
+        EncodeCodePoint(c, result);
+    }
+
+    return result;
 }
 
-std::wstring utf8to16(std::string str) {
-    std::wstring_convert<std::codecvt_utf8<wchar_t>> myconv;
-    return myconv.from_bytes(str);
+std::wstring utf8to16(const std::string& str) {
+    const u8* bytes = (const u8*)str.data();
+    std::size_t size = str.size();
+    std::wstring result;
+    std::size_t i = 0;
+
+    result.reserve(size);
+
+    while (i < size) {
+        std::size_t ascii = CountASCII(bytes + i, size - i);
+
+        result.append(bytes + i, bytes + i + ascii);
+        i += ascii;
+
+        if (i == size) break;
+
+        bool valid = true;
+        u32 codePoint = DecodeSequence(bytes, size, i, valid);
+
+        if (sizeof(wchar_t) == 2 && codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            result.push_back((wchar_t)(0xD800 + (codePoint >> 10)));
+            result.push_back((wchar_t)(0xDC00 + (codePoint & 0x3FF)));
+        } else {
+            result.push_back((wchar_t)codePoint);
+        }
+    }
+
+    return result;
 }
 
 } // ns mc
@@ -1,6 +1,7 @@
 #include <mclib/core/Client.h>
 #include <mclib/util/Utility.h>
 
+#include <atomic>
 #include <iostream>
 
 // These were changed in MSVC 2015. Redefine them so the old lib files link correctly.
@@ -14,6 +15,22 @@ int (WINAPIV * _fprintf)(FILE* const, char const*, ...) = fprintf;
 namespace mc {
 namespace core {
 
+// Spreads the ticks of the clients in this process over the tick interval.
+static s64 GetNextTickPhase(s64 interval) {
+    static std::atomic<u32> clients(0);
+
+    // Reverse the bits of the client index to get a fraction of the interval.
+    // Every new client lands in the middle of the largest gap, so the phases stay spread over the whole interval.
+    u32 index = clients++;
+    u32 reversed = 0;
+    for (int i = 0; i < 32; ++i) {
+        reversed = (reversed << 1) | (index & 1);
+        index >>= 1;
+    }
+
+    return (s64)(((u64)reversed * (u64)interval) >> 32);
+}
+
 Client::Client(protocol::packets::PacketDispatcher* dispatcher, protocol::Version version)
     : m_Dispatcher(dispatcher),
     m_Connection(m_Dispatcher, version),
@@ -21,11 +38,12 @@ Client::Client(protocol::packets::PacketDispatcher* dispatcher, protocol::Versio
     m_PlayerManager(m_Dispatcher, &m_EntityManager),
     m_World(m_Dispatcher),
     m_PlayerController(std::make_unique<util::PlayerController>(&m_Connection, m_World, m_PlayerManager)),
-    m_LastUpdate(0),
+    m_TickScheduler(1000 / 20),
     m_Connected(false),
     m_InventoryManager(std::make_unique<inventory::InventoryManager>(m_Dispatcher, &m_Connection)),
     m_Hotbar(m_Dispatcher, &m_Connection, m_InventoryManager.get())
 {
+    m_TickScheduler.SetPhase(GetNextTickPhase(m_TickScheduler.GetInterval()));
     m_Connection.RegisterListener(this);
 }
 
@@ -48,24 +66,36 @@ void Client::Update() {
         std::wcout << e.what() << std::endl;
     }
 
+    m_World.SetEvictionCenter(m_PlayerController->GetPosition());
+
+    u32 ticks = m_TickScheduler.Poll(util::TickScheduler::GetTime());
+
+    for (u32 i = 0; i < ticks; ++i)
+        Tick();
+}
+
+void Client::Tick() {
+    m_EntityManager.UpdatePredictions(util::TickScheduler::GetTime());
+    m_PlayerController->Update();
+
+    // Keep entity manager and player controller in sync. This records the motion history once per tick.
     entity::EntityPtr playerEntity = m_EntityManager.GetPlayerEntity();
-    if (playerEntity) {
-        // Keep entity manager and player controller in sync
-        playerEntity->SetPosition(m_PlayerController->GetPosition());
-    }
+    if (playerEntity)
+        m_EntityManager.SetEntityPosition(playerEntity->GetEntityId(), m_PlayerController->GetPosition());
 
-    s64 time = util::GetTime();
-    if (time >= m_LastUpdate + (1000 / 20)) {
-        m_PlayerController->Update();
-        NotifyListeners(&ClientListener::OnTick);
-        m_LastUpdate = time;
-    }
+    m_World.Update();
+    NotifyListeners(&ClientListener::OnTick);
 }
 
 void Client::UpdateThread() {
     while (m_Connected) {
         Update();
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        // Sleep until the next tick unless packets arrive before it.
+        s64 timeout = m_TickScheduler.GetTimeUntilNextTick(util::TickScheduler::GetTime());
+
+        if (timeout > 0)
+            m_Connection.WaitForData(timeout);
     }
 }
 
@@ -77,7 +107,7 @@ bool Client::Login(const std::string& host, unsigned short port,
         m_UpdateThread.join();
     }
 
-    m_LastUpdate = 0;
+    m_TickScheduler.Reset();
 
     if (!m_Connection.Connect(host, port))
         throw std::runtime_error("Could not connect to server");
@@ -101,7 +131,7 @@ bool Client::Login(const std::string& host, unsigned short port,
         m_UpdateThread.join();
     }
 
-    m_LastUpdate = 0;
+    m_TickScheduler.Reset();
 
     if (!m_Connection.Connect(host, port))
         throw std::runtime_error("Could not connect to server");
@@ -49,6 +49,10 @@ network::Socket::Status Connection::GetSocketState() const {
     return m_Socket->GetStatus();
 }
 
+bool Connection::WaitForData(s64 timeout) {
+    return m_Socket->WaitForData(timeout);
+}
+
 void Connection::HandlePacket(protocol::packets::in::JoinGamePacket* packet) {
     m_Dimension = packet->GetDimension();
 }
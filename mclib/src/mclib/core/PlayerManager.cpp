@@ -30,13 +30,37 @@ PlayerManager::iterator PlayerManager::end() {
     return m_Players.end();
 }
 
+void PlayerManager::RemoveFromEntityIndex(const PlayerPtr& player) {
+    if (!player->m_Indexed) return;
+
+    auto iter = m_EntityPlayers.find(player->m_IndexedEntityId);
+
+    if (iter != m_EntityPlayers.end() && iter->second == player)
+        m_EntityPlayers.erase(iter);
+
+    player->m_Indexed = false;
+}
+
+void PlayerManager::SetPlayerEntity(const PlayerPtr& player, entity::PlayerEntityPtr entity) {
+    RemoveFromEntityIndex(player);
+
+    player->SetEntity(entity);
+
+    auto spawned = entity.lock();
+    if (spawned) {
+        m_EntityPlayers[spawned->GetEntityId()] = player;
+        player->m_IndexedEntityId = spawned->GetEntityId();
+        player->m_Indexed = true;
+    }
+}
+
 void PlayerManager::OnPlayerSpawn(entity::PlayerEntityPtr entity, UUID uuid) {
-    auto iter = m_Players.find(uuid);
+    PlayerPtr& player = m_Players[uuid];
 
-    if (iter == m_Players.end())
-        m_Players[uuid] = std::make_shared<Player>(uuid, L"");
+    if (!player)
+        player = std::make_shared<Player>(uuid, L"");
 
-    m_Players[uuid]->SetEntity(entity);
+    SetPlayerEntity(player, entity);
 
     NotifyListeners(&PlayerListener::OnPlayerSpawn, m_Players[uuid]);
 }
@@ -47,7 +71,7 @@ void PlayerManager::OnEntityDestroy(entity::EntityPtr entity) {
     auto player = GetPlayerByEntityId(eid);
 
     if (player) {
-        player->SetEntity(entity::PlayerEntityPtr());
+        SetPlayerEntity(player, entity::PlayerEntityPtr());
         NotifyListeners(&PlayerListener::OnPlayerDestroy, player, eid);
     }
 }
@@ -71,23 +95,31 @@ PlayerPtr PlayerManager::GetPlayerByUUID(UUID uuid) const {
 }
 
 PlayerPtr PlayerManager::GetPlayerByEntityId(EntityId eid) const {
-    auto iter = std::find_if(m_Players.begin(), m_Players.end(), [eid](std::pair<UUID, PlayerPtr> kv) {
-        PlayerPtr player = kv.second;
-        auto ptr = player->GetEntity();
-        if (!ptr) return false;
-        return ptr->GetEntityId() == eid;
-    });
+    auto iter = m_EntityPlayers.find(eid);
+    if (iter == m_EntityPlayers.end()) return nullptr;
 
-    if (iter != m_Players.end())
-        return iter->second;
+    // The entity manager can replace the entity without destroying it first.
+    auto entity = iter->second->GetEntity();
+    if (!entity || entity->GetEntityId() != eid) return nullptr;
 
-    return nullptr;
+    return iter->second;
 }
 
 PlayerPtr PlayerManager::GetPlayerByName(const std::wstring& name) const {
-    auto iter = std::find_if(m_Players.begin(), m_Players.end(), [name](std::pair<UUID, PlayerPtr> kv) {
-        PlayerPtr player = kv.second;
-        return player->GetName().compare(name) == 0;
+    util::InternedString interned = util::InternedString::Find(utf16to8(name));
+
+    // No player has a name that was never interned.
+    if (interned.empty()) return nullptr;
+
+    return GetPlayerByName(interned);
+}
+
+PlayerPtr PlayerManager::GetPlayerByName(util::InternedString name) const {
+    // Players that haven't joined yet have no name, they can't be looked up by it.
+    if (name.empty()) return nullptr;
+
+    auto iter = std::find_if(m_Players.begin(), m_Players.end(), [name](const std::pair<const UUID, PlayerPtr>& kv) {
+        return kv.second->m_Name == name;
     });
 
     if (iter != m_Players.end())
@@ -107,7 +139,7 @@ void PlayerManager::HandlePacket(protocol::packets::in::PlayerPositionAndLookPac
     if (iter == m_Players.end()) {
         m_Players[m_ClientUUID] = std::make_shared<Player>(m_ClientUUID, L"");
     }
-    m_Players[m_ClientUUID]->SetEntity(player);
+    SetPlayerEntity(m_Players[m_ClientUUID], player);
 
     NotifyListeners(&PlayerListener::OnClientSpawn, m_Players[m_ClientUUID]);
 }
@@ -127,7 +159,8 @@ void PlayerManager::HandlePacket(protocol::packets::in::PlayerListItemPacket* pa
             if (iter != m_Players.end()) {
                 bool newPlayer = iter->second->m_Name.empty();
                 if (newPlayer) {
-                    iter->second->m_Name = actionData->name;
+                    // The name stays interned after the player leaves, see InternedString.
+                    iter->second->m_Name = util::InternedString(actionData->name);
                     NotifyListeners(&PlayerListener::OnPlayerJoin, m_Players[uuid]);
                 }
                 continue;
@@ -145,6 +178,8 @@ void PlayerManager::HandlePacket(protocol::packets::in::PlayerListItemPacket* pa
 
             NotifyListeners(&PlayerListener::OnPlayerLeave, m_Players[uuid]);
 
+            RemoveFromEntityIndex(m_Players[uuid]);
+
             m_Players.erase(uuid);
         }
     }
@@ -0,0 +1,55 @@
+#include <mclib/entity/EntityGrid.h>
+
+#include <algorithm>
+
+namespace mc {
+namespace entity {
+
+static void RemoveFromCell(EntityGrid::CellMap& cells, Vector3i cell, EntityId eid) {
+    auto iter = cells.find(cell);
+    if (iter == cells.end()) return;
+
+    std::vector<EntityId>& entities = iter->second;
+    auto found = std::find(entities.begin(), entities.end(), eid);
+
+    if (found != entities.end()) {
+        *found = entities.back();
+        entities.pop_back();
+    }
+
+    if (entities.empty())
+        cells.erase(iter);
+}
+
+void EntityGrid::Insert(EntityId eid, const Vector3d& position) {
+    Vector3i cell = GetCell(position);
+    auto iter = m_EntityCells.find(eid);
+
+    if (iter != m_EntityCells.end()) {
+        // Most moves stay inside of the same cell.
+        if (iter->second == cell) return;
+
+        RemoveFromCell(m_Cells, iter->second, eid);
+        iter->second = cell;
+    } else {
+        m_EntityCells.emplace(eid, cell);
+    }
+
+    m_Cells[cell].push_back(eid);
+}
+
+void EntityGrid::Remove(EntityId eid) {
+    auto iter = m_EntityCells.find(eid);
+    if (iter == m_EntityCells.end()) return;
+
+    RemoveFromCell(m_Cells, iter->second, eid);
+    m_EntityCells.erase(iter);
+}
+
+void EntityGrid::Clear() {
+    m_Cells.clear();
+    m_EntityCells.clear();
+}
+
+} // ns entity
+} // ns mc
@@ -3,6 +3,7 @@
 #include <mclib/entity/Painting.h>
 #include <mclib/entity/XPOrb.h>
 #include <mclib/protocol/packets/PacketDispatcher.h>
+#include <mclib/util/TickScheduler.h>
 
 #include <unordered_map>
 #include <algorithm>
@@ -51,7 +52,10 @@ EntityType GetEntityTypeFromObjectId(s32 oid) {
 }
 
 EntityManager::EntityManager(protocol::packets::PacketDispatcher* dispatcher, protocol::Version protocolVersion)
-    : protocol::packets::PacketHandler(dispatcher), m_ProtocolVersion(protocolVersion)
+    : protocol::packets::PacketHandler(dispatcher),
+      m_ProtocolVersion(protocolVersion),
+      m_PredictionEnabled(false),
+      m_MaxExtrapolation(500)
 {
     GetDispatcher()->RegisterHandler(protocol::State::Play, protocol::play::JoinGame, this);
     GetDispatcher()->RegisterHandler(protocol::State::Play, protocol::play::PlayerPositionAndLook, this);
@@ -76,6 +80,219 @@ EntityManager::EntityManager(protocol::packets::PacketDispatcher* dispatcher, pr
 
 EntityManager::~EntityManager() {
     GetDispatcher()->UnregisterHandler(this);
+
+    // Entities can be kept alive by others, so they have to stop using the store.
+    for (auto& kv : m_Entities) {
+        if (kv.second)
+            kv.second->Detach();
+    }
+}
+
+void EntityManager::AddEntity(const EntityPtr& entity) {
+    EntityId eid = entity->GetEntityId();
+    EntityPtr& current = m_Entities[eid];
+
+    if (current && current != entity)
+        current->Detach();
+
+    current = entity;
+    entity->Attach(&m_Store, m_Store.Create(eid));
+
+    // The velocity from the spawn packet is current.
+    s64 time = util::TickScheduler::GetTime();
+    m_Store.ResetPosition(entity->GetHandle(), entity->GetPosition(), time);
+    m_Store.SetVelocityTime(entity->GetHandle(), time);
+
+    m_Grid.Insert(eid, entity->GetPosition());
+}
+
+void EntityManager::RemoveEntity(EntityId eid) {
+    auto iter = m_Entities.find(eid);
+    if (iter == m_Entities.end()) return;
+
+    if (iter->second)
+        iter->second->Detach();
+
+    if (eid == m_EntityId)
+        m_PlayerEntity = nullptr;
+
+    m_Entities.erase(iter);
+    m_Grid.Remove(eid);
+}
+
+void EntityManager::MoveEntity(const EntityPtr& entity, const Vector3d& position, bool teleport) {
+    if (!m_Store.IsValid(entity->GetHandle())) {
+        entity->SetPosition(position);
+        return;
+    }
+
+    s64 time = util::TickScheduler::GetTime();
+
+    if (teleport)
+        m_Store.ResetPosition(entity->GetHandle(), position, time);
+    else
+        m_Store.RecordPosition(entity->GetHandle(), position, time);
+
+    m_Grid.Insert(entity->GetEntityId(), position);
+}
+
+void EntityManager::SetEntityPosition(EntityId eid, const Vector3d& position) {
+    auto iter = m_Entities.find(eid);
+    if (iter == m_Entities.end() || !iter->second) return;
+
+    MoveEntity(iter->second, position);
+}
+
+bool EntityManager::PredictPosition(EntityId eid, s64 time, Vector3d& position) const {
+    auto iter = m_Entities.find(eid);
+    if (iter == m_Entities.end() || !iter->second) return false;
+
+    const EntityPtr& entity = iter->second;
+
+    if (m_Store.IsValid(entity->GetHandle()))
+        position = m_Store.PredictPosition(m_Store.GetIndex(entity->GetHandle()), time, m_MaxExtrapolation);
+    else
+        position = entity->GetPosition();
+
+    return true;
+}
+
+void EntityManager::UpdatePredictions(s64 time) {
+    if (m_PredictionEnabled)
+        m_Store.UpdatePredictions(time, m_MaxExtrapolation);
+}
+
+bool EntityManager::GetPredictedPosition(EntityId eid, Vector3d& position) const {
+    auto iter = m_Entities.find(eid);
+    if (iter == m_Entities.end() || !iter->second) return false;
+
+    const EntityPtr& entity = iter->second;
+
+    if (m_PredictionEnabled && m_Store.IsValid(entity->GetHandle()))
+        position = m_Store.GetPredictedPosition(entity->GetHandle());
+    else
+        position = entity->GetPosition();
+
+    return true;
+}
+
+std::vector<EntityPtr> EntityManager::QueryRadius(const Vector3d& center, double radius, const EntityFilter& filter) const {
+    std::vector<EntityPtr> result;
+    AABB bounds(center - Vector3d(radius, radius, radius), center + Vector3d(radius, radius, radius));
+    double radiusSq = radius * radius;
+
+    m_Grid.ForEachInBounds(bounds, [&](EntityId eid) {
+        auto iter = m_Entities.find(eid);
+        if (iter == m_Entities.end() || !iter->second) return;
+
+        const EntityPtr& entity = iter->second;
+        Vector3d toEntity = entity->GetPosition() - center;
+
+        if (toEntity.LengthSq() <= radiusSq && (!filter || filter(entity)))
+            result.push_back(entity);
+    });
+
+    return result;
+}
+
+std::vector<EntityPtr> EntityManager::QueryAABB(const AABB& bounds, const EntityFilter& filter) const {
+    std::vector<EntityPtr> result;
+
+    m_Grid.ForEachInBounds(bounds, [&](EntityId eid) {
+        auto iter = m_Entities.find(eid);
+        if (iter == m_Entities.end() || !iter->second) return;
+
+        const EntityPtr& entity = iter->second;
+
+        if (bounds.Contains(entity->GetPosition()) && (!filter || filter(entity)))
+            result.push_back(entity);
+    });
+
+    return result;
+}
+
+std::vector<EntityPtr> EntityManager::Nearest(const Vector3d& position, std::size_t k, const EntityFilter& filter, double maxDistance) const {
+    typedef std::pair<double, EntityPtr> Candidate;
+
+    auto compare = [](const Candidate& lhs, const Candidate& rhs) { return lhs.first < rhs.first; };
+
+    // Max heap of the closest entities found so far
+    std::vector<Candidate> best;
+    double maxDistanceSq = maxDistance * maxDistance;
+
+    if (k == 0) return std::vector<EntityPtr>();
+
+    auto consider = [&](EntityId eid) {
+        auto iter = m_Entities.find(eid);
+        if (iter == m_Entities.end() || !iter->second) return;
+
+        const EntityPtr& entity = iter->second;
+        double distanceSq = (entity->GetPosition() - position).LengthSq();
+
+        if (distanceSq > maxDistanceSq) return;
+        if (best.size() >= k && distanceSq >= best.front().first) return;
+        if (filter && !filter(entity)) return;
+
+        if (best.size() >= k) {
+            std::pop_heap(best.begin(), best.end(), compare);
+            best.pop_back();
+        }
+
+        best.emplace_back(distanceSq, entity);
+        std::push_heap(best.begin(), best.end(), compare);
+    };
+
+    Vector3i center = EntityGrid::GetCell(position);
+
+    // Search shells of cells around the center cell. After shell r, anything unvisited is at least r cells away.
+    for (s64 r = 0; ; ++r) {
+        s64 size = 2 * r + 1;
+
+        if (size * size * size > (s64)m_Grid.GetCellCount()) {
+            // The shell covers more cells than are occupied, so finish with the occupied cells that weren't searched yet.
+            for (const auto& kv : m_Grid.GetCells()) {
+                Vector3i offset = kv.first - center;
+                s64 distance = std::max(std::abs(offset.x), std::max(std::abs(offset.y), std::abs(offset.z)));
+
+                if (distance < r) continue;
+
+                for (EntityId eid : kv.second)
+                    consider(eid);
+            }
+            break;
+        }
+
+        for (s64 y = -r; y <= r; ++y) {
+            for (s64 z = -r; z <= r; ++z) {
+                bool edge = std::abs(y) == r || std::abs(z) == r;
+                s64 step = (edge || r == 0) ? 1 : 2 * r;
+
+                for (s64 x = -r; x <= r; x += step) {
+                    const std::vector<EntityId>* entities = m_Grid.GetEntities(center + Vector3i(x, y, z));
+
+                    if (!entities) continue;
+
+                    for (EntityId eid : *entities)
+                        consider(eid);
+                }
+            }
+        }
+
+        double searched = (double)(r * EntityGrid::CellSize);
+
+        if (searched >= maxDistance) break;
+        if (best.size() >= k && best.front().first <= searched * searched) break;
+    }
+
+    std::sort_heap(best.begin(), best.end(), compare);
+
+    std::vector<EntityPtr> result;
+    result.reserve(best.size());
+
+    for (Candidate& candidate : best)
+        result.push_back(std::move(candidate.second));
+
+    return result;
 }
 
 void EntityManager::HandlePacket(protocol::packets::in::AttachEntityPacket* packet) {
@@ -95,9 +312,9 @@ void EntityManager::HandlePacket(protocol::packets::in::JoinGamePacket* packet)
 
     m_EntityId = id;
 
-    std::shared_ptr<PlayerEntity> entity = std::make_shared<PlayerEntity>(id, m_ProtocolVersion);
+    m_PlayerEntity = std::make_shared<PlayerEntity>(id, m_ProtocolVersion);
 
-    m_Entities[id] = entity;
+    AddEntity(m_PlayerEntity);
 }
 
 void EntityManager::HandlePacket(protocol::packets::in::PlayerPositionAndLookPacket* packet) {
@@ -111,7 +328,7 @@ void EntityManager::HandlePacket(protocol::packets::in::PlayerPositionAndLookPac
     }
 
     if (entity) {
-        entity->SetPosition(packet->GetPosition());
+        MoveEntity(entity, packet->GetPosition(), true);
         entity->SetYaw(packet->GetYaw() * DEG_TO_RAD);
         entity->SetPitch(packet->GetPitch() * DEG_TO_RAD);
     }
@@ -122,14 +339,14 @@ void EntityManager::HandlePacket(protocol::packets::in::SpawnPlayerPacket* packe
 
     std::shared_ptr<PlayerEntity> entity = std::make_shared<PlayerEntity>(id, m_ProtocolVersion);
 
-    m_Entities[id] = entity;
-
     entity->SetType(EntityType::Player);
     entity->SetPosition(packet->GetPosition());
     entity->SetYaw(packet->GetYaw() / 256.0f * TAU);
     entity->SetPitch(packet->GetPitch() / 256.0f * TAU);
     entity->SetMetadata(packet->GetMetadata());
 
+    AddEntity(entity);
+
     UUID uuid = packet->GetUUID();
 
     NotifyListeners(&EntityListener::OnPlayerSpawn, PlayerEntityPtr(entity), uuid);
@@ -140,7 +357,6 @@ void EntityManager::HandlePacket(protocol::packets::in::SpawnObjectPacket* packe
     EntityId eid = packet->GetEntityId();
     EntityPtr entity = std::make_shared<Entity>(eid, m_ProtocolVersion);
 
-    m_Entities[eid] = entity;
     entity->SetPosition(ToVector3d(packet->GetPosition()));
     entity->SetYaw(packet->GetYaw() / 256.0f * TAU);
     entity->SetPitch(packet->GetPitch() / 256.0f * TAU);
@@ -151,6 +367,8 @@ void EntityManager::HandlePacket(protocol::packets::in::SpawnObjectPacket* packe
     EntityType type = GetEntityTypeFromObjectId(packet->GetType());
     entity->SetType(type);
 
+    AddEntity(entity);
+
     NotifyListeners(&EntityListener::OnObjectSpawn, entity);
 }
 
@@ -158,40 +376,38 @@ void EntityManager::HandlePacket(protocol::packets::in::SpawnPaintingPacket* pac
     EntityId eid = packet->GetEntityId();
     auto entity = std::make_shared<PaintingEntity>(eid, m_ProtocolVersion);
 
-    m_Entities[eid] = entity;
-
     entity->SetPosition(ToVector3d(packet->GetPosition()));
     entity->SetType(EntityType::Painting);
     entity->SetTitle(packet->GetTitle());
     entity->SetDirection((PaintingEntity::Direction)packet->GetDirection());
+
+    AddEntity(entity);
 }
 
 void EntityManager::HandlePacket(protocol::packets::in::SpawnExperienceOrbPacket* packet) {
     EntityId eid = packet->GetEntityId();
     EntityPtr entity = std::make_shared<XPOrb>(eid, packet->GetCount(), m_ProtocolVersion);
 
-    m_Entities[eid] = entity;
-
     entity->SetPosition(packet->GetPosition());
     entity->SetType(EntityType::XPOrb);
+
+    AddEntity(entity);
 }
 
 void EntityManager::HandlePacket(protocol::packets::in::SpawnGlobalEntityPacket* packet) {
     EntityId eid = packet->GetEntityId();
     EntityPtr entity = std::make_shared<Entity>(eid, m_ProtocolVersion);
 
-    m_Entities[eid] = entity;
-
     entity->SetPosition(packet->GetPosition());
     entity->SetType(EntityType::Lightning);
+
+    AddEntity(entity);
 }
 
 void EntityManager::HandlePacket(protocol::packets::in::SpawnMobPacket* packet) {
     EntityId eid = packet->GetEntityId();
     EntityPtr entity = std::make_shared<Entity>(eid, m_ProtocolVersion);
 
-    m_Entities[eid] = entity;
-
     entity->SetType((EntityType)packet->GetType());
     entity->SetPosition(packet->GetPosition());
     entity->SetYaw(packet->GetYaw() / 256.0f * TAU);
@@ -202,6 +418,8 @@ void EntityManager::HandlePacket(protocol::packets::in::SpawnMobPacket* packet)
     Vector3d velocity = ToVector3d(packet->GetVelocity()) / 8000.0;
     entity->SetVelocity(velocity);
 
+    AddEntity(entity);
+
     NotifyListeners(&EntityListener::OnEntitySpawn, entity);
 }
 
@@ -216,7 +434,7 @@ void EntityManager::HandlePacket(protocol::packets::in::DestroyEntitiesPacket* p
         if (entity)
             NotifyListeners(&EntityListener::OnEntityDestroy, iter->second);
 
-        m_Entities.erase(eid);
+        RemoveEntity(eid);
     }
 }
 
@@ -226,9 +444,7 @@ void EntityManager::HandlePacket(protocol::packets::in::EntityPacket* packet) {
     auto iter = m_Entities.find(eid);
 
     if (iter == m_Entities.end()) {
-        EntityPtr entity = std::make_shared<Entity>(eid, m_ProtocolVersion);
-
-        m_Entities[eid] = entity;
+        AddEntity(std::make_shared<Entity>(eid, m_ProtocolVersion));
     }
 }
 
@@ -244,6 +460,9 @@ void EntityManager::HandlePacket(protocol::packets::in::EntityVelocityPacket* pa
         Vector3d velocity = ToVector3d(packet->GetVelocity()) / 8000.0;
 
         entity->SetVelocity(velocity);
+
+        if (m_Store.IsValid(entity->GetHandle()))
+            m_Store.SetVelocityTime(entity->GetHandle(), util::TickScheduler::GetTime());
     }
 }
 
@@ -261,7 +480,7 @@ void EntityManager::HandlePacket(protocol::packets::in::EntityRelativeMovePacket
         Vector3d oldPos = entity->GetPosition();
         Vector3d newPos = entity->GetPosition() + delta;
 
-        entity->SetPosition(newPos);
+        MoveEntity(entity, newPos);
 
         NotifyListeners(&EntityListener::OnEntityMove, entity, oldPos, newPos);
     }
@@ -281,7 +500,7 @@ void EntityManager::HandlePacket(protocol::packets::in::EntityLookAndRelativeMov
         Vector3d oldPos = entity->GetPosition();
         Vector3d newPos = entity->GetPosition() + delta;
 
-        entity->SetPosition(newPos);
+        MoveEntity(entity, newPos);
         entity->SetYaw(packet->GetYaw() / 256.0f * TAU);
         entity->SetPitch(packet->GetPitch() / 256.0f * TAU);
 
@@ -301,7 +520,8 @@ void EntityManager::HandlePacket(protocol::packets::in::EntityTeleportPacket* pa
         Vector3d oldPos = entity->GetPosition();
         Vector3d newPos = packet->GetPosition();
 
-        entity->SetPosition(newPos);
+        // Moves longer than a relative move can encode are jumps, not motion.
+        MoveEntity(entity, newPos, oldPos.DistanceSq(newPos) > 8.0 * 8.0);
         entity->SetYaw(packet->GetYaw() / 256.0f * TAU);
         entity->SetPitch(packet->GetPitch() / 256.0f * TAU);
 
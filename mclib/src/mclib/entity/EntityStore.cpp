@@ -0,0 +1,157 @@
+#include <mclib/entity/EntityStore.h>
+
+#include <mclib/entity/Entity.h>
+
+#include <algorithm>
+
+namespace mc {
+namespace entity {
+
+template <typename T>
+static void RemoveSwap(std::vector<T>& values, std::size_t index) {
+    values[index] = values.back();
+    values.pop_back();
+}
+
+EntityHandle EntityStore::Create(EntityId eid) {
+    u32 slot;
+
+    if (!m_FreeSlots.empty()) {
+        slot = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+    } else {
+        slot = (u32)m_Slots.size();
+        m_Slots.push_back(Slot{ 0, 0 });
+    }
+
+    m_Slots[slot].dense = (u32)m_EntityIds.size();
+
+    m_DenseSlots.push_back(slot);
+    m_EntityIds.push_back(eid);
+    m_Positions.emplace_back(0, 0, 0);
+    m_Velocities.emplace_back(0, 0, 0);
+    m_Yaws.push_back(0.0f);
+    m_Pitches.push_back(0.0f);
+    m_HeadPitches.push_back(0.0f);
+    m_VehicleIds.push_back(-1);
+    m_Types.push_back(EntityType::Unknown);
+    m_UpdateTimes.push_back(0);
+    m_PreviousPositions.emplace_back(0, 0, 0);
+    m_PreviousUpdateTimes.push_back(0);
+    m_VelocityTimes.push_back(0);
+    m_PredictedPositions.emplace_back(0, 0, 0);
+
+    return EntityHandle(slot, m_Slots[slot].generation);
+}
+
+void EntityStore::Destroy(EntityHandle handle) {
+    if (!IsValid(handle)) return;
+
+    std::size_t index = GetIndex(handle);
+
+    // The last entity takes the place of the destroyed one.
+    m_Slots[m_DenseSlots.back()].dense = (u32)index;
+
+    RemoveSwap(m_DenseSlots, index);
+    RemoveSwap(m_EntityIds, index);
+    RemoveSwap(m_Positions, index);
+    RemoveSwap(m_Velocities, index);
+    RemoveSwap(m_Yaws, index);
+    RemoveSwap(m_Pitches, index);
+    RemoveSwap(m_HeadPitches, index);
+    RemoveSwap(m_VehicleIds, index);
+    RemoveSwap(m_Types, index);
+    RemoveSwap(m_UpdateTimes, index);
+    RemoveSwap(m_PreviousPositions, index);
+    RemoveSwap(m_PreviousUpdateTimes, index);
+    RemoveSwap(m_VelocityTimes, index);
+    RemoveSwap(m_PredictedPositions, index);
+
+    ++m_Slots[handle.index].generation;
+    m_FreeSlots.push_back(handle.index);
+}
+
+void EntityStore::Clear() {
+    for (std::size_t i = 0; i < m_Slots.size(); ++i)
+        ++m_Slots[i].generation;
+
+    m_FreeSlots.clear();
+    for (u32 i = 0; i < (u32)m_Slots.size(); ++i)
+        m_FreeSlots.push_back(i);
+
+    m_DenseSlots.clear();
+    m_EntityIds.clear();
+    m_Positions.clear();
+    m_Velocities.clear();
+    m_Yaws.clear();
+    m_Pitches.clear();
+    m_HeadPitches.clear();
+    m_VehicleIds.clear();
+    m_Types.clear();
+    m_UpdateTimes.clear();
+    m_PreviousPositions.clear();
+    m_PreviousUpdateTimes.clear();
+    m_VelocityTimes.clear();
+    m_PredictedPositions.clear();
+}
+
+void EntityStore::RecordPosition(EntityHandle handle, const Vector3d& position, s64 time) noexcept {
+    std::size_t index = GetIndex(handle);
+
+    // Several updates can arrive in the same millisecond, keep the older sample so the interval isn't empty.
+    if (time > m_UpdateTimes[index]) {
+        m_PreviousPositions[index] = m_Positions[index];
+        m_PreviousUpdateTimes[index] = m_UpdateTimes[index];
+    }
+
+    m_Positions[index] = position;
+    m_UpdateTimes[index] = time;
+}
+
+void EntityStore::ResetPosition(EntityHandle handle, const Vector3d& position, s64 time) noexcept {
+    std::size_t index = GetIndex(handle);
+
+    m_Positions[index] = position;
+    m_PreviousPositions[index] = position;
+    m_UpdateTimes[index] = time;
+    m_PreviousUpdateTimes[index] = time;
+}
+
+Vector3d EntityStore::PredictPosition(std::size_t index, s64 time, s64 maxExtrapolation) const noexcept {
+    // Longer gaps between updates mean that the entity was standing still in between.
+    static const s64 MaxSampleInterval = 1000;
+    // Velocities sent by the server are in blocks per tick.
+    static const double TickTime = 50.0;
+
+    const Vector3d& position = m_Positions[index];
+    const Vector3d& previous = m_PreviousPositions[index];
+    s64 updateTime = m_UpdateTimes[index];
+    s64 previousTime = m_PreviousUpdateTimes[index];
+    s64 interval = updateTime - previousTime;
+
+    if (time <= updateTime) {
+        if (interval <= 0) return position;
+        if (time <= previousTime) return previous;
+
+        double t = (double)(time - previousTime) / interval;
+        return previous + (position - previous) * t;
+    }
+
+    double elapsed = (double)std::min(time - updateTime, maxExtrapolation);
+
+    if (m_VelocityTimes[index] >= updateTime)
+        return position + m_Velocities[index] * (elapsed / TickTime);
+
+    if (interval <= 0 || interval > MaxSampleInterval)
+        return position;
+
+    return position + (position - previous) * (elapsed / interval);
+}
+
+void EntityStore::UpdatePredictions(s64 time, s64 maxExtrapolation) noexcept {
+    for (std::size_t i = 0; i < m_Positions.size(); ++i)
+        m_PredictedPositions[i] = PredictPosition(i, time, maxExtrapolation);
+}
+
+} // ns entity
+} // ns mc
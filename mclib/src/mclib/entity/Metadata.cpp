@@ -2,6 +2,8 @@
 
 #include <mclib/common/DataBuffer.h>
 
+#include <algorithm>
+
 namespace mc {
 namespace entity {
 
@@ -93,72 +95,182 @@ DataBuffer& operator>>(DataBuffer& in, EntityMetadata::NBTType& value) {
     return in >> value.value;
 }
 
-DataBuffer& operator<<(DataBuffer& out, const EntityMetadata& md) {
-    for (std::size_t i = 0; i < md.MetadataCount; ++i) {
-        EntityMetadata::DataType type = md.m_Metadata[i].second;
-        EntityMetadata::Type* value = md.m_Metadata[i].first.get();
-
-        if (!value) continue;
-
-        u8 item = ((type << 5) | (i & 0x1F)) & 0xFF;
-
-        out << item;
-
-        if (md.m_ProtocolVersion <= protocol::Version::Minecraft_1_12_2 && type >= 5) {
-            type = static_cast<EntityMetadata::DataType>(static_cast<int>(type) + 1);
-        }
+static void SkipString(DataBuffer& in) {
+    VarInt length;
+    in >> length;
+    in.SetReadOffset(in.GetReadOffset() + (std::size_t)length.GetInt());
+}
 
-        switch (type) {
+// Moves past the value without decoding it where the size can be found cheaply.
+void EntityMetadata::SkipValue(DataBuffer& in, DataType type, protocol::Version protocolVersion) {
+    switch (type) {
         case EntityMetadata::DataType::Byte:
-            out << *((EntityMetadata::ByteType*)value);
+        case EntityMetadata::DataType::Boolean:
+            in.SetReadOffset(in.GetReadOffset() + 1);
             break;
         case EntityMetadata::DataType::VarInt:
         case EntityMetadata::DataType::Direction:
         case EntityMetadata::DataType::OptBlockID:
-            out << *((EntityMetadata::VarIntType*)value);
-            break;
+        {
+            mc::VarInt value;
+            in >> value;
+        }
+        break;
         case EntityMetadata::DataType::Float:
-            out << *((EntityMetadata::FloatType*)value);
+            in.SetReadOffset(in.GetReadOffset() + 4);
             break;
-        case EntityMetadata::DataType::String:
         case EntityMetadata::DataType::Chat:
-            out << *((EntityMetadata::StringType*)value);
+        case EntityMetadata::DataType::String:
+            SkipString(in);
             break;
         case EntityMetadata::DataType::OptChat:
-            out << ((EntityMetadata::StringType*)value)->exists;
-            if (((EntityMetadata::StringType*)value)->exists) {
-                out << *((EntityMetadata::StringType*)value);
-            }
-            break;
+        {
+            bool exists;
+            in >> exists;
+            if (exists)
+                SkipString(in);
+        }
+        break;
         case EntityMetadata::DataType::Slot:
         {
-            DataBuffer serializedSlot = ((EntityMetadata::SlotType*)value)->Serialize(md.m_ProtocolVersion);
-            out << serializedSlot;
+            // Slots contain nbt, so they have to be parsed to find their end.
+            EntityMetadata::SlotType value;
+            value.Deserialize(in, protocolVersion);
         }
-            break;
-        case EntityMetadata::DataType::Boolean:
-            out << *((EntityMetadata::BooleanType*)value);
-            break;
+        break;
         case EntityMetadata::DataType::Rotation:
-            out << *((EntityMetadata::RotationType*)value);
+            in.SetReadOffset(in.GetReadOffset() + 12);
             break;
         case EntityMetadata::DataType::Position:
-            out << *((EntityMetadata::PositionType*)value);
+            in.SetReadOffset(in.GetReadOffset() + 8);
             break;
         case EntityMetadata::DataType::OptPosition:
-            out << ((EntityMetadata::PositionType*)value)->exists;
-            out << *((EntityMetadata::PositionType*)value);
-            break;
+        {
+            bool exists;
+            in >> exists;
+            if (exists)
+                in.SetReadOffset(in.GetReadOffset() + 8);
+        }
+        break;
         case EntityMetadata::DataType::OptUUID:
-            out << ((EntityMetadata::UUIDType*)value)->exists;
-            out << *((EntityMetadata::UUIDType*)value);
-            break;
+        {
+            bool exists;
+            in >> exists;
+            if (exists)
+                in.SetReadOffset(in.GetReadOffset() + 16);
+        }
+        break;
         case EntityMetadata::DataType::NBT:
-            out << *((EntityMetadata::NBTType*)value);
-            break;
+        {
+            EntityMetadata::NBTType value;
+            in >> value;
+        }
+        break;
         default:
             break;
+    }
+}
+
+std::unique_ptr<EntityMetadata::Type> EntityMetadata::DecodeValue(DataBuffer& in, DataType type, protocol::Version protocolVersion) {
+    switch (type) {
+        case EntityMetadata::DataType::Byte:
+        {
+            std::unique_ptr<EntityMetadata::ByteType> value = std::make_unique<EntityMetadata::ByteType>();
+            in >> *value;
+            return value;
+        }
+        case EntityMetadata::DataType::VarInt:
+        case EntityMetadata::DataType::Direction:
+        case EntityMetadata::DataType::OptBlockID:
+        {
+            std::unique_ptr<EntityMetadata::VarIntType> value = std::make_unique<EntityMetadata::VarIntType>();
+            in >> *value;
+            return value;
+        }
+        case EntityMetadata::DataType::Float:
+        {
+            std::unique_ptr<EntityMetadata::FloatType> value = std::make_unique<EntityMetadata::FloatType>();
+            in >> *value;
+            return value;
+        }
+        case EntityMetadata::DataType::Chat:
+        case EntityMetadata::DataType::String:
+        {
+            std::unique_ptr<EntityMetadata::StringType> value = std::make_unique<EntityMetadata::StringType>();
+            in >> *value;
+            return value;
+        }
+        case EntityMetadata::DataType::OptChat:
+        {
+            std::unique_ptr<EntityMetadata::StringType> value = std::make_unique<EntityMetadata::StringType>();
+            in >> value->exists;
+            if (value->exists) {
+                in >> *value;
+            }
+            return value;
+        }
+        case EntityMetadata::DataType::Slot:
+        {
+            std::unique_ptr<EntityMetadata::SlotType> value = std::make_unique<EntityMetadata::SlotType>();
+            value->Deserialize(in, protocolVersion);
+            return value;
+        }
+        case EntityMetadata::DataType::Boolean:
+        {
+            std::unique_ptr<EntityMetadata::BooleanType> value = std::make_unique<EntityMetadata::BooleanType>();
+            in >> *value;
+            return value;
+        }
+        case EntityMetadata::DataType::Rotation:
+        {
+            std::unique_ptr<EntityMetadata::RotationType> value = std::make_unique<EntityMetadata::RotationType>();
+            in >> *value;
+            return value;
+        }
+        case EntityMetadata::DataType::Position:
+        {
+            std::unique_ptr<EntityMetadata::PositionType> value = std::make_unique<EntityMetadata::PositionType>();
+            in >> *value;
+            value->exists = true;
+            return value;
+        }
+        case EntityMetadata::DataType::OptPosition:
+        {
+            std::unique_ptr<EntityMetadata::PositionType> value = std::make_unique<EntityMetadata::PositionType>();
+            in >> value->exists;
+            if (value->exists) {
+                in >> *value;
+            }
+            return value;
+        }
+        case EntityMetadata::DataType::OptUUID:
+        {
+            std::unique_ptr<EntityMetadata::UUIDType> value = std::make_unique<EntityMetadata::UUIDType>();
+            in >> value->exists;
+            if (value->exists) {
+                in >> *value;
+            }
+            return value;
+        }
+        case EntityMetadata::DataType::NBT:
+        {
+            std::unique_ptr<EntityMetadata::NBTType> value = std::make_unique<EntityMetadata::NBTType>();
+            in >> *value;
+            return value;
         }
+        default:
+            break;
+    }
+
+    return nullptr;
+}
+
+DataBuffer& operator<<(DataBuffer& out, const EntityMetadata& md) {
+    for (const EntityMetadata::Field& field : md.m_Fields) {
+        u8 item = ((field.type << 5) | (field.index & 0x1F)) & 0xFF;
+
+        out << item;
+        out << md.m_Data.substr(field.offset, field.size);
     }
 
     // End byte
@@ -167,12 +279,17 @@ DataBuffer& operator<<(DataBuffer& out, const EntityMetadata& md) {
 }
 
 DataBuffer& operator>>(DataBuffer& in, EntityMetadata& md) {
+    md.m_Fields.clear();
+    md.m_Data.clear();
+
+    bool sorted = true;
+
     while (true) {
         u8 index;
 
         in >> index;
 
-        if (index == 0xFF) return in;
+        if (index == 0xFF) break;
 
         u8 typeVal;
 
@@ -184,172 +301,69 @@ DataBuffer& operator>>(DataBuffer& in, EntityMetadata& md) {
             type = static_cast<EntityMetadata::DataType>(static_cast<int>(type) + 1);
         }
 
-        md.m_Metadata[index].second = type;
+        std::size_t begin = in.GetReadOffset();
 
-        switch (type) {
-            case EntityMetadata::DataType::Byte:
-            {
-                std::unique_ptr<EntityMetadata::ByteType> value = std::make_unique<EntityMetadata::ByteType>();
-                in >> *value;
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            case EntityMetadata::DataType::VarInt:
-            case EntityMetadata::DataType::Direction:
-            case EntityMetadata::DataType::OptBlockID:
-            {
-                std::unique_ptr<EntityMetadata::VarIntType> value = std::make_unique<EntityMetadata::VarIntType>();
-                in >> *value;
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            case EntityMetadata::DataType::Float:
-            {
-                std::unique_ptr<EntityMetadata::FloatType> value = std::make_unique<EntityMetadata::FloatType>();
-                in >> *value;
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            case EntityMetadata::DataType::Chat:
-            case EntityMetadata::DataType::String:
-            {
-                std::unique_ptr<EntityMetadata::StringType> value = std::make_unique<EntityMetadata::StringType>();
-                in >> *value;
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            case EntityMetadata::DataType::OptChat:
-            {
-                std::unique_ptr<EntityMetadata::StringType> value = std::make_unique<EntityMetadata::StringType>();
-                in >> value->exists;
-                if (value->exists) {
-                    in >> *value;
-                }
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            case EntityMetadata::DataType::Slot:
-            {
-                std::unique_ptr<EntityMetadata::SlotType> value = std::make_unique<EntityMetadata::SlotType>();
-                value->Deserialize(in, md.m_ProtocolVersion);
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            case EntityMetadata::DataType::Boolean:
-            {
-                std::unique_ptr<EntityMetadata::BooleanType> value = std::make_unique<EntityMetadata::BooleanType>();
-                in >> *value;
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            case EntityMetadata::DataType::Rotation:
-            {
-                std::unique_ptr<EntityMetadata::RotationType> value = std::make_unique<EntityMetadata::RotationType>();
-                in >> *value;
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            case EntityMetadata::DataType::Position:
-            {
-                std::unique_ptr<EntityMetadata::PositionType> value = std::make_unique<EntityMetadata::PositionType>();
-                in >> *value;
-                value->exists = true;
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            case EntityMetadata::DataType::OptPosition:
-            {
-                std::unique_ptr<EntityMetadata::PositionType> value = std::make_unique<EntityMetadata::PositionType>();
-                in >> value->exists;
-                if (value->exists) {
-                    in >> *value;
-                }
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            case EntityMetadata::DataType::OptUUID:
-            {
-                std::unique_ptr<EntityMetadata::UUIDType> value = std::make_unique<EntityMetadata::UUIDType>();
-                in >> value->exists;
-                if (value->exists) {
-                    in >> *value;
-                }
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            case EntityMetadata::DataType::NBT:
-            {
-                std::unique_ptr<EntityMetadata::NBTType> value = std::make_unique<EntityMetadata::NBTType>();
-                in >> *value;
-                md.m_Metadata[index].first = std::move(value);
-            }
-            break;
-            default:
-                break;
-        }
+        EntityMetadata::SkipValue(in, type, md.m_ProtocolVersion);
+
+        std::size_t size = in.GetReadOffset() - begin;
+
+        if (!md.m_Fields.empty() && md.m_Fields.back().index >= index)
+            sorted = false;
+
+        md.m_Fields.emplace_back(index, type, (u32)md.m_Data.size(), (u32)size);
+
+        if (size > 0)
+            md.m_Data.append((const char*)&in[begin], size);
+    }
+
+    if (!sorted) {
+        std::stable_sort(md.m_Fields.begin(), md.m_Fields.end(), [](const EntityMetadata::Field& lhs, const EntityMetadata::Field& rhs) {
+            return lhs.index < rhs.index;
+        });
     }
 
     return in;
 }
 
+const EntityMetadata::Field* EntityMetadata::GetField(std::size_t index) const {
+    auto iter = std::lower_bound(m_Fields.begin(), m_Fields.end(), index, [](const Field& field, std::size_t index) {
+        return field.index < index;
+    });
+
+    if (iter == m_Fields.end() || iter->index != index) return nullptr;
+
+    return &*iter;
+}
+
+const EntityMetadata::Type* EntityMetadata::Decode(std::size_t index) const {
+    const Field* field = GetField(index);
+    if (!field) return nullptr;
+
+    if (!field->value) {
+        DataBuffer in(m_Data.substr(field->offset, field->size));
+
+        field->value = DecodeValue(in, field->type, m_ProtocolVersion);
+    }
+
+    return field->value.get();
+}
+
 void EntityMetadata::CopyOther(const EntityMetadata& other) {
     m_ProtocolVersion = other.m_ProtocolVersion;
+    m_Data = other.m_Data;
 
-    for (std::size_t i = 0; i < MetadataCount; ++i) {
-        auto type = m_Metadata[i].second = other.m_Metadata[i].second;
-
-        switch (type) {
-            case DataType::Byte:
-                m_Metadata[i].first = std::make_unique<ByteType>(dynamic_cast<ByteType*>(other.m_Metadata[i].first.get())->value);
-                break;
-            case DataType::Direction:
-            case DataType::OptBlockID:
-            case DataType::VarInt:
-                m_Metadata[i].first = std::make_unique<VarIntType>(dynamic_cast<VarIntType*>(other.m_Metadata[i].first.get())->value);
-                break;
-            case DataType::Float:
-                m_Metadata[i].first = std::make_unique<FloatType>(dynamic_cast<FloatType*>(other.m_Metadata[i].first.get())->value);
-                break;
-            case DataType::String:
-            case DataType::Chat:
-            case DataType::OptChat:
-                m_Metadata[i].first = std::make_unique<StringType>(dynamic_cast<StringType*>(other.m_Metadata[i].first.get())->exists,
-                                                                   dynamic_cast<StringType*>(other.m_Metadata[i].first.get())->value);
-                break;
-            case DataType::Slot:
-                m_Metadata[i].first = std::make_unique<SlotType>(dynamic_cast<SlotType*>(other.m_Metadata[i].first.get())->value);
-                break;
-            case DataType::Boolean:
-                m_Metadata[i].first = std::make_unique<BooleanType>(dynamic_cast<BooleanType*>(other.m_Metadata[i].first.get())->value);
-                break;
-            case DataType::Rotation:
-                m_Metadata[i].first = std::make_unique<RotationType>(dynamic_cast<RotationType*>(other.m_Metadata[i].first.get())->value);
-                break;
-            case DataType::OptPosition:
-            case DataType::Position:
-                m_Metadata[i].first = std::make_unique<PositionType>(dynamic_cast<PositionType*>(other.m_Metadata[i].first.get())->exists, 
-                                                                     dynamic_cast<PositionType*>(other.m_Metadata[i].first.get())->value);
-                break;
-            case DataType::OptUUID:
-                m_Metadata[i].first = std::make_unique<UUIDType>(dynamic_cast<UUIDType*>(other.m_Metadata[i].first.get())->exists,
-                                                                 dynamic_cast<UUIDType*>(other.m_Metadata[i].first.get())->value);
-                break;
-            case DataType::NBT:
-                m_Metadata[i].first = std::make_unique<NBTType>(dynamic_cast<NBTType*>(other.m_Metadata[i].first.get())->value);
-                break;
-            default:
-                break;
-        }
-    }
+    // Decoded values aren't copied, the copy decodes them again when they are read.
+    m_Fields.clear();
+    m_Fields.reserve(other.m_Fields.size());
+
+    for (const Field& field : other.m_Fields)
+        m_Fields.emplace_back(field.index, field.type, field.offset, field.size);
 }
 
 EntityMetadata::EntityMetadata(protocol::Version protocolVersion) 
     : m_ProtocolVersion(protocolVersion)
 {
-    for (std::size_t i = 0; i < MetadataCount; ++i) {
-        m_Metadata[i].first = nullptr;
-        m_Metadata[i].second = DataType::None;
-    }
+
 }
 
 EntityMetadata::EntityMetadata(const EntityMetadata& rhs) {
@@ -357,7 +371,8 @@ EntityMetadata::EntityMetadata(const EntityMetadata& rhs) {
 }
 
 EntityMetadata& EntityMetadata::operator=(const EntityMetadata& rhs) {
-    CopyOther(rhs);
+    if (this != &rhs)
+        CopyOther(rhs);
     return *this;
 }
 
@@ -2,122 +2,270 @@
 
 #include <mclib/protocol/packets/PacketDispatcher.h>
 
+#include <algorithm>
+#include <mutex>
+
 namespace mc {
 namespace inventory {
 
+namespace {
+
+struct MaxStackSizes {
+    std::mutex mutex;
+    std::unordered_map<s32, s32> sizes;
+};
+
+MaxStackSizes& GetMaxStackSizes() {
+    static MaxStackSizes maxStackSizes;
+
+    return maxStackSizes;
+}
+
+} // ns
+
 const s32 Inventory::HOTBAR_SLOT_START = 36;
 const s32 Inventory::PLAYER_INVENTORY_ID = 0;
+const s32 Inventory::PLAYER_INVENTORY_SIZE = 46;
+const s32 Inventory::PLAYER_SLOT_COUNT = 36;
 
 Inventory::Inventory(int windowId)
+    : Inventory(windowId, windowId == PLAYER_INVENTORY_ID ? PLAYER_INVENTORY_SIZE : 0)
+{
+
+}
+
+Inventory::Inventory(int windowId, s32 size)
     : m_WindowId(windowId),
-      m_CurrentAction(1)
+      m_CurrentAction(1),
+      m_Cursor(std::make_shared<Slot>())
 {
+    Resize(size);
+}
+
+void Inventory::Resize(s32 size) {
+    s32 current = (s32)m_Items.size();
+
+    if (size <= current) return;
+
+    m_Items.resize(size);
+
+    ItemIndex& empty = m_Index[-1];
+
+    for (s32 i = current; i < size; ++i)
+        empty.slots.push_back(i);
+}
+
+void Inventory::AddToIndex(s32 index, const Slot& slot) {
+    auto iter = m_Index.find(slot.GetItemId());
+
+    if (iter == m_Index.end())
+        iter = m_Index.insert(std::make_pair(slot.GetItemId(), ItemIndex{ std::vector<s32>(), 0 })).first;
+
+    std::vector<s32>& slots = iter->second.slots;
+
+    slots.insert(std::lower_bound(slots.begin(), slots.end(), index), index);
+    iter->second.count += slot.GetItemCount();
+}
+
+void Inventory::RemoveFromIndex(s32 index, const Slot& slot) {
+    auto iter = m_Index.find(slot.GetItemId());
+    if (iter == m_Index.end()) return;
+
+    std::vector<s32>& slots = iter->second.slots;
+    auto position = std::lower_bound(slots.begin(), slots.end(), index);
+
+    if (position != slots.end() && *position == index)
+        slots.erase(position);
 
+    iter->second.count -= slot.GetItemCount();
+
+    if (slots.empty())
+        m_Index.erase(iter);
+}
+
+void Inventory::SetSlot(s32 index, const Slot& slot) {
+    if (index < 0) return;
+
+    if (index >= (s32)m_Items.size())
+        Resize(index + 1);
+
+    Slot& current = m_Items[index];
+
+    RemoveFromIndex(index, current);
+    current = slot;
+    AddToIndex(index, current);
 }
 
 Slot Inventory::GetItem(s32 index) const {
-    auto iter = m_Items.find(index);
-    if (iter == m_Items.end()) return Slot();
-    return iter->second;
+    if (index < 0 || index >= (s32)m_Items.size()) return Slot();
+    return m_Items[index];
 }
 
 s32 Inventory::FindItemById(s32 itemId) const {
-    auto iter = std::find_if(m_Items.begin(), m_Items.end(), [&](const std::pair<s32, Slot>& slot) {
-        return slot.second.GetItemId() == itemId;
-    });
+    auto iter = m_Index.find(itemId);
 
-    if (iter == m_Items.end()) return -1;
-    return iter->first;
+    if (iter == m_Index.end()) return -1;
+    return iter->second.slots.front();
 }
 
-bool Inventory::Contains(s32 itemId) const {
-    auto iter = std::find_if(m_Items.begin(), m_Items.end(), [&](const std::pair<s32, Slot>& slot) {
-        const Slot& compare = slot.second;
+const std::vector<s32>& Inventory::FindItemsById(s32 itemId) const {
+    static const std::vector<s32> none;
 
-        return compare.GetItemId() == itemId;
-    });
+    auto iter = m_Index.find(itemId);
+
+    if (iter == m_Index.end()) return none;
+    return iter->second.slots;
+}
+
+s32 Inventory::GetItemCount(s32 itemId) const {
+    auto iter = m_Index.find(itemId);
 
-    return iter != m_Items.end();
+    if (iter == m_Index.end()) return 0;
+    return iter->second.count;
+}
+
+bool Inventory::Contains(s32 itemId) const {
+    return m_Index.find(itemId) != m_Index.end();
 }
 
 bool Inventory::Contains(Slot item) const {
-    auto iter = std::find_if(m_Items.begin(), m_Items.end(), [&](const std::pair<s32, Slot>& slot) {
-        const Slot& compare = slot.second;
+    const std::vector<s32>& slots = FindItemsById(item.GetItemId());
 
-        return compare.GetItemId() == item.GetItemId() && 
-               compare.GetItemDamage() == item.GetItemDamage();
+    return std::any_of(slots.begin(), slots.end(), [&](s32 index) {
+        return m_Items[index].GetItemDamage() == item.GetItemDamage();
     });
-
-    return iter != m_Items.end();
 }
 
 bool Inventory::ContainsAtLeast(s32 itemId, s32 amount) const {
-    auto iter = std::find_if(m_Items.begin(), m_Items.end(), [&](const std::pair<s32, Slot>& slot) {
-        const Slot& compare = slot.second;
+    const std::vector<s32>& slots = FindItemsById(itemId);
 
-        return compare.GetItemId() == itemId &&
-               compare.GetItemCount() >= amount;
+    return std::any_of(slots.begin(), slots.end(), [&](s32 index) {
+        return m_Items[index].GetItemCount() >= amount;
     });
-
-    return iter != m_Items.end();
 }
 
 bool Inventory::ContainsAtLeast(Slot item, s32 amount) const {
-    auto iter = std::find_if(m_Items.begin(), m_Items.end(), [&](const std::pair<s32, Slot>& slot) {
-        const Slot& compare = slot.second;
+    const std::vector<s32>& slots = FindItemsById(item.GetItemId());
+
+    return std::any_of(slots.begin(), slots.end(), [&](s32 index) {
+        const Slot& compare = m_Items[index];
 
-        return compare.GetItemId() == item.GetItemId() &&
-               compare.GetItemDamage() == item.GetItemDamage() && 
+        return compare.GetItemDamage() == item.GetItemDamage() &&
                compare.GetItemCount() >= amount;
     });
-
-    return iter != m_Items.end();
 }
 
 void Inventory::HandleTransaction(core::Connection& conn, u16 action, bool accepted) {
-    if (!accepted) {
-        // Confirm with server that the transaction failed.
-        mc::protocol::packets::out::ConfirmTransactionPacket confirmation(m_WindowId, action, false);
-        conn.SendPacket(&confirmation);
+    auto iter = std::find_if(m_Pending.begin(), m_Pending.end(), [action](const Transaction& transaction) {
+        return (u16)transaction.action == action;
+    });
+
+    if (accepted) {
+        // Transactions are confirmed in order.
+        if (iter != m_Pending.end())
+            m_Pending.erase(m_Pending.begin(), iter + 1);
+        return;
+    }
+
+    if (iter != m_Pending.end()) {
+        // The later clicks were predicted from the rejected one, so undo all of them, newest first.
+        for (auto undo = m_Pending.end(); undo != iter; ) {
+            --undo;
+            SetSlot(undo->index, undo->slot);
+            *m_Cursor = undo->cursor;
+        }
+
+        m_Pending.erase(iter, m_Pending.end());
     }
+
+    // Confirm with server that the transaction failed.
+    mc::protocol::packets::out::ConfirmTransactionPacket confirmation(m_WindowId, action, false);
+    conn.SendPacket(&confirmation);
 }
 
-bool Inventory::PickUp(core::Connection& conn, s32 index) {
-    using namespace protocol::packets::out;
+void Inventory::SetMaxStackSize(s32 itemId, s32 size) {
+    MaxStackSizes& maxStackSizes = GetMaxStackSizes();
+    std::lock_guard<std::mutex> lock(maxStackSizes.mutex);
 
-    if (m_Cursor.GetItemId() != -1) return false;
+    if (size > 0)
+        maxStackSizes.sizes[itemId] = size;
+    else
+        maxStackSizes.sizes.erase(itemId);
+}
 
-    auto iter = m_Items.find(index);
-    if (iter == m_Items.end()) return false;
+s32 Inventory::GetMaxStackSize(s32 itemId) {
+    MaxStackSizes& maxStackSizes = GetMaxStackSizes();
+    std::lock_guard<std::mutex> lock(maxStackSizes.mutex);
 
-    s32 windowId = m_WindowId;
-    if (windowId == 0 && index < HOTBAR_SLOT_START)
-        windowId = -2;
-    
-    ClickWindowPacket pickupPacket(windowId, index, 0, m_CurrentAction++, 0, iter->second);
-    conn.SendPacket(&pickupPacket);
+    auto iter = maxStackSizes.sizes.find(itemId);
+    if (iter == maxStackSizes.sizes.end()) return 0;
+    return iter->second;
+}
 
-    return true;
+void Inventory::PredictClick(s32 index) {
+    Slot target = m_Items[index];
+    Slot cursor = *m_Cursor;
+
+    if (cursor.GetItemId() == -1 || target.GetItemId() == -1) {
+        std::swap(target, cursor);
+    } else if (cursor.GetItemId() == target.GetItemId() && cursor.GetItemDamage() == target.GetItemDamage() && !cursor.HasNBT() && !target.HasNBT()) {
+        s32 maxStack = GetMaxStackSize(target.GetItemId());
+
+        // The server accepts the click whatever the result is, so a wrong guess wouldn't be rolled back.
+        if (maxStack == 0) return;
+
+        s32 moved = std::min<s32>(maxStack - target.GetItemCount(), cursor.GetItemCount());
+
+        if (moved > 0) {
+            target = Slot(target.GetItemId(), (u8)(target.GetItemCount() + moved), target.GetItemDamage());
+
+            if (moved == cursor.GetItemCount())
+                cursor = Slot();
+            else
+                cursor = Slot(cursor.GetItemId(), (u8)(cursor.GetItemCount() - moved), cursor.GetItemDamage());
+        }
+    } else {
+        std::swap(target, cursor);
+    }
+
+    SetSlot(index, target);
+    *m_Cursor = cursor;
 }
 
-bool Inventory::Place(core::Connection& conn, s32 index) {
+bool Inventory::Click(core::Connection& conn, s32 index) {
     using namespace protocol::packets::out;
 
-    if (m_Cursor.GetItemId() == -1) return false;
+    if (index < 0 || index >= (s32)m_Items.size()) return false;
+
+    s16 action = m_CurrentAction++;
 
-    s32 windowId = m_WindowId;
-    if (windowId == 0 && index < HOTBAR_SLOT_START)
-        windowId = -2;
+    // Clicks have to be sent to the open window, so every slot of the player's inventory goes through window 0.
+    // The server ignores clicks for any other window, they would never be confirmed.
+    ClickWindowPacket clickPacket(m_WindowId, index, 0, action, 0, m_Items[index]);
+    conn.SendPacket(&clickPacket);
 
-    ClickWindowPacket dropPacket(windowId, index, 0, m_CurrentAction++, 0, Slot());
-    conn.SendPacket(&dropPacket);
+    m_Pending.push_back(Transaction{ action, index, m_Items[index], *m_Cursor });
+    PredictClick(index);
 
     return true;
 }
 
+bool Inventory::PickUp(core::Connection& conn, s32 index) {
+    if (m_Cursor->GetItemId() != -1) return false;
+
+    return Click(conn, index);
+}
+
+bool Inventory::Place(core::Connection& conn, s32 index) {
+    if (m_Cursor->GetItemId() == -1) return false;
+
+    return Click(conn, index);
+}
+
 InventoryManager::InventoryManager(protocol::packets::PacketDispatcher* dispatcher, core::Connection* connection)
     : protocol::packets::PacketHandler(dispatcher),
-      m_Connection(connection)
+      m_Connection(connection),
+      m_Cursor(std::make_shared<Slot>())
 {
     using namespace protocol;
     dispatcher->RegisterHandler(State::Play, play::SetSlot, this);
@@ -140,54 +288,77 @@ Inventory* InventoryManager::GetPlayerInventory() {
     return GetInventory(Inventory::PLAYER_INVENTORY_ID);
 }
 
-void InventoryManager::SetSlot(s32 windowId, s32 slotIndex, const Slot& slot) {
-    auto iter = m_Inventories.find(windowId);
+std::size_t InventoryManager::Click(s32 windowId, const std::vector<s32>& slots) {
+    Inventory* inventory = GetInventory(windowId);
+    if (inventory == nullptr) return 0;
 
-    Inventory* inventory = nullptr;
-    if (iter == m_Inventories.end()) {
-        auto newInventory = std::make_unique<Inventory>(windowId);
-        inventory = newInventory.get();
-        m_Inventories[windowId] = std::move(newInventory);
-    } else {
-        inventory = iter->second.get();
+    std::size_t sent = 0;
+
+    for (s32 index : slots) {
+        if (!inventory->Click(*m_Connection, index)) break;
+        ++sent;
     }
 
-    inventory->m_Items[slotIndex] = slot;
+    return sent;
 }
 
-void InventoryManager::HandlePacket(protocol::packets::in::SetSlotPacket* packet) {
-    s8 windowId = packet->GetWindowId();
-
-    if (windowId < 0 && packet->GetSlotIndex() == -1) {
-        Inventory* inventory = nullptr;
-
-        auto iter = m_Inventories.find(0);
-        if (iter == m_Inventories.end()) {
-            auto newInventory = std::make_unique<Inventory>(windowId);
-            inventory = newInventory.get();
-            m_Inventories[0] = std::move(newInventory);
-        } else {
-            inventory = iter->second.get();
-        }
+Inventory* InventoryManager::GetOrCreateInventory(s32 windowId) {
+    auto iter = m_Inventories.find(windowId);
+
+    if (iter != m_Inventories.end())
+        return iter->second.get();
+
+    auto newInventory = std::make_unique<Inventory>(windowId);
+    Inventory* inventory = newInventory.get();
+
+    AddInventory(std::move(newInventory));
+    return inventory;
+}
+
+void InventoryManager::AddInventory(std::unique_ptr<Inventory> inventory) {
+    inventory->m_Cursor = m_Cursor;
+
+    s32 windowId = inventory->m_WindowId;
+    m_Inventories[windowId] = std::move(inventory);
+}
 
-        inventory->m_Cursor = packet->GetSlot();
+void InventoryManager::SetSlot(s32 windowId, s32 slotIndex, const Slot& slot) {
+    // Window -1 is the cursor. It isn't a window, so it's handled before one would be created for it.
+    if (windowId == -1) {
+        *m_Cursor = slot;
+        return;
     }
 
-    SetSlot(packet->GetWindowId(), packet->GetSlotIndex(), packet->GetSlot());
+    // Window -2 sets a slot of the player's inventory whichever window is open.
+    if (windowId == -2)
+        windowId = Inventory::PLAYER_INVENTORY_ID;
+
+    if (windowId < 0) return;
+
+    GetOrCreateInventory(windowId)->SetSlot(slotIndex, slot);
+}
+
+void InventoryManager::HandlePacket(protocol::packets::in::SetSlotPacket* packet) {
+    // The window id is a signed byte here, the cursor and player inventory use negative ids.
+    s8 windowId = (s8)packet->GetWindowId();
+
+    SetSlot(windowId, packet->GetSlotIndex(), packet->GetSlot());
 }
 
 void InventoryManager::HandlePacket(protocol::packets::in::WindowItemsPacket* packet) {
     const std::vector<Slot>& slots = packet->GetSlots();
+    Inventory* inventory = GetOrCreateInventory(packet->GetWindowId());
+
+    inventory->Resize((s32)slots.size());
 
     for (std::size_t i = 0; i < slots.size(); ++i) {
-        SetSlot(packet->GetWindowId(), i, slots[i]);
+        inventory->SetSlot((s32)i, slots[i]);
     }
 }
 
 void InventoryManager::HandlePacket(protocol::packets::in::OpenWindowPacket* packet) {
-    m_Inventories.erase((s32)packet->GetWindowId());
-    auto newInventory = std::make_unique<Inventory>(packet->GetWindowId());
-    m_Inventories.insert(std::make_pair(packet->GetWindowId(), std::move(newInventory)));
+    // The window's own slots are followed by the player's inventory.
+    AddInventory(std::make_unique<Inventory>(packet->GetWindowId(), packet->GetSlotCount() + Inventory::PLAYER_SLOT_COUNT));
 }
 
 void InventoryManager::HandlePacket(protocol::packets::in::ConfirmTransactionPacket* packet) {
@@ -29,6 +29,81 @@ Slot Slot::FromNBT(nbt::TagCompound& compound) {
     return Slot(id, count, damage, nbt);
 }
 
+nbt::NBTVisitor* SlotReader::OnCompoundBegin(const std::string& name) {
+    // An element of a list of items
+    if (!m_InItem) return BeginItem();
+
+    // Only the tag compound inside of an item is kept, anything else is skipped.
+    if (name != "tag") return nullptr;
+
+    m_Tag = std::make_shared<nbt::NBTDocument>();
+    m_TagBuilder = std::make_unique<nbt::NBTDocumentBuilder>(*m_Tag);
+    return m_TagBuilder->OnCompoundBegin(name);
+}
+
+void SlotReader::OnCompoundEnd() {
+    m_Items.push_back(Item{ m_Index, Slot(m_Id, m_Count, m_Damage, std::move(m_Tag)) });
+
+    m_Tag.reset();
+    m_TagBuilder.reset();
+
+    m_InItem = false;
+    m_Index = -1;
+    m_Id = -1;
+    m_Damage = 0;
+    m_Count = 0;
+}
+
+void SlotReader::OnByte(const std::string& name, u8 value) {
+    if (name == "Count")
+        m_Count = value;
+    else if (name == "Slot")
+        m_Index = value;
+}
+
+void SlotReader::OnShort(const std::string& name, s16 value) {
+    if (name == "Damage")
+        m_Damage = value;
+    else if (name == "id")
+        m_Id = value;
+}
+
+const nbt::NBT& Slot::GetNBT() const {
+    static const nbt::NBT empty;
+
+    if (!m_NBT && m_Document)
+        m_NBT = std::make_shared<const nbt::NBT>(m_Document->ToNBT());
+
+    return m_NBT ? *m_NBT : empty;
+}
+
+// Writes the NBT of the slot or an end tag if it doesn't have any.
+static void WriteNBT(DataBuffer& out, const nbt::NBT* nbt, const nbt::NBTDocument* document) {
+    if (nbt && nbt->HasData())
+        out << *nbt;
+    else if (document && document->HasData())
+        document->Write(out);
+    else
+        out << (u8)0;
+}
+
+// Reads the NBT of a slot into a document, or returns null if there is none.
+static std::shared_ptr<const nbt::NBTDocument> ReadNBT(DataBuffer& in) {
+    // A slot at the end of a truncated buffer has no NBT.
+    if (in.GetReadOffset() >= in.GetSize())
+        return nullptr;
+
+    if (in[in.GetReadOffset()] == 0) {
+        in.SetReadOffset(in.GetReadOffset() + 1);
+        return nullptr;
+    }
+
+    auto document = std::make_shared<nbt::NBTDocument>();
+
+    document->Read(in);
+    return document;
+}
+
 DataBuffer Slot::Serialize(protocol::Version version) const {
     DataBuffer out;
 
@@ -38,11 +113,7 @@ DataBuffer Slot::Serialize(protocol::Version version) const {
 
             out << true << id << m_ItemCount;
 
-            if (m_NBT.HasData()) {
-                out << m_NBT;
-            } else {
-                out << (u8)0;
-            }
+            WriteNBT(out, m_NBT.get(), m_Document.get());
         } else {
             out << false;
         }
@@ -52,11 +123,7 @@ DataBuffer Slot::Serialize(protocol::Version version) const {
 
         out << m_ItemCount << m_ItemDamage;
 
-        if (m_NBT.HasData()) {
-            out << m_NBT;
-        } else {
-            out << (u8)0;
-        }
+        WriteNBT(out, m_NBT.get(), m_Document.get());
     }
 
     return out;
@@ -66,6 +133,8 @@ void Slot::Deserialize(DataBuffer& in, protocol::Version version) {
     m_ItemId = -1;
     m_ItemCount = 0;
     m_ItemDamage = 0;
+    m_NBT.reset();
+    m_Document.reset();
 
     if (version > protocol::Version::Minecraft_1_12_2) {
         bool present;
@@ -76,7 +145,8 @@ void Slot::Deserialize(DataBuffer& in, protocol::Version version) {
 
         VarInt itemId;
 
-        in >> itemId >> m_ItemCount >> m_NBT;
+        in >> itemId >> m_ItemCount;
+        m_Document = ReadNBT(in);
 
         m_ItemId = itemId.GetInt();
     } else {
@@ -95,16 +165,8 @@ void Slot::Deserialize(DataBuffer& in, protocol::Version version) {
         in >> m_ItemCount;
         in >> m_ItemDamage;
 
-        u8 hasNBT;
-        in >> hasNBT;
-
-        if (hasNBT) {
-            in.SetReadOffset(in.GetReadOffset() - 1);
-            in >> m_NBT;
-        }
+        m_Document = ReadNBT(in);
     }
-
-    
 }
 
 } // ns inventory
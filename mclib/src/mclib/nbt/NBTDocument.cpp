@@ -0,0 +1,318 @@
+#include <mclib/nbt/NBTDocument.h>
+
+#include <mclib/common/DataBuffer.h>
+#include <mclib/nbt/NBT.h>
+
+#include <functional>
+
+namespace mc {
+namespace nbt {
+
+const NBTDocument::Node* NBTDocument::Node::Find(StringView name) const noexcept {
+    if (m_Type != TagType::Compound) return nullptr;
+
+    for (const Node& child : *this) {
+        // Interned names of the same document can be compared by their address.
+        if (child.m_Name.data() == name.data() || child.m_Name == name)
+            return &child;
+    }
+
+    return nullptr;
+}
+
+NBTDocument::NBTDocument()
+    : m_Root(nullptr), m_NameCount(0)
+{
+
+}
+
+NBTDocument::NBTDocument(NBTDocument&& other) noexcept
+    : m_Arena(std::move(other.m_Arena)),
+      m_Root(other.m_Root),
+      m_Names(std::move(other.m_Names)),
+      m_NameCount(other.m_NameCount)
+{
+    other.m_Root = nullptr;
+    other.m_Names.clear();
+    other.m_NameCount = 0;
+}
+
+NBTDocument& NBTDocument::operator=(NBTDocument&& other) noexcept {
+    if (this == &other) return *this;
+
+    m_Arena = std::move(other.m_Arena);
+    m_Root = other.m_Root;
+    m_Names = std::move(other.m_Names);
+    m_NameCount = other.m_NameCount;
+
+    other.m_Root = nullptr;
+    other.m_Names.clear();
+    other.m_NameCount = 0;
+    return *this;
+}
+
+StringView NBTDocument::Intern(StringView name) {
+    if (name.empty()) return StringView();
+
+    // Keep the table at most half full.
+    if ((m_NameCount + 1) * 2 > m_Names.size()) {
+        std::vector<StringView> names(std::max<std::size_t>(m_Names.size() * 2, 16), StringView(nullptr, 0));
+
+        for (StringView existing : m_Names) {
+            if (existing.data() == nullptr) continue;
+
+            std::size_t i = std::hash<StringView>()(existing) & (names.size() - 1);
+            while (names[i].data() != nullptr)
+                i = (i + 1) & (names.size() - 1);
+
+            names[i] = existing;
+        }
+
+        m_Names.swap(names);
+    }
+
+    std::size_t mask = m_Names.size() - 1;
+    std::size_t i = std::hash<StringView>()(name) & mask;
+
+    while (m_Names[i].data() != nullptr) {
+        if (m_Names[i] == name) return m_Names[i];
+
+        i = (i + 1) & mask;
+    }
+
+    m_Names[i] = StringView(m_Arena.Copy(name.data(), name.size()), name.size());
+    ++m_NameCount;
+    return m_Names[i];
+}
+
+bool NBTDocument::Read(DataBuffer& in) {
+    m_Arena.Clear();
+    m_Root = nullptr;
+    m_Names.clear();
+    m_NameCount = 0;
+
+    NBTReader reader(in);
+    NBTDocumentBuilder builder(*this);
+
+    return reader.Read(builder);
+}
+
+void NBTDocument::Write(DataBuffer& out) const {
+    if (m_Root == nullptr) {
+        out << (u8)TagType::End;
+        return;
+    }
+
+    out << (u8)TagType::Compound << (u16)m_Root->m_Name.size();
+    out << m_Root->m_Name.ToString();
+    WritePayload(out, *m_Root);
+}
+
+void NBTDocument::WritePayload(DataBuffer& out, const Node& node) const {
+    switch (node.m_Type) {
+        case TagType::Byte:
+            out << (u8)node.m_Integer;
+            break;
+        case TagType::Short:
+            out << (s16)node.m_Integer;
+            break;
+        case TagType::Int:
+            out << (s32)node.m_Integer;
+            break;
+        case TagType::Long:
+            out << node.m_Integer;
+            break;
+        case TagType::Float:
+            out << (float)node.m_Floating;
+            break;
+        case TagType::Double:
+            out << node.m_Floating;
+            break;
+        case TagType::ByteArray:
+            out << (s32)node.m_Size;
+            out << std::string(node.m_Bytes, node.m_Size);
+            break;
+        case TagType::String:
+            out << (u16)node.m_Size;
+            out << std::string(node.m_Bytes, node.m_Size);
+            break;
+        case TagType::List:
+            out << (u8)node.m_ElementType << (s32)node.m_Size;
+
+            for (const Node& child : node)
+                WritePayload(out, child);
+            break;
+        case TagType::Compound:
+            for (const Node& child : node) {
+                out << (u8)child.m_Type << (u16)child.m_Name.size();
+                out << child.m_Name.ToString();
+                WritePayload(out, child);
+            }
+
+            out << (u8)TagType::End;
+            break;
+        case TagType::IntArray:
+            out << (s32)node.m_Size;
+
+            for (u32 i = 0; i < node.m_Size; ++i)
+                out << node.m_Ints[i];
+            break;
+        default:
+            break;
+    }
+}
+
+NBT NBTDocument::ToNBT() const {
+    NBT nbt;
+
+    if (m_Root == nullptr) return nbt;
+
+    DataBuffer buffer;
+
+    Write(buffer);
+    buffer >> nbt;
+    return nbt;
+}
+
+NBTDocumentBuilder::NBTDocumentBuilder(NBTDocument& document)
+    : m_Document(document), m_Depth(0)
+{
+
+}
+
+NBTDocument::Node& NBTDocumentBuilder::Add(TagType type, const std::string& name) {
+    std::vector<NBTDocument::Node>& children = m_Frames[m_Depth - 1].children;
+
+    children.emplace_back();
+
+    NBTDocument::Node& node = children.back();
+
+    node.m_Type = type;
+    node.m_ElementType = TagType::End;
+    node.m_Size = 0;
+    node.m_Name = m_Document.Intern(name);
+    node.m_Integer = 0;
+    return node;
+}
+
+void NBTDocumentBuilder::Begin(TagType type, TagType elementType, const std::string& name) {
+    if (m_Frames.size() == m_Depth)
+        m_Frames.emplace_back();
+
+    Frame& frame = m_Frames[m_Depth++];
+
+    frame.node.m_Type = type;
+    frame.node.m_ElementType = elementType;
+    frame.node.m_Size = 0;
+    frame.node.m_Name = m_Document.Intern(name);
+    frame.node.m_Children = nullptr;
+    frame.children.clear();
+}
+
+void NBTDocumentBuilder::End() {
+    Frame& frame = m_Frames[--m_Depth];
+    NBTDocument::Node node = frame.node;
+
+    if (!frame.children.empty()) {
+        NBTDocument::Node* children = m_Document.m_Arena.Allocate<NBTDocument::Node>(frame.children.size());
+
+        std::copy(frame.children.begin(), frame.children.end(), children);
+
+        node.m_Children = children;
+        node.m_Size = (u32)frame.children.size();
+    }
+
+    if (m_Depth > 0) {
+        m_Frames[m_Depth - 1].children.push_back(node);
+        return;
+    }
+
+    NBTDocument::Node* root = m_Document.m_Arena.Allocate<NBTDocument::Node>(1);
+
+    *root = node;
+    m_Document.m_Root = root;
+}
+
+NBTVisitor* NBTDocumentBuilder::OnCompoundBegin(const std::string& name) {
+    Begin(TagType::Compound, TagType::End, name);
+    return this;
+}
+
+void NBTDocumentBuilder::OnCompoundEnd() {
+    End();
+}
+
+NBTVisitor* NBTDocumentBuilder::OnListBegin(const std::string& name, TagType elementType, s32 /*size*/) {
+    // The root has to be a compound.
+    if (m_Depth == 0) return nullptr;
+
+    Begin(TagType::List, elementType, name);
+    return this;
+}
+
+void NBTDocumentBuilder::OnListEnd() {
+    End();
+}
+
+void NBTDocumentBuilder::OnByte(const std::string& name, u8 value) {
+    if (m_Depth > 0)
+        Add(TagType::Byte, name).m_Integer = value;
+}
+
+void NBTDocumentBuilder::OnShort(const std::string& name, s16 value) {
+    if (m_Depth > 0)
+        Add(TagType::Short, name).m_Integer = value;
+}
+
+void NBTDocumentBuilder::OnInt(const std::string& name, s32 value) {
+    if (m_Depth > 0)
+        Add(TagType::Int, name).m_Integer = value;
+}
+
+void NBTDocumentBuilder::OnLong(const std::string& name, s64 value) {
+    if (m_Depth > 0)
+        Add(TagType::Long, name).m_Integer = value;
+}
+
+void NBTDocumentBuilder::OnFloat(const std::string& name, float value) {
+    if (m_Depth > 0)
+        Add(TagType::Float, name).m_Floating = value;
+}
+
+void NBTDocumentBuilder::OnDouble(const std::string& name, double value) {
+    if (m_Depth > 0)
+        Add(TagType::Double, name).m_Floating = value;
+}
+
+void NBTDocumentBuilder::OnByteArray(const std::string& name, const std::string& value) {
+    if (m_Depth == 0) return;
+
+    NBTDocument::Node& node = Add(TagType::ByteArray, name);
+
+    node.m_Bytes = m_Document.m_Arena.Copy(value.data(), value.size());
+    node.m_Size = (u32)value.size();
+}
+
+void NBTDocumentBuilder::OnString(const std::string& name, const std::string& value) {
+    if (m_Depth == 0) return;
+
+    NBTDocument::Node& node = Add(TagType::String, name);
+
+    node.m_Bytes = m_Document.m_Arena.Copy(value.data(), value.size());
+    node.m_Size = (u32)value.size();
+}
+
+void NBTDocumentBuilder::OnIntArray(const std::string& name, const std::vector<s32>& value) {
+    if (m_Depth == 0) return;
+
+    NBTDocument::Node& node = Add(TagType::IntArray, name);
+    s32* values = m_Document.m_Arena.Allocate<s32>(value.size());
+
+    std::copy(value.begin(), value.end(), values);
+
+    node.m_Ints = values;
+    node.m_Size = (u32)value.size();
+}
+
+} // ns nbt
+} // ns mc
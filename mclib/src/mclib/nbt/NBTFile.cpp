@@ -0,0 +1,199 @@
+#include <mclib/nbt/NBTFile.h>
+
+#include <mclib/common/DataBuffer.h>
+#include <mclib/nbt/NBT.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace mc {
+namespace nbt {
+
+NBTWriter::NBTWriter(util::OutputStream& out, std::size_t bufferSize)
+    : m_Out(out), m_BufferSize(std::max<std::size_t>(bufferSize, 16))
+{
+    m_Buffer.reserve(m_BufferSize);
+}
+
+void NBTWriter::WriteBytes(const void* data, std::size_t size) {
+    if (m_Buffer.size() + size > m_BufferSize) {
+        if (!m_Buffer.empty())
+            m_Out.Write(m_Buffer.data(), m_Buffer.size());
+        m_Buffer.clear();
+
+        // Large values go straight to the stream.
+        if (size > m_BufferSize) {
+            m_Out.Write(data, size);
+            return;
+        }
+    }
+
+    const u8* bytes = (const u8*)data;
+    m_Buffer.insert(m_Buffer.end(), bytes, bytes + size);
+}
+
+template <typename T>
+void NBTWriter::WriteValue(T value) {
+    // Switch to big endian
+    std::reverse((u8*)&value, (u8*)&value + sizeof(T));
+    WriteBytes(&value, sizeof(T));
+}
+
+void NBTWriter::WriteHeader(TagType type, const std::string& name) {
+    // List elements don't have a type or name of their own.
+    if (!m_InList.empty() && m_InList.back()) return;
+
+    WriteValue((u8)type);
+    WriteValue((u16)name.size());
+    WriteBytes(name.data(), name.size());
+}
+
+void NBTWriter::Flush() {
+    if (!m_Buffer.empty())
+        m_Out.Write(m_Buffer.data(), m_Buffer.size());
+
+    m_Buffer.clear();
+    m_Out.Flush();
+}
+
+NBTVisitor* NBTWriter::OnCompoundBegin(const std::string& name) {
+    WriteHeader(TagType::Compound, name);
+    m_InList.push_back(false);
+    return this;
+}
+
+void NBTWriter::OnCompoundEnd() {
+    WriteValue((u8)TagType::End);
+    m_InList.pop_back();
+}
+
+NBTVisitor* NBTWriter::OnListBegin(const std::string& name, TagType elementType, s32 size) {
+    WriteHeader(TagType::List, name);
+    WriteValue((u8)elementType);
+    WriteValue(size);
+    m_InList.push_back(true);
+    return this;
+}
+
+void NBTWriter::OnListEnd() {
+    m_InList.pop_back();
+}
+
+void NBTWriter::OnByte(const std::string& name, u8 value) {
+    WriteHeader(TagType::Byte, name);
+    WriteValue(value);
+}
+
+void NBTWriter::OnShort(const std::string& name, s16 value) {
+    WriteHeader(TagType::Short, name);
+    WriteValue(value);
+}
+
+void NBTWriter::OnInt(const std::string& name, s32 value) {
+    WriteHeader(TagType::Int, name);
+    WriteValue(value);
+}
+
+void NBTWriter::OnLong(const std::string& name, s64 value) {
+    WriteHeader(TagType::Long, name);
+    WriteValue(value);
+}
+
+void NBTWriter::OnFloat(const std::string& name, float value) {
+    WriteHeader(TagType::Float, name);
+    WriteValue(value);
+}
+
+void NBTWriter::OnDouble(const std::string& name, double value) {
+    WriteHeader(TagType::Double, name);
+    WriteValue(value);
+}
+
+void NBTWriter::OnByteArray(const std::string& name, const std::string& value) {
+    WriteHeader(TagType::ByteArray, name);
+    WriteValue((s32)value.size());
+    WriteBytes(value.data(), value.size());
+}
+
+void NBTWriter::OnString(const std::string& name, const std::string& value) {
+    WriteHeader(TagType::String, name);
+    WriteValue((u16)value.size());
+    WriteBytes(value.data(), value.size());
+}
+
+void NBTWriter::OnIntArray(const std::string& name, const std::vector<s32>& value) {
+    WriteHeader(TagType::IntArray, name);
+    WriteValue((s32)value.size());
+
+    for (s32 element : value)
+        WriteValue(element);
+}
+
+bool ReadNBTFile(const std::string& path, NBTVisitor& visitor, bool mapFile) {
+    util::Compression compression;
+
+    {
+        util::FileInputStream file(path);
+        u8 header[2];
+        std::size_t headerSize = file.Read(header, sizeof(header));
+
+        if (headerSize == 0) return false;
+
+        compression = util::DetectCompression(header, headerSize);
+    }
+
+    if (compression == util::Compression::None && mapFile) {
+        util::MappedFile mapped;
+
+        if (mapped.Open(path)) {
+            NBTReader reader(mapped.GetData(), mapped.GetSize());
+
+            return reader.Read(visitor);
+        }
+    }
+
+    // Start over so the header is read by the parser too.
+    util::FileInputStream in(path);
+
+    if (compression == util::Compression::None) {
+        NBTReader reader(in);
+
+        return reader.Read(visitor);
+    }
+
+    util::InflateStream inflated(in);
+    NBTReader reader(inflated);
+
+    return reader.Read(visitor);
+}
+
+bool ReadNBTFile(const std::string& path, NBT& nbt, bool mapFile) {
+    NBTTreeBuilder builder;
+
+    if (!ReadNBTFile(path, builder, mapFile)) return false;
+
+    nbt.GetRoot() = std::move(builder.GetRoot());
+    return true;
+}
+
+void WriteNBTFile(const std::string& path, const NBT& nbt, util::Compression compression) {
+    DataBuffer buffer;
+
+    buffer << nbt;
+
+    util::FileOutputStream file(path);
+
+    if (compression == util::Compression::None) {
+        file.Write(&buffer[0], buffer.GetSize());
+        file.Flush();
+        return;
+    }
+
+    util::DeflateStream deflated(file, compression);
+
+    deflated.Write(&buffer[0], buffer.GetSize());
+    deflated.Finish();
+}
+
+} // ns nbt
+} // ns mc
@@ -0,0 +1,488 @@
+#include <mclib/nbt/NBTReader.h>
+
+#include <mclib/common/DataBuffer.h>
+#include <mclib/common/MCString.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace mc {
+namespace nbt {
+
+namespace {
+
+const std::string EmptyName;
+
+void DataEndsEarly() {
+    throw std::runtime_error("NBT data ends early");
+}
+
+// Reads from bytes in memory.
+class MemorySource {
+private:
+    const u8* m_Data;
+    std::size_t m_Size;
+    std::size_t& m_Offset;
+
+public:
+    MemorySource(const u8* data, std::size_t size, std::size_t& offset)
+        : m_Data(data), m_Size(size), m_Offset(offset)
+    { }
+
+    void Read(void* data, std::size_t size) {
+        if (m_Size - m_Offset < size) DataEndsEarly();
+
+        std::memcpy(data, m_Data + m_Offset, size);
+        m_Offset += size;
+    }
+
+    void Skip(std::size_t size) {
+        if (m_Size - m_Offset < size) DataEndsEarly();
+
+        m_Offset += size;
+    }
+
+    template <typename T>
+    MemorySource& operator>>(T& value) {
+        Read(&value, sizeof(T));
+        // Switch from big endian
+        std::reverse((u8*)&value, (u8*)&value + sizeof(T));
+        return *this;
+    }
+};
+
+// Reads from a stream through a buffer that is refilled when it runs out.
+class StreamSource {
+private:
+    util::InputStream& m_In;
+    std::vector<u8>& m_Buffer;
+    std::size_t& m_Offset;
+    std::size_t& m_Size;
+
+    void Fill() {
+        m_Offset = 0;
+        m_Size = m_In.Read(m_Buffer.data(), m_Buffer.size());
+
+        if (m_Size == 0) DataEndsEarly();
+    }
+
+public:
+    StreamSource(util::InputStream& in, std::vector<u8>& buffer, std::size_t& offset, std::size_t& size)
+        : m_In(in), m_Buffer(buffer), m_Offset(offset), m_Size(size)
+    { }
+
+    void Read(void* data, std::size_t size) {
+        u8* out = (u8*)data;
+
+        while (size > 0) {
+            if (m_Offset == m_Size) Fill();
+
+            std::size_t count = std::min(size, m_Size - m_Offset);
+
+            std::memcpy(out, m_Buffer.data() + m_Offset, count);
+            m_Offset += count;
+            out += count;
+            size -= count;
+        }
+    }
+
+    void Skip(std::size_t size) {
+        while (size > 0) {
+            if (m_Offset == m_Size) Fill();
+
+            std::size_t count = std::min(size, m_Size - m_Offset);
+
+            m_Offset += count;
+            size -= count;
+        }
+    }
+
+    template <typename T>
+    StreamSource& operator>>(T& value) {
+        Read(&value, sizeof(T));
+        // Switch from big endian
+        std::reverse((u8*)&value, (u8*)&value + sizeof(T));
+        return *this;
+    }
+};
+
+template <typename Source>
+void ReadString(Source& in, std::string& str) {
+    u16 length;
+
+    in >> length;
+
+    str.resize(length);
+    if (length > 0)
+        in.Read(&str[0], length);
+}
+
+template <typename Source>
+void SkipPayload(Source& in, TagType type) {
+    switch (type) {
+        case TagType::Byte:
+            in.Skip(1);
+            break;
+        case TagType::Short:
+            in.Skip(2);
+            break;
+        case TagType::Int:
+        case TagType::Float:
+            in.Skip(4);
+            break;
+        case TagType::Long:
+        case TagType::Double:
+            in.Skip(8);
+            break;
+        case TagType::ByteArray:
+        {
+            s32 length;
+            in >> length;
+            in.Skip(std::max(length, 0));
+        }
+        break;
+        case TagType::String:
+        {
+            u16 length;
+            in >> length;
+            in.Skip(length);
+        }
+        break;
+        case TagType::List:
+        {
+            u8 elementType;
+            s32 size;
+
+            in >> elementType >> size;
+
+            for (s32 i = 0; i < size; ++i)
+                SkipPayload(in, (TagType)elementType);
+        }
+        break;
+        case TagType::Compound:
+        {
+            while (true) {
+                u8 childType;
+
+                in >> childType;
+
+                if ((TagType)childType == TagType::End) break;
+
+                u16 length;
+                in >> length;
+                in.Skip(length);
+
+                SkipPayload(in, (TagType)childType);
+            }
+        }
+        break;
+        case TagType::IntArray:
+        {
+            s32 length;
+            in >> length;
+            in.Skip((std::size_t)std::max(length, 0) * 4);
+        }
+        break;
+        default:
+            throw std::runtime_error("Error with NBTReader::SkipPayload");
+    }
+}
+
+template <typename Source>
+void ReadPayload(Source& in, TagType type, const std::string& name, NBTVisitor& visitor) {
+    switch (type) {
+        case TagType::Byte:
+        {
+            u8 value;
+            in >> value;
+            visitor.OnByte(name, value);
+        }
+        break;
+        case TagType::Short:
+        {
+            s16 value;
+            in >> value;
+            visitor.OnShort(name, value);
+        }
+        break;
+        case TagType::Int:
+        {
+            s32 value;
+            in >> value;
+            visitor.OnInt(name, value);
+        }
+        break;
+        case TagType::Long:
+        {
+            s64 value;
+            in >> value;
+            visitor.OnLong(name, value);
+        }
+        break;
+        case TagType::Float:
+        {
+            float value;
+            in >> value;
+            visitor.OnFloat(name, value);
+        }
+        break;
+        case TagType::Double:
+        {
+            double value;
+            in >> value;
+            visitor.OnDouble(name, value);
+        }
+        break;
+        case TagType::ByteArray:
+        {
+            s32 length;
+            std::string value;
+
+            in >> length;
+            value.resize(std::max(length, 0));
+            if (length > 0)
+                in.Read(&value[0], length);
+
+            visitor.OnByteArray(name, value);
+        }
+        break;
+        case TagType::String:
+        {
+            std::string value;
+
+            ReadString(in, value);
+            visitor.OnString(name, value);
+        }
+        break;
+        case TagType::List:
+        {
+            u8 elementType;
+            s32 size;
+
+            in >> elementType >> size;
+
+            NBTVisitor* inner = visitor.OnListBegin(name, (TagType)elementType, size);
+
+            if (!inner) {
+                for (s32 i = 0; i < size; ++i)
+                    SkipPayload(in, (TagType)elementType);
+                break;
+            }
+
+            for (s32 i = 0; i < size; ++i)
+                ReadPayload(in, (TagType)elementType, EmptyName, *inner);
+
+            inner->OnListEnd();
+        }
+        break;
+        case TagType::Compound:
+        {
+            NBTVisitor* inner = visitor.OnCompoundBegin(name);
+
+            if (!inner) {
+                SkipPayload(in, type);
+                break;
+            }
+
+            std::string childName;
+
+            while (true) {
+                u8 childType;
+
+                in >> childType;
+
+                if ((TagType)childType == TagType::End) break;
+
+                ReadString(in, childName);
+                ReadPayload(in, (TagType)childType, childName, *inner);
+            }
+
+            inner->OnCompoundEnd();
+        }
+        break;
+        case TagType::IntArray:
+        {
+            s32 length;
+
+            in >> length;
+
+            std::vector<s32> value(std::max(length, 0));
+
+            for (s32& element : value)
+                in >> element;
+
+            visitor.OnIntArray(name, value);
+        }
+        break;
+        default:
+            throw std::runtime_error("Error with NBTReader::ReadPayload");
+    }
+}
+
+} // ns
+
+NBTReader::NBTReader(DataBuffer& in)
+    : m_Buffer(&in), m_Data(nullptr), m_Size(0), m_Offset(0), m_Stream(nullptr)
+{
+
+}
+
+NBTReader::NBTReader(const u8* data, std::size_t size)
+    : m_Buffer(nullptr), m_Data(data), m_Size(size), m_Offset(0), m_Stream(nullptr)
+{
+
+}
+
+NBTReader::NBTReader(util::InputStream& in, std::size_t bufferSize)
+    : m_Buffer(nullptr), m_Data(nullptr), m_Size(0), m_Offset(0), m_Stream(&in), m_StreamBuffer(std::max<std::size_t>(bufferSize, 1))
+{
+
+}
+
+template <typename Func>
+bool NBTReader::Parse(Func func) {
+    if (m_Stream) {
+        StreamSource source(*m_Stream, m_StreamBuffer, m_Offset, m_Size);
+
+        return func(source);
+    }
+
+    // The buffer might have changed since the last read.
+    if (m_Buffer) {
+        m_Size = m_Buffer->GetSize();
+        m_Data = m_Size > 0 ? &(*m_Buffer)[0] : nullptr;
+        m_Offset = std::min(m_Buffer->GetReadOffset(), m_Size);
+    }
+
+    MemorySource source(m_Data, m_Size, m_Offset);
+    bool result = func(source);
+
+    if (m_Buffer)
+        m_Buffer->SetReadOffset(m_Offset);
+
+    return result;
+}
+
+bool NBTReader::Read(NBTVisitor& visitor) {
+    return Parse([&visitor](auto& in) {
+        u8 type;
+
+        in >> type;
+
+        if ((TagType)type == TagType::End) return false;
+
+        std::string name;
+        ReadString(in, name);
+
+        ReadPayload(in, (TagType)type, name, visitor);
+        return true;
+    });
+}
+
+bool NBTReader::Skip() {
+    return Parse([](auto& in) {
+        u8 type;
+
+        in >> type;
+
+        if ((TagType)type == TagType::End) return false;
+
+        u16 length;
+        in >> length;
+        in.Skip(length);
+
+        SkipPayload(in, (TagType)type);
+        return true;
+    });
+}
+
+void NBTTreeBuilder::Add(TagType type, TagPtr tag) {
+    Tag* parent = m_Stack.back();
+
+    if (parent->GetType() == TagType::List)
+        static_cast<TagList*>(parent)->AddItem(tag);
+    else
+        static_cast<TagCompound*>(parent)->AddItem(type, tag);
+}
+
+NBTVisitor* NBTTreeBuilder::OnCompoundBegin(const std::string& name) {
+    if (m_Stack.empty()) {
+        m_Root = TagCompound(utf8to16(name));
+        m_Stack.push_back(&m_Root);
+        return this;
+    }
+
+    auto compound = std::make_shared<TagCompound>(utf8to16(name));
+
+    Add(TagType::Compound, compound);
+    m_Stack.push_back(compound.get());
+    return this;
+}
+
+void NBTTreeBuilder::OnCompoundEnd() {
+    m_Stack.pop_back();
+}
+
+NBTVisitor* NBTTreeBuilder::OnListBegin(const std::string& name, TagType elementType, s32 /*size*/) {
+    // The root has to be a compound.
+    if (m_Stack.empty()) return nullptr;
+
+    auto list = std::make_shared<TagList>(utf8to16(name), elementType);
+
+    Add(TagType::List, list);
+    m_Stack.push_back(list.get());
+    return this;
+}
+
+void NBTTreeBuilder::OnListEnd() {
+    m_Stack.pop_back();
+}
+
+void NBTTreeBuilder::OnByte(const std::string& name, u8 value) {
+    if (!m_Stack.empty())
+        Add(TagType::Byte, std::make_shared<TagByte>(utf8to16(name), value));
+}
+
+void NBTTreeBuilder::OnShort(const std::string& name, s16 value) {
+    if (!m_Stack.empty())
+        Add(TagType::Short, std::make_shared<TagShort>(utf8to16(name), value));
+}
+
+void NBTTreeBuilder::OnInt(const std::string& name, s32 value) {
+    if (!m_Stack.empty())
+        Add(TagType::Int, std::make_shared<TagInt>(utf8to16(name), value));
+}
+
+void NBTTreeBuilder::OnLong(const std::string& name, s64 value) {
+    if (!m_Stack.empty())
+        Add(TagType::Long, std::make_shared<TagLong>(utf8to16(name), value));
+}
+
+void NBTTreeBuilder::OnFloat(const std::string& name, float value) {
+    if (!m_Stack.empty())
+        Add(TagType::Float, std::make_shared<TagFloat>(utf8to16(name), value));
+}
+
+void NBTTreeBuilder::OnDouble(const std::string& name, double value) {
+    if (!m_Stack.empty())
+        Add(TagType::Double, std::make_shared<TagDouble>(utf8to16(name), value));
+}
+
+void NBTTreeBuilder::OnByteArray(const std::string& name, const std::string& value) {
+    if (!m_Stack.empty())
+        Add(TagType::ByteArray, std::make_shared<TagByteArray>(utf8to16(name), value));
+}
+
+void NBTTreeBuilder::OnString(const std::string& name, const std::string& value) {
+    if (!m_Stack.empty())
+        Add(TagType::String, std::make_shared<TagString>(utf8to16(name), utf8to16(value)));
+}
+
+void NBTTreeBuilder::OnIntArray(const std::string& name, const std::vector<s32>& value) {
+    if (!m_Stack.empty())
+        Add(TagType::IntArray, std::make_shared<TagIntArray>(utf8to16(name), value));
+}
+
+} // ns nbt
+} // ns mc
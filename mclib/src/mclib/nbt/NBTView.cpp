@@ -0,0 +1,319 @@
+#include <mclib/nbt/NBTView.h>
+
+#include <mclib/common/DataBuffer.h>
+#include <mclib/nbt/NBT.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace mc {
+namespace nbt {
+
+namespace {
+
+template <typename T>
+T ReadValue(const char* data) {
+    T value;
+
+    std::memcpy(&value, data, sizeof(T));
+    // Switch from big endian
+    std::reverse((u8*)&value, (u8*)&value + sizeof(T));
+    return value;
+}
+
+// Size of the payload of a tag that doesn't depend on its value, 0 for the others.
+std::size_t GetFixedSize(TagType type) {
+    switch (type) {
+        case TagType::Byte: return 1;
+        case TagType::Short: return 2;
+        case TagType::Int: case TagType::Float: return 4;
+        case TagType::Long: case TagType::Double: return 8;
+        default: return 0;
+    }
+}
+
+void Require(std::size_t size, std::size_t offset, std::size_t amount) {
+    if (offset > size || size - offset < amount)
+        throw std::runtime_error("NBT data ends early");
+}
+
+// Returns the offset after the payload at offset. Checks that the payload fits into size.
+std::size_t SkipPayload(const char* data, std::size_t size, std::size_t offset, TagType type) {
+    std::size_t fixed = GetFixedSize(type);
+
+    if (fixed > 0) {
+        Require(size, offset, fixed);
+        return offset + fixed;
+    }
+
+    switch (type) {
+        case TagType::ByteArray:
+        case TagType::IntArray:
+        {
+            Require(size, offset, 4);
+
+            s32 length = ReadValue<s32>(data + offset);
+            std::size_t bytes = (std::size_t)std::max(length, 0) * (type == TagType::IntArray ? 4 : 1);
+
+            Require(size, offset + 4, bytes);
+            return offset + 4 + bytes;
+        }
+        case TagType::String:
+        {
+            Require(size, offset, 2);
+
+            u16 length = ReadValue<u16>(data + offset);
+
+            Require(size, offset + 2, length);
+            return offset + 2 + length;
+        }
+        case TagType::List:
+        {
+            Require(size, offset, 5);
+
+            TagType elementType = (TagType)data[offset];
+            s32 length = ReadValue<s32>(data + offset + 1);
+
+            offset += 5;
+
+            std::size_t elementSize = GetFixedSize(elementType);
+            if (elementSize > 0) {
+                std::size_t bytes = (std::size_t)std::max(length, 0) * elementSize;
+
+                Require(size, offset, bytes);
+                return offset + bytes;
+            }
+
+            for (s32 i = 0; i < length; ++i)
+                offset = SkipPayload(data, size, offset, elementType);
+
+            return offset;
+        }
+        case TagType::Compound:
+        {
+            while (true) {
+                Require(size, offset, 1);
+
+                TagType childType = (TagType)data[offset];
+
+                if (childType == TagType::End) return offset + 1;
+
+                Require(size, offset + 1, 2);
+                u16 length = ReadValue<u16>(data + offset + 1);
+
+                offset = SkipPayload(data, size, offset + 3 + length, childType);
+            }
+        }
+        default:
+            throw std::runtime_error("Unknown NBT tag type");
+    }
+}
+
+// Returns the offset after the named tag at offset, or offset + 1 if it is an end tag.
+std::size_t SkipTag(const char* data, std::size_t size, std::size_t offset) {
+    Require(size, offset, 1);
+
+    TagType type = (TagType)data[offset];
+    if (type == TagType::End) return offset + 1;
+
+    Require(size, offset + 1, 2);
+    u16 length = ReadValue<u16>(data + offset + 1);
+
+    return SkipPayload(data, size, offset + 3 + length, type);
+}
+
+} // ns
+
+NBTView NBTView::Read(DataBuffer& in) {
+    std::size_t begin = in.GetReadOffset();
+    std::size_t size = in.GetSize();
+    const char* data = size > 0 ? (const char*)&in[0] : nullptr;
+    std::size_t end = SkipTag(data, size, begin);
+
+    in.SetReadOffset(end);
+
+    if ((TagType)data[begin] == TagType::End) return NBTView();
+
+    return Parse(std::string(data + begin, data + end));
+}
+
+NBTView NBTView::Parse(std::string data) {
+    std::size_t end = SkipTag(data.data(), data.size(), 0);
+
+    if (end > std::numeric_limits<u32>::max())
+        throw std::runtime_error("NBT data is too large to view");
+
+    TagType type = (TagType)data[0];
+    if (type == TagType::End) return NBTView();
+
+    data.resize(end);
+
+    auto document = std::make_shared<Document>();
+    document->data = std::move(data);
+
+    const char* bytes = document->data.data();
+    u16 length = ReadValue<u16>(bytes + 1);
+
+    return NBTView(document, StringView(bytes + 3, length), type, 3 + length);
+}
+
+const std::vector<NBTView::Child>& NBTView::GetChildren() const {
+    auto iter = m_Document->indexes.find(m_Offset);
+    if (iter != m_Document->indexes.end()) return iter->second;
+
+    const char* data = m_Document->data.data();
+    std::size_t size = m_Document->data.size();
+    std::vector<Child> children;
+    std::size_t offset = m_Offset;
+
+    if (m_Type == TagType::Compound) {
+        while (true) {
+            TagType type = (TagType)data[offset];
+            if (type == TagType::End) break;
+
+            u16 length = ReadValue<u16>(data + offset + 1);
+            std::size_t payload = offset + 3 + length;
+
+            children.push_back(Child{ StringView(data + offset + 3, length), type, (u32)payload });
+            offset = SkipPayload(data, size, payload, type);
+        }
+
+        // Stable so that Find returns the first of duplicate names.
+        std::stable_sort(children.begin(), children.end());
+    } else if (m_Type == TagType::List) {
+        TagType elementType = (TagType)data[offset];
+        s32 length = ReadValue<s32>(data + offset + 1);
+
+        offset += 5;
+        children.reserve(std::max(length, 0));
+
+        for (s32 i = 0; i < length; ++i) {
+            children.push_back(Child{ StringView(), elementType, (u32)offset });
+            offset = SkipPayload(data, size, offset, elementType);
+        }
+    }
+
+    return m_Document->indexes.emplace(m_Offset, std::move(children)).first->second;
+}
+
+u8 NBTView::GetByte() const noexcept {
+    return m_Type == TagType::Byte ? (u8)*GetPayload() : 0;
+}
+
+s16 NBTView::GetShort() const noexcept {
+    return m_Type == TagType::Short ? ReadValue<s16>(GetPayload()) : 0;
+}
+
+s32 NBTView::GetInt() const noexcept {
+    return m_Type == TagType::Int ? ReadValue<s32>(GetPayload()) : 0;
+}
+
+s64 NBTView::GetLong() const noexcept {
+    return m_Type == TagType::Long ? ReadValue<s64>(GetPayload()) : 0;
+}
+
+float NBTView::GetFloat() const noexcept {
+    return m_Type == TagType::Float ? ReadValue<float>(GetPayload()) : 0.0f;
+}
+
+double NBTView::GetDouble() const noexcept {
+    return m_Type == TagType::Double ? ReadValue<double>(GetPayload()) : 0.0;
+}
+
+StringView NBTView::GetString() const noexcept {
+    if (m_Type != TagType::String) return StringView();
+
+    const char* payload = GetPayload();
+    return StringView(payload + 2, ReadValue<u16>(payload));
+}
+
+StringView NBTView::GetByteArray() const noexcept {
+    if (m_Type != TagType::ByteArray) return StringView();
+
+    const char* payload = GetPayload();
+    return StringView(payload + 4, std::max(ReadValue<s32>(payload), 0));
+}
+
+std::vector<s32> NBTView::GetIntArray() const {
+    std::vector<s32> values(m_Type == TagType::IntArray ? GetSize() : 0);
+    const char* payload = GetPayload() + 4;
+
+    for (std::size_t i = 0; i < values.size(); ++i)
+        values[i] = ReadValue<s32>(payload + i * 4);
+
+    return values;
+}
+
+std::size_t NBTView::GetSize() const {
+    switch (m_Type) {
+        case TagType::Compound:
+            return GetChildren().size();
+        case TagType::List:
+            return std::max(ReadValue<s32>(GetPayload() + 1), 0);
+        case TagType::ByteArray:
+        case TagType::IntArray:
+            return std::max(ReadValue<s32>(GetPayload()), 0);
+        default:
+            return 0;
+    }
+}
+
+TagType NBTView::GetElementType() const noexcept {
+    return m_Type == TagType::List ? (TagType)*GetPayload() : TagType::End;
+}
+
+NBTView NBTView::operator[](std::size_t index) const {
+    if (m_Type == TagType::List) {
+        if (index >= GetSize()) return NBTView();
+
+        TagType elementType = GetElementType();
+        std::size_t elementSize = GetFixedSize(elementType);
+
+        // Elements with a fixed size don't need an index.
+        if (elementSize > 0)
+            return NBTView(m_Document, StringView(), elementType, (u32)(m_Offset + 5 + index * elementSize));
+    } else if (m_Type != TagType::Compound) {
+        return NBTView();
+    }
+
+    const std::vector<Child>& children = GetChildren();
+    if (index >= children.size()) return NBTView();
+
+    const Child& child = children[index];
+    return NBTView(m_Document, child.name, child.type, child.offset);
+}
+
+NBTView NBTView::Find(StringView name) const {
+    if (m_Type != TagType::Compound) return NBTView();
+
+    const std::vector<Child>& children = GetChildren();
+    auto iter = std::lower_bound(children.begin(), children.end(), name, [](const Child& child, StringView name) {
+        return child.name < name;
+    });
+
+    if (iter == children.end() || iter->name != name) return NBTView();
+
+    return NBTView(m_Document, iter->name, iter->type, iter->offset);
+}
+
+NBT NBTView::ToNBT() const {
+    NBT nbt;
+
+    if (m_Type != TagType::Compound) return nbt;
+
+    const std::string& data = m_Document->data;
+    std::size_t end = SkipPayload(data.data(), data.size(), m_Offset, m_Type);
+    DataBuffer buffer;
+
+    buffer << (u8)TagType::Compound << (u16)m_Name.size();
+    buffer << std::string(m_Name.data(), m_Name.size());
+    buffer << data.substr(m_Offset, end - m_Offset);
+
+    buffer >> nbt;
+    return nbt;
+}
+
+} // ns nbt
+} // ns mc
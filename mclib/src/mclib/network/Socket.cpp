@@ -4,6 +4,10 @@
 #include <mclib/network/IPAddress.h>
 #include <mclib/network/Network.h>
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 namespace mc {
 namespace network {
 
@@ -72,6 +76,28 @@ std::size_t Socket::Send(DataBuffer& buffer) {
     return this->Send(reinterpret_cast<const unsigned char*>(data.c_str()), data.length());
 }
 
+bool Socket::WaitForData(s64 timeout) {
+    // A negative timeout would block until data arrives
+    int time = (int)std::max<s64>(timeout, 0);
+
+    // Nothing can arrive, but callers still expect to be blocked for the timeout instead of spinning.
+    if (m_Handle == INVALID_SOCKET || m_Status != Connected) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(time));
+        return false;
+    }
+
+    pollfd fd;
+    fd.fd = m_Handle;
+    fd.events = POLLIN;
+    fd.revents = 0;
+
+#ifdef _WIN32
+    return WSAPoll(&fd, 1, time) > 0;
+#else
+    return poll(&fd, 1, time) > 0;
+#endif
+}
+
 void Socket::Disconnect() {
     if (m_Handle != INVALID_SOCKET)
         closesocket(m_Handle);
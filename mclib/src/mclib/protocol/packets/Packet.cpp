@@ -479,10 +479,7 @@ bool UpdateBlockEntityPacket::Deserialize(DataBuffer& data, std::size_t packetLe
     data >> pos;
     data >> action;
 
-    nbt::NBT nbt;
-    data >> nbt;
-
-    m_BlockEntity = block::BlockEntity::CreateFromNBT(&nbt);
+    m_BlockEntity = block::BlockEntity::CreateFromNBT(data);
     m_Position = Vector3i(pos.GetX(), pos.GetY(), pos.GetZ());
     m_Action = (Action)action;
 
@@ -655,7 +652,7 @@ void TabCompletePacket::Dispatch(PacketHandler* handler) {
     handler->HandlePacket(this);
 }
 
-ChatPacket::ChatPacket() {
+ChatPacket::ChatPacket() : m_ChatParsed(false) {
     
 }
 
@@ -667,14 +664,25 @@ bool ChatPacket::Deserialize(DataBuffer& data, std::size_t packetLength) {
     data >> position;
 
     m_Position = (ChatPosition)position;
+    m_ChatJson = chatData.GetUTF8();
+    m_ChatData = json();
+    m_ChatParsed = false;
+    
+    return true;
+}
+
+const nlohmann::json& ChatPacket::GetChatData() const {
+    if (!m_ChatParsed) {
+        m_ChatParsed = true;
 
-    try {
-        m_ChatData = json::parse(chatData.GetUTF8());
-    } catch (json::parse_error&) {
+        try {
+            m_ChatData = json::parse(m_ChatJson);
+        } catch (json::parse_error&) {
 
+        }
     }
-    
-    return true;
+
+    return m_ChatData;
 }
 
 void ChatPacket::Dispatch(PacketHandler* handler) {
@@ -1018,11 +1026,7 @@ bool ChunkDataPacket::Deserialize(DataBuffer& data, std::size_t packetLength) {
     s32 entityCount = entities.GetInt();
 
     for (s32 i = 0; i < entities.GetInt(); ++i) {
-        nbt::NBT nbt;
-
-        data >> nbt;
-
-        block::BlockEntityPtr blockEntity = block::BlockEntity::CreateFromNBT(&nbt);
+        block::BlockEntityPtr blockEntity = block::BlockEntity::CreateFromNBT(data);
 
         if (blockEntity == nullptr) continue;
 
@@ -2171,7 +2175,8 @@ bool EntityPropertiesPacket::Deserialize(DataBuffer& data, std::size_t packetLen
         data >> key;
         data >> value;
 
-        mc::entity::Attribute attribute(key.GetUTF16(), value);
+        // Keys are never freed. Vanilla servers only send a small fixed set of them.
+        mc::entity::Attribute attribute(util::InternedString(key.GetUTF8()), value);
 
         VarInt modifierCount;
         data >> modifierCount;
@@ -2190,7 +2195,7 @@ bool EntityPropertiesPacket::Deserialize(DataBuffer& data, std::size_t packetLen
             attribute.AddModifier(modifier);
         }
 
-        m_Properties.insert(std::make_pair(attribute.GetKey(), attribute));
+        m_Properties.insert(std::make_pair(attribute.GetInternedKey(), attribute));
     }
     return true;
 }
@@ -0,0 +1,88 @@
+#include <mclib/util/Arena.h>
+
+#include <algorithm>
+
+namespace mc {
+namespace util {
+
+Arena::Arena(std::size_t initialBlockSize, std::size_t maxBlockSize)
+    : m_Current(nullptr),
+      m_Remaining(0),
+      m_NextBlockSize(std::max<std::size_t>(initialBlockSize, 16)),
+      m_MaxBlockSize(std::max(maxBlockSize, initialBlockSize)),
+      m_Used(0),
+      m_Capacity(0)
+{
+
+}
+
+Arena::Arena(Arena&& other) noexcept
+    : m_Blocks(std::move(other.m_Blocks)),
+      m_Current(other.m_Current),
+      m_Remaining(other.m_Remaining),
+      m_NextBlockSize(other.m_NextBlockSize),
+      m_MaxBlockSize(other.m_MaxBlockSize),
+      m_Used(other.m_Used),
+      m_Capacity(other.m_Capacity)
+{
+    other.m_Blocks.clear();
+    other.m_Current = nullptr;
+    other.m_Remaining = 0;
+    other.m_Used = 0;
+    other.m_Capacity = 0;
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept {
+    if (this == &other) return *this;
+
+    m_Blocks = std::move(other.m_Blocks);
+    m_Current = other.m_Current;
+    m_Remaining = other.m_Remaining;
+    m_NextBlockSize = other.m_NextBlockSize;
+    m_MaxBlockSize = other.m_MaxBlockSize;
+    m_Used = other.m_Used;
+    m_Capacity = other.m_Capacity;
+
+    other.m_Blocks.clear();
+    other.m_Current = nullptr;
+    other.m_Remaining = 0;
+    other.m_Used = 0;
+    other.m_Capacity = 0;
+    return *this;
+}
+
+void* Arena::AllocateBlock(std::size_t size, std::size_t alignment) {
+    std::size_t required = size + alignment;
+    std::size_t blockSize = std::max(m_NextBlockSize, required);
+
+    m_Blocks.emplace_back(new char[blockSize]);
+    m_Capacity += blockSize;
+
+    if (m_NextBlockSize < m_MaxBlockSize)
+        m_NextBlockSize = std::min(m_NextBlockSize * 2, m_MaxBlockSize);
+
+    char* block = m_Blocks.back().get();
+    std::size_t padding = (alignment - ((std::uintptr_t)block & (alignment - 1))) & (alignment - 1);
+    char* result = block + padding;
+
+    // Keep allocating from whichever block has more space left.
+    std::size_t remaining = blockSize - padding - size;
+    if (remaining >= m_Remaining) {
+        m_Current = result + size;
+        m_Remaining = remaining;
+    }
+
+    m_Used += size;
+    return result;
+}
+
+void Arena::Clear() {
+    m_Blocks.clear();
+    m_Current = nullptr;
+    m_Remaining = 0;
+    m_Used = 0;
+    m_Capacity = 0;
+}
+
+} // ns util
+} // ns mc
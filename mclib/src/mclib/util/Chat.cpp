@@ -0,0 +1,487 @@
+#include <mclib/util/Chat.h>
+
+#include <mclib/common/Types.h>
+
+#include <cctype>
+#include <cstring>
+#include <iterator>
+
+namespace mc {
+namespace util {
+
+namespace {
+
+struct MalformedChat { };
+
+// Deeper nesting than this is treated as malformed instead of recursing further.
+const int MaxDepth = 64;
+
+enum StyleField : u8 {
+    Color = 1 << 0,
+    Bold = 1 << 1,
+    Italic = 1 << 2,
+    Underlined = 1 << 3,
+    Strikethrough = 1 << 4,
+    Obfuscated = 1 << 5
+};
+
+// A span whose style can still be inherited from the components that contain it.
+struct PendingSpan {
+    ChatSpan span;
+    // The style fields that were already set by the span's own component or one closer to it.
+    u8 set;
+};
+
+struct Translation {
+    const char* key;
+    // Each %s is replaced by the next argument.
+    const char* format;
+};
+
+const Translation Translations[] = {
+    { "chat.type.text", "<%s> %s" },
+    { "chat.type.emote", "* %s %s" },
+    { "chat.type.announcement", "[%s] %s" },
+    { "chat.type.admin", "[%s: %s]" },
+    { "chat.type.advancement.task", "%s has made the advancement %s" },
+    { "chat.type.advancement.goal", "%s has reached the goal %s" },
+    { "chat.type.advancement.challenge", "%s has completed the challenge %s" },
+    { "commands.message.display.incoming", "%s whispers to you: %s" },
+    { "commands.message.display.outgoing", "You whisper to %s: %s" },
+    { "multiplayer.player.joined", "%s joined the game" },
+    { "multiplayer.player.left", "%s left the game" }
+};
+
+void EncodeUTF8(u32 codePoint, std::string& out) {
+    if (codePoint < 0x80) {
+        out.push_back((char)codePoint);
+    } else if (codePoint < 0x800) {
+        out.push_back((char)(0xC0 | (codePoint >> 6)));
+        out.push_back((char)(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+        out.push_back((char)(0xE0 | (codePoint >> 12)));
+        out.push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (codePoint & 0x3F)));
+    } else {
+        out.push_back((char)(0xF0 | (codePoint >> 18)));
+        out.push_back((char)(0x80 | ((codePoint >> 12) & 0x3F)));
+        out.push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (codePoint & 0x3F)));
+    }
+}
+
+void Inherit(PendingSpan& pending, const ChatSpan& style, u8 set) {
+    u8 missing = set & ~pending.set;
+    ChatSpan& span = pending.span;
+
+    if (missing & Color) span.color = style.color;
+    if (missing & Bold) span.bold = style.bold;
+    if (missing & Italic) span.italic = style.italic;
+    if (missing & Underlined) span.underlined = style.underlined;
+    if (missing & Strikethrough) span.strikethrough = style.strikethrough;
+    if (missing & Obfuscated) span.obfuscated = style.obfuscated;
+
+    pending.set |= missing;
+}
+
+void AddText(std::vector<PendingSpan>& spans, std::string text) {
+    if (text.empty()) return;
+
+    spans.emplace_back();
+    spans.back().span.text = std::move(text);
+    spans.back().set = 0;
+}
+
+// Turns chat component JSON into spans while it is read. Only the text and style keys are decoded, everything else is skipped.
+class ChatParser {
+private:
+    const char* m_Pos;
+    const char* m_End;
+    bool m_Styled;
+    // Where the spans of the component that is being read go.
+    std::vector<PendingSpan>* m_Spans;
+    std::string m_Key;
+    int m_Depth;
+
+    char Peek() {
+        while (m_Pos < m_End && (*m_Pos == ' ' || *m_Pos == '\t' || *m_Pos == '\n' || *m_Pos == '\r'))
+            ++m_Pos;
+
+        if (m_Pos == m_End) throw MalformedChat();
+        return *m_Pos;
+    }
+
+    void Expect(char c) {
+        if (Peek() != c) throw MalformedChat();
+        ++m_Pos;
+    }
+
+    // Consumes the separator after an element of an array or object. Returns false at the end of it.
+    bool Next(char close) {
+        char c = Peek();
+
+        ++m_Pos;
+        if (c == ',') return true;
+        if (c == close) return false;
+
+        throw MalformedChat();
+    }
+
+    // Consumes the opening character and returns false if the array or object is empty.
+    bool Begin(char open, char close) {
+        Expect(open);
+
+        if (Peek() != close) return true;
+
+        ++m_Pos;
+        return false;
+    }
+
+    void Enter() {
+        if (++m_Depth > MaxDepth) throw MalformedChat();
+    }
+
+    u32 ReadHex() {
+        if (m_End - m_Pos < 4) throw MalformedChat();
+
+        u32 value = 0;
+
+        for (int i = 0; i < 4; ++i) {
+            char c = *m_Pos++;
+
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else throw MalformedChat();
+        }
+
+        return value;
+    }
+
+    void ParseString(std::string& out) {
+        Expect('"');
+        out.clear();
+
+        while (true) {
+            const char* start = m_Pos;
+
+            while (m_Pos < m_End && *m_Pos != '"' && *m_Pos != '\\')
+                ++m_Pos;
+
+            out.append(start, m_Pos);
+
+            if (m_End - m_Pos < 2) {
+                if (m_Pos < m_End && *m_Pos == '"') {
+                    ++m_Pos;
+                    return;
+                }
+                throw MalformedChat();
+            }
+
+            if (*m_Pos++ == '"') return;
+
+            char escape = *m_Pos++;
+
+            switch (escape) {
+                case '"': case '\\': case '/': out.push_back(escape); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u':
+                {
+                    u32 codePoint = ReadHex();
+
+                    if (codePoint >= 0xD800 && codePoint <= 0xDBFF && m_End - m_Pos >= 6 && m_Pos[0] == '\\' && m_Pos[1] == 'u') {
+                        const char* high = m_Pos;
+
+                        m_Pos += 2;
+                        u32 low = ReadHex();
+
+                        if (low >= 0xDC00 && low <= 0xDFFF)
+                            codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        else
+                            m_Pos = high;
+                    }
+
+                    if (codePoint >= 0xD800 && codePoint <= 0xDFFF)
+                        codePoint = 0xFFFD;
+
+                    EncodeUTF8(codePoint, out);
+                }
+                break;
+                default:
+                    throw MalformedChat();
+            }
+        }
+    }
+
+    void SkipString() {
+        Expect('"');
+
+        while (m_Pos < m_End) {
+            char c = *m_Pos++;
+
+            if (c == '"') return;
+            if (c == '\\') ++m_Pos;
+        }
+
+        throw MalformedChat();
+    }
+
+    void SkipValue() {
+        char c = Peek();
+
+        if (c == '"') {
+            SkipString();
+        } else if (c == '{') {
+            Enter();
+            if (Begin('{', '}')) {
+                do {
+                    SkipString();
+                    Expect(':');
+                    SkipValue();
+                } while (Next('}'));
+            }
+            --m_Depth;
+        } else if (c == '[') {
+            Enter();
+            if (Begin('[', ']')) {
+                do {
+                    SkipValue();
+                } while (Next(']'));
+            }
+            --m_Depth;
+        } else {
+            // Numbers, true, false and null
+            const char* start = m_Pos;
+
+            while (m_Pos < m_End && (std::isalnum((unsigned char)*m_Pos) || *m_Pos == '-' || *m_Pos == '+' || *m_Pos == '.'))
+                ++m_Pos;
+
+            if (m_Pos == start) throw MalformedChat();
+        }
+    }
+
+    // Reads a boolean into value. Other values are skipped and false is returned.
+    bool ParseBool(bool& value) {
+        Peek();
+
+        if (m_End - m_Pos >= 4 && std::memcmp(m_Pos, "true", 4) == 0) {
+            m_Pos += 4;
+            value = true;
+            return true;
+        }
+
+        if (m_End - m_Pos >= 5 && std::memcmp(m_Pos, "false", 5) == 0) {
+            m_Pos += 5;
+            value = false;
+            return true;
+        }
+
+        SkipValue();
+        return false;
+    }
+
+    void ParseComponentList() {
+        if (!Begin('[', ']')) return;
+
+        do {
+            ParseComponent();
+        } while (Next(']'));
+    }
+
+    void ParseComponent() {
+        char c = Peek();
+
+        Enter();
+
+        if (c == '"') {
+            std::string text;
+
+            ParseString(text);
+            AddText(*m_Spans, std::move(text));
+        } else if (c == '{') {
+            ParseObject();
+        } else if (c == '[') {
+            ParseComponentList();
+        } else {
+            SkipValue();
+        }
+
+        --m_Depth;
+    }
+
+    void ParseObject() {
+        std::vector<PendingSpan>* spans = m_Spans;
+        std::size_t start = spans->size();
+        std::string text;
+        std::string translate;
+        bool hasTranslate = false;
+        std::vector<std::vector<PendingSpan>> args;
+        ChatSpan style;
+        u8 set = 0;
+
+        if (Begin('{', '}')) {
+            do {
+                ParseString(m_Key);
+                Expect(':');
+
+                if (m_Key == "text" && Peek() == '"') {
+                    ParseString(text);
+                } else if (m_Key == "extra" && Peek() == '[') {
+                    ParseComponentList();
+                } else if (m_Key == "translate" && Peek() == '"') {
+                    ParseString(translate);
+                    hasTranslate = true;
+                } else if (m_Key == "with" && Peek() == '[') {
+                    if (Begin('[', ']')) {
+                        do {
+                            args.emplace_back();
+                            m_Spans = &args.back();
+                            ParseComponent();
+                            m_Spans = spans;
+                        } while (Next(']'));
+                    }
+                } else if (m_Styled && m_Key == "color" && Peek() == '"') {
+                    ParseString(style.color);
+                    set |= Color;
+                } else if (m_Styled && m_Key == "bold") {
+                    if (ParseBool(style.bold)) set |= Bold;
+                } else if (m_Styled && m_Key == "italic") {
+                    if (ParseBool(style.italic)) set |= Italic;
+                } else if (m_Styled && m_Key == "underlined") {
+                    if (ParseBool(style.underlined)) set |= Underlined;
+                } else if (m_Styled && m_Key == "strikethrough") {
+                    if (ParseBool(style.strikethrough)) set |= Strikethrough;
+                } else if (m_Styled && m_Key == "obfuscated") {
+                    if (ParseBool(style.obfuscated)) set |= Obfuscated;
+                } else {
+                    SkipValue();
+                }
+            } while (Next('}'));
+        }
+
+        // The text of the component goes before its extra components, which might have been read first.
+        std::vector<PendingSpan> own;
+
+        if (hasTranslate)
+            Translate(translate, args, own);
+        else
+            AddText(own, std::move(text));
+
+        if (!own.empty())
+            spans->insert(spans->begin() + start, std::make_move_iterator(own.begin()), std::make_move_iterator(own.end()));
+
+        if (set != 0) {
+            for (std::size_t i = start; i < spans->size(); ++i)
+                Inherit((*spans)[i], style, set);
+        }
+    }
+
+    void Translate(const std::string& key, std::vector<std::vector<PendingSpan>>& args, std::vector<PendingSpan>& out) {
+        const char* format = nullptr;
+
+        for (const Translation& translation : Translations) {
+            if (key == translation.key) {
+                format = translation.format;
+                break;
+            }
+        }
+
+        if (format == nullptr) {
+            if (args.empty()) {
+                AddText(out, key);
+                return;
+            }
+
+            for (std::size_t i = 0; i < args.size(); ++i) {
+                if (i > 0) AddText(out, " ");
+
+                std::move(args[i].begin(), args[i].end(), std::back_inserter(out));
+            }
+            return;
+        }
+
+        std::size_t next = 0;
+        std::string literal;
+
+        for (const char* p = format; *p; ++p) {
+            if (p[0] != '%' || p[1] != 's') {
+                literal.push_back(*p);
+                continue;
+            }
+
+            AddText(out, std::move(literal));
+            literal.clear();
+
+            if (next < args.size())
+                std::move(args[next].begin(), args[next].end(), std::back_inserter(out));
+
+            ++next;
+            ++p;
+        }
+
+        AddText(out, std::move(literal));
+    }
+
+public:
+    ChatParser(const std::string& json, bool styled, std::vector<PendingSpan>& spans)
+        : m_Pos(json.data()), m_End(json.data() + json.size()), m_Styled(styled), m_Spans(&spans), m_Depth(0)
+    {
+
+    }
+
+    void Parse() {
+        ParseComponent();
+
+        while (m_Pos < m_End && (*m_Pos == ' ' || *m_Pos == '\t' || *m_Pos == '\n' || *m_Pos == '\r'))
+            ++m_Pos;
+
+        if (m_Pos != m_End) throw MalformedChat();
+    }
+};
+
+} // ns
+
+std::string ExtractChatText(const std::string& json) {
+    std::vector<PendingSpan> spans;
+
+    try {
+        ChatParser(json, false, spans).Parse();
+    } catch (MalformedChat&) {
+        return "";
+    }
+
+    if (spans.size() == 1) return std::move(spans[0].span.text);
+
+    std::string text;
+
+    for (const PendingSpan& pending : spans)
+        text += pending.span.text;
+
+    return text;
+}
+
+std::vector<ChatSpan> ExtractChatSpans(const std::string& json) {
+    std::vector<PendingSpan> spans;
+
+    try {
+        ChatParser(json, true, spans).Parse();
+    } catch (MalformedChat&) {
+        return std::vector<ChatSpan>();
+    }
+
+    std::vector<ChatSpan> result;
+
+    result.reserve(spans.size());
+    for (PendingSpan& pending : spans)
+        result.push_back(std::move(pending.span));
+
+    return result;
+}
+
+} // ns util
+} // ns mc
@@ -147,7 +147,7 @@ ForgeHandler::ForgeHandler(protocol::packets::PacketDispatcher* dispatcher, core
     dispatcher->RegisterHandler(protocol::State::Status, protocol::status::Response, this);
 
     m_Handlers = HandlerMap {
-        { L"FML|HS", std::bind(&ForgeHandler::HandleData, this, std::placeholders::_1) },
+        { InternedString("FML|HS"), std::bind(&ForgeHandler::HandleData, this, std::placeholders::_1) },
     };
 }
 
@@ -198,9 +198,8 @@ void ForgeHandler::HandlePacket(protocol::packets::in::status::ResponsePacket* p
 }
 
 void ForgeHandler::HandlePacket(protocol::packets::in::PluginMessagePacket* packet) {
-    std::wstring channel = packet->GetChannel();
-
-    auto iter = m_Handlers.find(channel);
+    // Channels without a handler aren't interned.
+    auto iter = m_Handlers.find(InternedString::Find(packet->GetChannelUTF8()));
     if (iter == m_Handlers.end()) {
         return;
     }
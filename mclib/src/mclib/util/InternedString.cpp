@@ -0,0 +1,107 @@
+#include <mclib/util/InternedString.h>
+
+#include <mclib/common/MCString.h>
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace mc {
+namespace util {
+
+namespace {
+
+class Interner {
+private:
+    // Almost every lookup finds a string that was interned before, so those only take a shared lock.
+    std::shared_timed_mutex m_Mutex;
+    // A deque never moves its elements, so the entries and the views of their values stay valid.
+    std::deque<InternedString::Entry> m_Entries;
+    std::unordered_map<StringView, const InternedString::Entry*> m_Lookup;
+
+public:
+    const InternedString::Entry* Intern(StringView str) {
+        const InternedString::Entry* existing = Find(str);
+        if (existing) return existing;
+
+        std::lock_guard<std::shared_timed_mutex> lock(m_Mutex);
+
+        // Another thread could have interned it between the locks.
+        auto iter = m_Lookup.find(str);
+        if (iter != m_Lookup.end()) return iter->second;
+
+        InternedString::Entry entry;
+
+        entry.value = str.ToString();
+        // 0 is the empty string.
+        entry.id = (u32)m_Entries.size() + 1;
+
+        m_Entries.push_back(std::move(entry));
+
+        const InternedString::Entry* result = &m_Entries.back();
+
+        m_Lookup.emplace(StringView(result->value), result);
+        return result;
+    }
+
+    const InternedString::Entry* Find(StringView str) {
+        std::shared_lock<std::shared_timed_mutex> lock(m_Mutex);
+
+        auto iter = m_Lookup.find(str);
+        if (iter == m_Lookup.end()) return nullptr;
+
+        return iter->second;
+    }
+
+    std::size_t GetCount() {
+        std::shared_lock<std::shared_timed_mutex> lock(m_Mutex);
+
+        return m_Entries.size();
+    }
+};
+
+Interner& GetInterner() {
+    static Interner interner;
+
+    return interner;
+}
+
+} // ns
+
+InternedString::InternedString(StringView str)
+    : m_Entry(str.empty() ? nullptr : GetInterner().Intern(str))
+{
+
+}
+
+InternedString::InternedString(const std::wstring& str)
+    : InternedString(StringView(utf16to8(str)))
+{
+
+}
+
+InternedString InternedString::Find(StringView str) {
+    if (str.empty()) return InternedString();
+
+    return InternedString(GetInterner().Find(str));
+}
+
+const std::string& InternedString::GetString() const noexcept {
+    static const std::string empty;
+
+    return m_Entry ? m_Entry->value : empty;
+}
+
+std::wstring InternedString::GetUTF16() const {
+    if (!m_Entry) return std::wstring();
+
+    return utf8to16(m_Entry->value);
+}
+
+std::size_t InternedString::GetCount() {
+    return GetInterner().GetCount();
+}
+
+} // ns util
+} // ns mc
@@ -0,0 +1,578 @@
+#include <mclib/util/PathPlanner.h>
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace mc {
+namespace util {
+
+// The walkability of one server world, shared by every registered world with the same key.
+// Written on the threads of those worlds and read by the workers.
+class PathPlanner::WorldGrid {
+public:
+    PathPlanner& m_Planner;
+
+    std::mutex m_Mutex;
+    std::unordered_map<Vector3i, SectionPtr, Vector3Hash<s64>> m_Sections;
+    // Number of registered worlds that have each column loaded. The column is dropped when the last one unloads it.
+    std::map<std::pair<s32, s32>, std::size_t> m_ColumnRefs;
+
+    // Searches are keyed by goal. Only added and removed while the planner's world mutex is held.
+    std::mutex m_SearchMutex;
+    std::unordered_map<Vector3i, std::shared_ptr<Search>, Vector3Hash<s64>> m_Searches;
+
+    // Number of registered worlds that use this grid. Guarded by the planner's world mutex.
+    std::size_t m_WorldCount;
+
+    WorldGrid(PathPlanner& planner)
+        : m_Planner(planner), m_WorldCount(0)
+    {
+
+    }
+
+    std::shared_ptr<const WalkabilityGrid::Section> GetSection(Vector3i key) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        auto iter = m_Sections.find(key);
+
+        if (iter == m_Sections.end()) return nullptr;
+
+        return iter->second;
+    }
+
+    // Returns true if the walkability of the column changed.
+    bool LoadColumn(const world::ChunkColumn& column, u16 changedMask);
+    void AcquireColumn(s32 chunkX, s32 chunkZ);
+    void ReleaseColumn(s32 chunkX, s32 chunkZ);
+    void SetCell(Vector3i position, u8 flags);
+    void NotifyChange(Vector3i position);
+    void NotifyColumnChange(s32 chunkX, s32 chunkZ);
+};
+
+// Forwards the changes of one registered world to its grid, and remembers which columns that world holds.
+class PathPlanner::WorldLink : public world::WorldListener {
+public:
+    std::shared_ptr<WorldGrid> m_Grid;
+    std::string m_Key;
+    std::set<std::pair<s32, s32>> m_Columns;
+
+    WorldLink(std::shared_ptr<WorldGrid> grid, const std::string& key)
+        : m_Grid(grid), m_Key(key)
+    {
+
+    }
+
+    void LoadColumn(const world::ChunkColumn& column, u16 changedMask);
+    // Releases every column of this world from the grid.
+    void ReleaseColumns();
+
+    void OnBlockChange(Vector3i position, block::BlockPtr newBlock, block::BlockPtr oldBlock) override;
+    void OnColumnLoad(const world::ChunkColumn& column, u16 changedMask) override;
+    void OnChunkUnload(world::ChunkColumnPtr chunk) override;
+};
+
+// The sections that one plan reads. They are fetched once per plan so the grid lock isn't taken per block.
+class PathPlanner::SectionView : public WalkabilityGrid {
+private:
+    WorldGrid* m_Grid;
+    std::unordered_map<Vector3i, std::shared_ptr<const Section>, Vector3Hash<s64>> m_Cache;
+    Vector3i m_LastKey;
+    const Section* m_LastSection;
+
+public:
+    SectionView(WorldGrid* grid) : m_Grid(grid), m_LastSection(nullptr) { }
+
+    u8 GetCell(Vector3i position) override {
+        if (position.y < 0) return 0;
+        if (position.y >= 256) return Passable;
+
+        Vector3i key = GetSectionKey(position);
+
+        if (!m_LastSection || key != m_LastKey) {
+            auto iter = m_Cache.find(key);
+
+            if (iter == m_Cache.end())
+                iter = m_Cache.emplace(key, m_Grid->GetSection(key)).first;
+
+            m_LastKey = key;
+            m_LastSection = iter->second.get();
+
+            // Unloaded sections are never walkable.
+            if (!m_LastSection) return 0;
+        }
+
+        return (*m_LastSection)[GetSectionIndex(position)];
+    }
+
+    // Drops the fetched sections so the next plan sees the latest blocks.
+    void Refresh() {
+        m_Cache.clear();
+        m_LastSection = nullptr;
+    }
+};
+
+// A search towards one goal in one grid. Shared by every bot that heads to that goal.
+struct PathPlanner::Search {
+    // Held by the worker while planning
+    std::mutex mutex;
+    SectionView view;
+    Pathfinder pathfinder;
+
+    // Changes that happened since the last plan, written on the threads of the worlds
+    std::mutex changeMutex;
+    std::vector<Vector3i> changedBlocks;
+    std::vector<std::pair<s32, s32>> changedColumns;
+
+    // Guarded by the planner's world mutex
+    u64 lastUse;
+
+    Search(WorldGrid* grid, const PathCosts& costs, Vector3i goal)
+        : view(grid), pathfinder(view, costs), lastUse(0)
+    {
+        pathfinder.SetGoal(goal);
+    }
+
+    void ApplyChanges() {
+        std::vector<Vector3i> blocks;
+        std::vector<std::pair<s32, s32>> columns;
+
+        {
+            std::lock_guard<std::mutex> lock(changeMutex);
+            blocks.swap(changedBlocks);
+            columns.swap(changedColumns);
+        }
+
+        for (Vector3i position : blocks)
+            pathfinder.OnGridChange(position);
+
+        for (const auto& column : columns)
+            pathfinder.OnGridColumnChange(column.first, column.second);
+    }
+};
+
+bool PathPlanner::WorldGrid::LoadColumn(const world::ChunkColumn& column, u16 changedMask) {
+    s32 chunkX = column.GetMetadata().x;
+    s32 chunkZ = column.GetMetadata().z;
+    bool changed = false;
+
+    for (s32 i = 0; i < 16; ++i) {
+        Vector3i key(chunkX, i, chunkZ);
+
+        if ((changedMask & (1 << i)) == 0) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+
+            // Partial updates keep the sections that weren't sent.
+            if (m_Sections.find(key) != m_Sections.end()) continue;
+        }
+
+        SectionPtr section = m_Planner.GetSection(column[i]);
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        SectionPtr& current = m_Sections[key];
+
+        // Another world in the same grid might have loaded the same column already.
+        if (!current || (current != section && *current != *section))
+            changed = true;
+
+        current = section;
+    }
+
+    return changed;
+}
+
+void PathPlanner::WorldGrid::AcquireColumn(s32 chunkX, s32 chunkZ) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    ++m_ColumnRefs[std::make_pair(chunkX, chunkZ)];
+}
+
+void PathPlanner::WorldGrid::ReleaseColumn(s32 chunkX, s32 chunkZ) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        auto iter = m_ColumnRefs.find(std::make_pair(chunkX, chunkZ));
+        if (iter == m_ColumnRefs.end()) return;
+
+        // Still loaded by another world
+        if (--iter->second > 0) return;
+
+        m_ColumnRefs.erase(iter);
+
+        for (s32 i = 0; i < 16; ++i)
+            m_Sections.erase(Vector3i(chunkX, i, chunkZ));
+    }
+
+    NotifyColumnChange(chunkX, chunkZ);
+}
+
+void PathPlanner::WorldGrid::SetCell(Vector3i position, u8 flags) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        auto iter = m_Sections.find(WalkabilityGrid::GetSectionKey(position));
+        if (iter == m_Sections.end()) return;
+
+        std::size_t index = WalkabilityGrid::GetSectionIndex(position);
+
+        // Every world in the grid reports the same change, only the first one does anything.
+        if ((*iter->second)[index] == flags) return;
+
+        // Workers and other grids might be reading the section, so write to a copy.
+        // Nothing else can take a reference while the lock is held.
+        if (iter->second.use_count() > 1)
+            iter->second = std::make_shared<WalkabilityGrid::Section>(*iter->second);
+
+        (*iter->second)[index] = flags;
+    }
+
+    NotifyChange(position);
+}
+
+void PathPlanner::WorldGrid::NotifyChange(Vector3i position) {
+    std::lock_guard<std::mutex> lock(m_SearchMutex);
+
+    for (auto& kv : m_Searches) {
+        std::lock_guard<std::mutex> changeLock(kv.second->changeMutex);
+        kv.second->changedBlocks.push_back(position);
+    }
+}
+
+void PathPlanner::WorldGrid::NotifyColumnChange(s32 chunkX, s32 chunkZ) {
+    std::lock_guard<std::mutex> lock(m_SearchMutex);
+
+    for (auto& kv : m_Searches) {
+        std::lock_guard<std::mutex> changeLock(kv.second->changeMutex);
+        kv.second->changedColumns.emplace_back(chunkX, chunkZ);
+    }
+}
+
+void PathPlanner::WorldLink::LoadColumn(const world::ChunkColumn& column, u16 changedMask) {
+    s32 chunkX = column.GetMetadata().x;
+    s32 chunkZ = column.GetMetadata().z;
+
+    if (m_Columns.insert(std::make_pair(chunkX, chunkZ)).second)
+        m_Grid->AcquireColumn(chunkX, chunkZ);
+
+    if (m_Grid->LoadColumn(column, changedMask))
+        m_Grid->NotifyColumnChange(chunkX, chunkZ);
+}
+
+void PathPlanner::WorldLink::ReleaseColumns() {
+    for (const auto& column : m_Columns)
+        m_Grid->ReleaseColumn(column.first, column.second);
+
+    m_Columns.clear();
+}
+
+void PathPlanner::WorldLink::OnBlockChange(Vector3i position, block::BlockPtr newBlock, block::BlockPtr /*oldBlock*/) {
+    if (position.y < 0 || position.y >= 256) return;
+
+    m_Grid->SetCell(position, WalkabilityGrid::GetFlags(newBlock));
+}
+
+void PathPlanner::WorldLink::OnColumnLoad(const world::ChunkColumn& column, u16 changedMask) {
+    LoadColumn(column, changedMask);
+}
+
+void PathPlanner::WorldLink::OnChunkUnload(world::ChunkColumnPtr chunk) {
+    s32 chunkX = chunk->GetMetadata().x;
+    s32 chunkZ = chunk->GetMetadata().z;
+
+    if (m_Columns.erase(std::make_pair(chunkX, chunkZ)) > 0)
+        m_Grid->ReleaseColumn(chunkX, chunkZ);
+}
+
+PathPlanner::PathPlanner(std::size_t workers, const PathCosts& costs)
+    : m_Costs(costs),
+      m_MaxSearches(64),
+      m_SearchCount(0),
+      m_SearchCounter(0),
+      m_InsertsSincePrune(0),
+      m_Stopping(false)
+{
+    if (workers == 0)
+        workers = std::max(1u, std::thread::hardware_concurrency());
+
+    for (std::size_t i = 0; i < workers; ++i)
+        m_Workers.emplace_back(&PathPlanner::WorkerThread, this);
+}
+
+PathPlanner::~PathPlanner() {
+    {
+        std::lock_guard<std::mutex> lock(m_TaskMutex);
+        m_Stopping = true;
+    }
+
+    m_TaskCondition.notify_all();
+
+    for (std::thread& worker : m_Workers)
+        worker.join();
+
+    // Nothing is going to plan these anymore, so their futures get an empty path instead of a broken promise.
+    for (Task& task : m_Tasks)
+        task(true);
+
+    m_Tasks.clear();
+
+    for (auto& kv : m_Worlds)
+        kv.first->UnregisterListener(kv.second.get());
+}
+
+void PathPlanner::WorkerThread() {
+    while (true) {
+        Task task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_TaskMutex);
+
+            m_TaskCondition.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+
+            if (m_Stopping) return;
+
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+
+        task(false);
+    }
+}
+
+PathPlanner::SectionPtr PathPlanner::GetSection(const world::ConstChunkPtr& chunk) {
+    static const SectionPtr AirSection = [] {
+        SectionPtr section = std::make_shared<WalkabilityGrid::Section>();
+        WalkabilityGrid::FillSection(nullptr, *section);
+        return section;
+    }();
+
+    if (!chunk) return AirSection;
+
+    // Only interned chunks are shared, the others can be changed in place by the world.
+    if (chunk->IsInterned()) {
+        std::lock_guard<std::mutex> lock(m_SectionMutex);
+
+        auto iter = m_SharedSections.find(chunk.get());
+
+        if (iter != m_SharedSections.end() && iter->second.first.lock() == chunk) {
+            std::lock_guard<std::mutex> statsLock(m_StatsMutex);
+            ++m_Stats.sharedSections;
+            return iter->second.second;
+        }
+    }
+
+    SectionPtr section = std::make_shared<WalkabilityGrid::Section>();
+    WalkabilityGrid::FillSection(chunk.get(), *section);
+
+    {
+        std::lock_guard<std::mutex> statsLock(m_StatsMutex);
+        ++m_Stats.builtSections;
+    }
+
+    if (chunk->IsInterned()) {
+        std::lock_guard<std::mutex> lock(m_SectionMutex);
+
+        m_SharedSections[chunk.get()] = std::make_pair(std::weak_ptr<const world::Chunk>(chunk), section);
+
+        if (++m_InsertsSincePrune >= 4096) {
+            for (auto iter = m_SharedSections.begin(); iter != m_SharedSections.end(); ) {
+                if (iter->second.first.expired())
+                    iter = m_SharedSections.erase(iter);
+                else
+                    ++iter;
+            }
+
+            m_InsertsSincePrune = 0;
+        }
+    }
+
+    return section;
+}
+
+std::shared_ptr<PathPlanner::WorldGrid> PathPlanner::AddWorld(world::World& world, const std::string& key) {
+    auto iter = m_Worlds.find(&world);
+
+    if (iter != m_Worlds.end()) {
+        if (iter->second->m_Key == key) return iter->second->m_Grid;
+
+        RemoveWorld(iter);
+    }
+
+    std::shared_ptr<WorldGrid> grid;
+
+    if (!key.empty())
+        grid = m_SharedGrids[key].lock();
+
+    if (!grid) {
+        grid = std::make_shared<WorldGrid>(*this);
+
+        if (!key.empty())
+            m_SharedGrids[key] = grid;
+    }
+
+    std::unique_ptr<WorldLink> link(new WorldLink(grid, key));
+
+    for (const auto& kv : world) {
+        // Restores evicted columns so they aren't planned as unloaded.
+        world::ChunkColumnPtr column = world.RestoreChunk(Vector3i(kv.first.first * 16, 0, kv.first.second * 16));
+
+        if (column)
+            link->LoadColumn(*column, 0xFFFF);
+    }
+
+    ++grid->m_WorldCount;
+    world.RegisterListener(link.get());
+    m_Worlds[&world] = std::move(link);
+
+    return grid;
+}
+
+void PathPlanner::RemoveWorld(std::unordered_map<world::World*, std::unique_ptr<WorldLink>>::iterator iter) {
+    WorldLink* link = iter->second.get();
+    std::shared_ptr<WorldGrid> grid = link->m_Grid;
+
+    iter->first->UnregisterListener(link);
+    link->ReleaseColumns();
+
+    if (--grid->m_WorldCount == 0) {
+        // Queued plans keep the grid and their search alive until they finish.
+        std::lock_guard<std::mutex> lock(grid->m_SearchMutex);
+
+        m_SearchCount -= grid->m_Searches.size();
+        grid->m_Searches.clear();
+
+        if (!link->m_Key.empty())
+            m_SharedGrids.erase(link->m_Key);
+    }
+
+    m_Worlds.erase(iter);
+}
+
+void PathPlanner::EvictOldestSearch() {
+    std::unordered_set<WorldGrid*> visited;
+    WorldGrid* oldestGrid = nullptr;
+    Vector3i oldestGoal;
+    u64 oldestUse = 0;
+
+    for (const auto& kv : m_Worlds) {
+        WorldGrid* grid = kv.second->m_Grid.get();
+
+        if (!visited.insert(grid).second) continue;
+
+        std::lock_guard<std::mutex> lock(grid->m_SearchMutex);
+
+        for (const auto& search : grid->m_Searches) {
+            if (!oldestGrid || search.second->lastUse < oldestUse) {
+                oldestGrid = grid;
+                oldestGoal = search.first;
+                oldestUse = search.second->lastUse;
+            }
+        }
+    }
+
+    if (!oldestGrid) {
+        m_SearchCount = 0;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(oldestGrid->m_SearchMutex);
+
+    oldestGrid->m_Searches.erase(oldestGoal);
+    --m_SearchCount;
+}
+
+void PathPlanner::RegisterWorld(world::World& world, const std::string& key) {
+    std::lock_guard<std::mutex> lock(m_WorldMutex);
+
+    AddWorld(world, key);
+}
+
+void PathPlanner::UnregisterWorld(world::World& world) {
+    std::lock_guard<std::mutex> lock(m_WorldMutex);
+
+    auto iter = m_Worlds.find(&world);
+    if (iter == m_Worlds.end()) return;
+
+    RemoveWorld(iter);
+}
+
+std::future<std::vector<Vector3i>> PathPlanner::Submit(world::World& world, Vector3i start, Vector3i goal) {
+    std::shared_ptr<WorldGrid> grid;
+    std::shared_ptr<Search> search;
+
+    {
+        std::lock_guard<std::mutex> lock(m_WorldMutex);
+
+        auto worldIter = m_Worlds.find(&world);
+
+        if (worldIter != m_Worlds.end())
+            grid = worldIter->second->m_Grid;
+        else
+            grid = AddWorld(world, "");
+
+        {
+            std::lock_guard<std::mutex> searchLock(grid->m_SearchMutex);
+
+            auto iter = grid->m_Searches.find(goal);
+
+            if (iter != grid->m_Searches.end())
+                search = iter->second;
+        }
+
+        if (search) {
+            std::lock_guard<std::mutex> statsLock(m_StatsMutex);
+            ++m_Stats.reusedSearches;
+        } else {
+            while (m_SearchCount > 0 && m_SearchCount >= m_MaxSearches)
+                EvictOldestSearch();
+
+            search = std::make_shared<Search>(grid.get(), m_Costs, goal);
+
+            {
+                std::lock_guard<std::mutex> searchLock(grid->m_SearchMutex);
+                grid->m_Searches[goal] = search;
+            }
+
+            ++m_SearchCount;
+
+            std::lock_guard<std::mutex> statsLock(m_StatsMutex);
+            ++m_Stats.newSearches;
+        }
+
+        search->lastUse = ++m_SearchCounter;
+    }
+
+    auto promise = std::make_shared<std::promise<std::vector<Vector3i>>>();
+    std::future<std::vector<Vector3i>> result = promise->get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(m_TaskMutex);
+
+        m_Tasks.emplace_back([grid, search, start, promise](bool cancelled) {
+            std::vector<Vector3i> path;
+
+            if (!cancelled) {
+                std::lock_guard<std::mutex> lock(search->mutex);
+
+                search->ApplyChanges();
+                search->view.Refresh();
+                search->pathfinder.SetStart(start);
+
+                if (search->pathfinder.Plan())
+                    path = search->pathfinder.GetPath();
+            }
+
+            promise->set_value(std::move(path));
+        });
+    }
+
+    m_TaskCondition.notify_one();
+
+    return result;
+}
+
+PathPlannerStats PathPlanner::GetStats() {
+    std::lock_guard<std::mutex> lock(m_StatsMutex);
+    return m_Stats;
+}
+
+} // ns util
+} // ns mc
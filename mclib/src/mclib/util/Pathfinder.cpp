@@ -0,0 +1,577 @@
+#include <mclib/util/Pathfinder.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+namespace mc {
+namespace util {
+
+namespace {
+
+const double Infinity = std::numeric_limits<double>::infinity();
+
+const Vector3i Directions[] = {
+    Vector3i(1, 0, 0), Vector3i(-1, 0, 0), Vector3i(0, 0, 1), Vector3i(0, 0, -1),
+    Vector3i(1, 0, 1), Vector3i(1, 0, -1), Vector3i(-1, 0, 1), Vector3i(-1, 0, -1)
+};
+
+bool IsLiquid(block::BlockPtr block) {
+    static const util::InternedString liquids[] = {
+        util::InternedString("minecraft:water"),
+        util::InternedString("minecraft:flowing_water"),
+        util::InternedString("minecraft:lava"),
+        util::InternedString("minecraft:flowing_lava")
+    };
+
+    return std::find(std::begin(liquids), std::end(liquids), block->GetInternedName()) != std::end(liquids);
+}
+
+} // ns
+
+u8 WalkabilityGrid::GetFlags(block::BlockPtr block) {
+    if (!block) return Passable;
+
+    // Liquids can't be stood on, and paths shouldn't go through them whether they are solid in the registry or not.
+    if (IsLiquid(block)) return 0;
+
+    if (!block->IsSolid()) return Passable;
+
+    AABB bounds = block->GetBoundingBox();
+
+    // Blocks taller than a full block, like fences, can't be jumped on.
+    if (bounds.max.y <= 1.0)
+        return Supporting;
+
+    return 0;
+}
+
+void WalkabilityGrid::FillSection(const world::Chunk* chunk, Section& section) {
+    if (!chunk) {
+        section.fill(Passable);
+        return;
+    }
+
+    for (s64 y = 0; y < 16; ++y) {
+        for (s64 z = 0; z < 16; ++z) {
+            for (s64 x = 0; x < 16; ++x)
+                section[(y * 16 + z) * 16 + x] = GetFlags(chunk->GetBlock(Vector3i(x, y, z)));
+        }
+    }
+}
+
+PathGrid::PathGrid(world::World& world)
+    : m_World(world)
+{
+    m_World.RegisterListener(this);
+}
+
+PathGrid::~PathGrid() {
+    m_World.UnregisterListener(this);
+}
+
+u8 PathGrid::GetCell(Vector3i position) {
+    if (position.y < 0) return 0;
+    if (position.y >= 256) return Passable;
+
+    Vector3i key = GetSectionKey(position);
+    auto iter = m_Sections.find(key);
+
+    if (iter == m_Sections.end()) {
+        world::ChunkColumnPtr column = m_World.GetChunk(position);
+
+        // Restoring a column that was compressed by eviction would undo the eviction.
+        // It isn't walkable until something else restores it, and it isn't cached so it's read again then.
+        if (column && column->IsCompressed()) return 0;
+
+        std::unique_ptr<Section> section(new Section());
+
+        if (column)
+            FillSection((*column)[(std::size_t)key.y].get(), *section);
+        else
+            section->fill(0);
+
+        iter = m_Sections.emplace(key, std::move(section)).first;
+    }
+
+    return (*iter->second)[GetSectionIndex(position)];
+}
+
+void PathGrid::Clear() {
+    m_Sections.clear();
+}
+
+void PathGrid::EraseColumn(s32 chunkX, s32 chunkZ) {
+    for (s64 y = 0; y < 16; ++y)
+        m_Sections.erase(Vector3i(chunkX, y, chunkZ));
+
+    NotifyListeners(&PathGridListener::OnGridColumnChange, chunkX, chunkZ);
+}
+
+void PathGrid::OnBlockChange(Vector3i position, block::BlockPtr newBlock, block::BlockPtr /*oldBlock*/) {
+    if (position.y < 0 || position.y >= 256) return;
+
+    auto iter = m_Sections.find(GetSectionKey(position));
+
+    // Not cached yet, it will be read from the world when it's needed.
+    if (iter == m_Sections.end()) return;
+
+    u8& cell = (*iter->second)[GetSectionIndex(position)];
+    u8 flags = GetFlags(newBlock);
+
+    // Changing stone to dirt doesn't change any paths.
+    if (cell == flags) return;
+
+    cell = flags;
+    NotifyListeners(&PathGridListener::OnGridChange, position);
+}
+
+void PathGrid::OnColumnLoad(const world::ChunkColumn& column, u16 /*changedMask*/) {
+    EraseColumn(column.GetMetadata().x, column.GetMetadata().z);
+}
+
+void PathGrid::OnChunkUnload(world::ChunkColumnPtr chunk) {
+    EraseColumn(chunk->GetMetadata().x, chunk->GetMetadata().z);
+}
+
+void PathGrid::OnChunkEvict(world::ChunkColumnPtr chunk, bool compressed) {
+    // Compressed columns keep their blocks, so their cached sections are still correct.
+    if (!compressed)
+        EraseColumn(chunk->GetMetadata().x, chunk->GetMetadata().z);
+}
+
+Pathfinder::Node::Node()
+    : g(Infinity), rhs(Infinity), key(Infinity, Infinity), queued(false)
+{
+
+}
+
+Pathfinder::Pathfinder(WalkabilityGrid& grid, const PathCosts& costs)
+    : m_Grid(grid),
+      m_Costs(costs),
+      m_KeyModifier(0.0),
+      m_HasGoal(false),
+      m_NeedsReset(false),
+      m_MaxExpansions(20000)
+{
+    m_Grid.RegisterListener(this);
+}
+
+Pathfinder::~Pathfinder() {
+    m_Grid.UnregisterListener(this);
+}
+
+Pathfinder::Node& Pathfinder::GetNode(Vector3i position) {
+    auto iter = m_Nodes.find(position);
+
+    if (iter == m_Nodes.end())
+        iter = AddNode(position);
+
+    return iter->second;
+}
+
+Pathfinder::NodeMap::iterator Pathfinder::AddNode(Vector3i position) {
+    m_ColumnNodes[Vector3i(position.x >> 4, 0, position.z >> 4)].push_back(position);
+
+    return m_Nodes.emplace(position, Node()).first;
+}
+
+void Pathfinder::ClearNodes() {
+    m_Nodes.clear();
+    m_ColumnNodes.clear();
+    m_Queue.clear();
+}
+
+double Pathfinder::GetG(Vector3i position) const {
+    auto iter = m_Nodes.find(position);
+
+    if (iter == m_Nodes.end()) return Infinity;
+
+    return iter->second.g;
+}
+
+double Pathfinder::Heuristic(Vector3i from, Vector3i to) const {
+    double dx = (double)std::abs(to.x - from.x);
+    double dz = (double)std::abs(to.z - from.z);
+    double dy = (double)(to.y - from.y);
+
+    double horizontal;
+
+    if (m_Costs.allowDiagonal) {
+        double diagonal = std::min(m_Costs.diagonal, m_Costs.walk * 2.0);
+        double straight = std::max(dx, dz) - std::min(dx, dz);
+
+        horizontal = std::min(dx, dz) * diagonal + straight * m_Costs.walk;
+    } else {
+        horizontal = (dx + dz) * m_Costs.walk;
+    }
+
+    // Every move climbs at most one block and every block dropped costs the same.
+    double vertical = dy > 0 ? dy * m_Costs.jump : -dy * m_Costs.drop;
+
+    return horizontal + vertical;
+}
+
+Pathfinder::Key Pathfinder::CalculateKey(Vector3i position, const Node& node) const {
+    double value = std::min(node.g, node.rhs);
+
+    return Key(value + Heuristic(m_Start, position) + m_KeyModifier, value);
+}
+
+double Pathfinder::GetCost(Vector3i from, Vector3i to) {
+    s64 dx = to.x - from.x;
+    s64 dy = to.y - from.y;
+    s64 dz = to.z - from.z;
+
+    if (std::abs(dx) > 1 || std::abs(dz) > 1 || (dx == 0 && dz == 0))
+        return Infinity;
+
+    bool diagonal = dx != 0 && dz != 0;
+
+    if (diagonal && (!m_Costs.allowDiagonal || dy != 0))
+        return Infinity;
+
+    if (dy > 1 || dy < -m_Costs.maxDrop)
+        return Infinity;
+
+    if (!m_Grid.IsStandable(from) || !m_Grid.IsStandable(to))
+        return Infinity;
+
+    const Vector3i up(0, 1, 0);
+
+    if (diagonal) {
+        // Don't cut corners, the player is wider than the gap between two diagonal blocks.
+        Vector3i cornerX(from.x + dx, from.y, from.z);
+        Vector3i cornerZ(from.x, from.y, from.z + dz);
+
+        if (!m_Grid.IsPassable(cornerX) || !m_Grid.IsPassable(cornerX + up) ||
+            !m_Grid.IsPassable(cornerZ) || !m_Grid.IsPassable(cornerZ + up))
+        {
+            return Infinity;
+        }
+
+        return m_Costs.diagonal;
+    }
+
+    if (dy == 0)
+        return m_Costs.walk;
+
+    if (dy == 1) {
+        if (!m_Grid.IsPassable(from + up * 2))
+            return Infinity;
+
+        return m_Costs.walk + m_Costs.jump;
+    }
+
+    // The player walks off the edge, so the space above the landing must be open up to head height.
+    for (s64 y = to.y + 2; y <= from.y + 1; ++y) {
+        if (!m_Grid.IsPassable(Vector3i(to.x, y, to.z)))
+            return Infinity;
+    }
+
+    return m_Costs.walk + m_Costs.drop * -dy;
+}
+
+void Pathfinder::GetSuccessors(Vector3i position, std::vector<std::pair<Vector3i, double>>& out) {
+    out.clear();
+
+    if (!m_Grid.IsStandable(position)) return;
+
+    std::size_t count = m_Costs.allowDiagonal ? 8 : 4;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        Vector3i next = position + Directions[i];
+
+        for (s64 dy = 1; dy >= -m_Costs.maxDrop; --dy) {
+            Vector3i candidate(next.x, next.y + dy, next.z);
+            double cost = GetCost(position, candidate);
+
+            if (cost != Infinity) {
+                out.emplace_back(candidate, cost);
+                // Only one of these can be valid, it's either a step up or the first block that is landed on.
+                break;
+            }
+        }
+    }
+}
+
+void Pathfinder::GetPredecessors(Vector3i position, std::vector<std::pair<Vector3i, double>>& out) {
+    out.clear();
+
+    if (!m_Grid.IsStandable(position)) return;
+
+    std::size_t count = m_Costs.allowDiagonal ? 8 : 4;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        Vector3i previous = position - Directions[i];
+
+        for (s64 dy = -1; dy <= m_Costs.maxDrop; ++dy) {
+            Vector3i candidate(previous.x, previous.y + dy, previous.z);
+            double cost = GetCost(candidate, position);
+
+            if (cost != Infinity)
+                out.emplace_back(candidate, cost);
+        }
+    }
+}
+
+void Pathfinder::UpdateVertex(Vector3i position) {
+    double rhs = 0.0;
+
+    if (position != m_Goal) {
+        rhs = Infinity;
+
+        GetSuccessors(position, m_Successors);
+
+        for (const auto& successor : m_Successors)
+            rhs = std::min(rhs, successor.second + GetG(successor.first));
+    }
+
+    auto iter = m_Nodes.find(position);
+
+    if (iter == m_Nodes.end()) {
+        // Nodes that have never been reached don't need to be stored.
+        if (rhs == Infinity) return;
+
+        iter = AddNode(position);
+    }
+
+    Node& node = iter->second;
+    node.rhs = rhs;
+
+    if (node.queued) {
+        m_Queue.erase(std::make_pair(node.key, position));
+        node.queued = false;
+    }
+
+    if (node.g != node.rhs) {
+        node.key = CalculateKey(position, node);
+        node.queued = true;
+        m_Queue.emplace(node.key, position);
+    }
+}
+
+bool Pathfinder::ComputeShortestPath() {
+    std::size_t expansions = 0;
+
+    while (!m_Queue.empty()) {
+        Node& start = GetNode(m_Start);
+        Key startKey = CalculateKey(m_Start, start);
+
+        if (!(m_Queue.begin()->first < startKey) && start.rhs == start.g)
+            break;
+
+        if (++expansions > m_MaxExpansions)
+            return false;
+
+        Key oldKey = m_Queue.begin()->first;
+        Vector3i position = m_Queue.begin()->second;
+        Node& node = GetNode(position);
+        Key newKey = CalculateKey(position, node);
+
+        m_Queue.erase(m_Queue.begin());
+        node.queued = false;
+
+        if (oldKey < newKey) {
+            // The key is out of date because the start moved since it was queued.
+            node.key = newKey;
+            node.queued = true;
+            m_Queue.emplace(newKey, position);
+        } else if (node.g > node.rhs) {
+            node.g = node.rhs;
+
+            GetPredecessors(position, m_Predecessors);
+            for (const auto& predecessor : m_Predecessors)
+                UpdateVertex(predecessor.first);
+        } else {
+            node.g = Infinity;
+            UpdateVertex(position);
+
+            GetPredecessors(position, m_Predecessors);
+            for (const auto& predecessor : m_Predecessors)
+                UpdateVertex(predecessor.first);
+        }
+    }
+
+    return GetG(m_Start) != Infinity;
+}
+
+void Pathfinder::Reset() {
+    ClearNodes();
+    m_ChangedBlocks.clear();
+    m_ChangedColumns.clear();
+    m_KeyModifier = 0.0;
+    m_LastStart = m_Start;
+    m_NeedsReset = false;
+
+    Node& goal = GetNode(m_Goal);
+    goal.rhs = 0.0;
+    goal.key = CalculateKey(m_Goal, goal);
+    goal.queued = true;
+    m_Queue.emplace(goal.key, m_Goal);
+}
+
+void Pathfinder::ApplyChanges() {
+    // Every move that passes through a changed block starts from a node in this area.
+    for (Vector3i changed : m_ChangedBlocks) {
+        for (s64 y = changed.y - 2; y <= changed.y + m_Costs.maxDrop + 1; ++y) {
+            for (s64 z = changed.z - 1; z <= changed.z + 1; ++z) {
+                for (s64 x = changed.x - 1; x <= changed.x + 1; ++x)
+                    UpdateVertex(Vector3i(x, y, z));
+            }
+        }
+    }
+
+    for (const auto& column : m_ChangedColumns) {
+        s64 minX = (s64)column.first * 16 - 1;
+        s64 minZ = (s64)column.second * 16 - 1;
+        s64 maxX = minX + 17;
+        s64 maxZ = minZ + 17;
+
+        std::vector<Vector3i> affected;
+
+        // The area reaches one block into the neighboring columns.
+        for (s64 chunkZ = column.second - 1; chunkZ <= column.second + 1; ++chunkZ) {
+            for (s64 chunkX = column.first - 1; chunkX <= column.first + 1; ++chunkX) {
+                auto iter = m_ColumnNodes.find(Vector3i(chunkX, 0, chunkZ));
+
+                if (iter == m_ColumnNodes.end()) continue;
+
+                for (Vector3i position : iter->second) {
+                    if (position.x >= minX && position.x <= maxX && position.z >= minZ && position.z <= maxZ)
+                        affected.push_back(position);
+                }
+            }
+        }
+
+        for (Vector3i position : affected) {
+            UpdateVertex(position);
+
+            // Nodes inside of a newly loaded column can reach the nodes that are already known.
+            if (GetG(position) == Infinity) continue;
+
+            GetPredecessors(position, m_Predecessors);
+            for (const auto& predecessor : m_Predecessors)
+                UpdateVertex(predecessor.first);
+        }
+    }
+
+    m_ChangedBlocks.clear();
+    m_ChangedColumns.clear();
+}
+
+void Pathfinder::SetGoal(Vector3i goal) {
+    if (m_HasGoal && goal == m_Goal) return;
+
+    m_Goal = goal;
+    m_HasGoal = true;
+    m_NeedsReset = true;
+}
+
+void Pathfinder::SetStart(Vector3i start) {
+    m_Start = start;
+}
+
+void Pathfinder::ClearGoal() {
+    m_HasGoal = false;
+    ClearNodes();
+    m_ChangedBlocks.clear();
+    m_ChangedColumns.clear();
+}
+
+bool Pathfinder::Plan() {
+    if (!m_HasGoal) return false;
+
+    if (m_NeedsReset) {
+        Reset();
+    } else {
+        if (m_Start != m_LastStart) {
+            m_KeyModifier += Heuristic(m_LastStart, m_Start);
+            m_LastStart = m_Start;
+        }
+
+        ApplyChanges();
+    }
+
+    if (!m_Grid.IsStandable(m_Start)) return false;
+
+    return ComputeShortestPath();
+}
+
+Vector3i Pathfinder::GetNextStep() {
+    if (!m_HasGoal || m_Start == m_Goal || GetG(m_Start) == Infinity)
+        return m_Start;
+
+    Vector3i best = m_Start;
+    double bestCost = Infinity;
+
+    GetSuccessors(m_Start, m_Successors);
+
+    for (const auto& successor : m_Successors) {
+        double cost = successor.second + GetG(successor.first);
+
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = successor.first;
+        }
+    }
+
+    return best;
+}
+
+std::vector<Vector3i> Pathfinder::GetPath(std::size_t maxLength) {
+    std::vector<Vector3i> path;
+
+    if (!m_HasGoal || GetG(m_Start) == Infinity)
+        return path;
+
+    Vector3i current = m_Start;
+
+    while (current != m_Goal && path.size() < maxLength) {
+        Vector3i best = current;
+        double bestCost = Infinity;
+
+        GetSuccessors(current, m_Successors);
+
+        for (const auto& successor : m_Successors) {
+            double cost = successor.second + GetG(successor.first);
+
+            if (cost < bestCost) {
+                bestCost = cost;
+                best = successor.first;
+            }
+        }
+
+        if (bestCost == Infinity) {
+            path.clear();
+            break;
+        }
+
+        path.push_back(best);
+        current = best;
+    }
+
+    return path;
+}
+
+void Pathfinder::OnGridChange(Vector3i position) {
+    if (!m_HasGoal || m_NeedsReset) return;
+
+    // A lot of changes at once is cheaper to plan from scratch.
+    if (m_ChangedBlocks.size() >= 256) {
+        m_NeedsReset = true;
+        return;
+    }
+
+    m_ChangedBlocks.push_back(position);
+}
+
+void Pathfinder::OnGridColumnChange(s32 chunkX, s32 chunkZ) {
+    if (!m_HasGoal || m_NeedsReset) return;
+
+    m_ChangedColumns.emplace_back(chunkX, chunkZ);
+}
+
+} // ns util
+} // ns mc
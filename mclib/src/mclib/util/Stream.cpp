@@ -0,0 +1,246 @@
+#include <mclib/util/Stream.h>
+
+#include <stdexcept>
+#include <zlib.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mc {
+namespace util {
+
+FileInputStream::FileInputStream(const std::string& path)
+    : m_File(fopen(path.c_str(), "rb"))
+{
+    if (m_File == nullptr)
+        throw std::runtime_error("Failed to open " + path);
+}
+
+FileInputStream::~FileInputStream() {
+    fclose(m_File);
+}
+
+std::size_t FileInputStream::Read(void* data, std::size_t size) {
+    std::size_t count = fread(data, 1, size, m_File);
+
+    if (count < size && ferror(m_File))
+        throw std::runtime_error("Failed to read from file");
+
+    return count;
+}
+
+FileOutputStream::FileOutputStream(const std::string& path)
+    : m_File(fopen(path.c_str(), "wb"))
+{
+    if (m_File == nullptr)
+        throw std::runtime_error("Failed to open " + path);
+}
+
+FileOutputStream::~FileOutputStream() {
+    fclose(m_File);
+}
+
+void FileOutputStream::Write(const void* data, std::size_t size) {
+    if (fwrite(data, 1, size, m_File) != size)
+        throw std::runtime_error("Failed to write to file");
+}
+
+void FileOutputStream::Flush() {
+    if (fflush(m_File) != 0)
+        throw std::runtime_error("Failed to write to file");
+}
+
+Compression DetectCompression(const u8* data, std::size_t size) {
+    if (size >= 2 && data[0] == 0x1F && data[1] == 0x8B)
+        return Compression::Gzip;
+
+    // The compression method is deflate and the header checksum is valid.
+    if (size >= 2 && (data[0] & 0x0F) == 8 && ((data[0] << 8) | data[1]) % 31 == 0)
+        return Compression::Zlib;
+
+    return Compression::None;
+}
+
+InflateStream::InflateStream(InputStream& in, std::size_t bufferSize)
+    : m_In(in), m_Stream(new z_stream_s()), m_Input(bufferSize), m_Finished(false)
+{
+    // Detect zlib or gzip from the header.
+    if (inflateInit2(m_Stream.get(), 15 + 32) != Z_OK)
+        throw std::runtime_error("Failed to initialize inflate");
+}
+
+InflateStream::~InflateStream() {
+    inflateEnd(m_Stream.get());
+}
+
+std::size_t InflateStream::Read(void* data, std::size_t size) {
+    if (m_Finished || size == 0) return 0;
+
+    m_Stream->next_out = (Bytef*)data;
+    m_Stream->avail_out = (uInt)size;
+
+    while (m_Stream->avail_out == size) {
+        if (m_Stream->avail_in == 0) {
+            std::size_t count = m_In.Read(m_Input.data(), m_Input.size());
+
+            if (count == 0)
+                throw std::runtime_error("Compressed data ends early");
+
+            m_Stream->next_in = m_Input.data();
+            m_Stream->avail_in = (uInt)count;
+        }
+
+        int result = inflate(m_Stream.get(), Z_NO_FLUSH);
+
+        if (result == Z_STREAM_END) {
+            m_Finished = true;
+            break;
+        }
+
+        if (result != Z_OK && result != Z_BUF_ERROR)
+            throw std::runtime_error("Failed to inflate data");
+    }
+
+    return size - m_Stream->avail_out;
+}
+
+DeflateStream::DeflateStream(OutputStream& out, Compression compression, int level, std::size_t bufferSize)
+    : m_Out(out), m_Stream(new z_stream_s()), m_Output(bufferSize), m_Finished(false)
+{
+    int windowBits = compression == Compression::Gzip ? 15 + 16 : 15;
+
+    if (compression == Compression::None)
+        throw std::invalid_argument("DeflateStream needs a compression format");
+
+    if (deflateInit2(m_Stream.get(), level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        throw std::runtime_error("Failed to initialize deflate");
+}
+
+DeflateStream::~DeflateStream() {
+    deflateEnd(m_Stream.get());
+}
+
+void DeflateStream::Deflate(int flush) {
+    do {
+        m_Stream->next_out = m_Output.data();
+        m_Stream->avail_out = (uInt)m_Output.size();
+
+        int result = deflate(m_Stream.get(), flush);
+
+        if (result == Z_STREAM_ERROR)
+            throw std::runtime_error("Failed to deflate data");
+
+        std::size_t count = m_Output.size() - m_Stream->avail_out;
+        if (count > 0)
+            m_Out.Write(m_Output.data(), count);
+    } while (m_Stream->avail_out == 0);
+}
+
+void DeflateStream::Write(const void* data, std::size_t size) {
+    if (m_Finished)
+        throw std::runtime_error("Write to a finished DeflateStream");
+
+    m_Stream->next_in = (Bytef*)data;
+    m_Stream->avail_in = (uInt)size;
+
+    Deflate(Z_NO_FLUSH);
+}
+
+void DeflateStream::Flush() {
+    if (m_Finished) return;
+
+    m_Stream->avail_in = 0;
+    Deflate(Z_SYNC_FLUSH);
+    m_Out.Flush();
+}
+
+void DeflateStream::Finish() {
+    if (m_Finished) return;
+
+    m_Stream->avail_in = 0;
+    Deflate(Z_FINISH);
+    m_Out.Flush();
+
+    m_Finished = true;
+}
+
+MappedFile::MappedFile()
+    : m_Data(nullptr), m_Size(0)
+{
+
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return false;
+
+    // The view keeps the mapping open.
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == NULL) return false;
+
+    m_Data = (const u8*)view;
+    m_Size = (std::size_t)size.QuadPart;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after the file is closed.
+    void* view = mmap(nullptr, (std::size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return false;
+
+    // The file is parsed from start to end.
+    madvise(view, (std::size_t)info.st_size, MADV_SEQUENTIAL);
+
+    m_Data = (const u8*)view;
+    m_Size = (std::size_t)info.st_size;
+#endif
+
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_Data == nullptr) return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(m_Data);
+#else
+    munmap((void*)m_Data, m_Size);
+#endif
+
+    m_Data = nullptr;
+    m_Size = 0;
+}
+
+} // ns util
+} // ns mc
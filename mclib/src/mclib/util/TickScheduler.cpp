@@ -0,0 +1,67 @@
+#include <mclib/util/TickScheduler.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace mc {
+namespace util {
+
+TickScheduler::TickScheduler(s64 interval, TickPolicy policy)
+    : m_Interval(std::max<s64>(interval, 1)),
+      m_Phase(0),
+      m_Policy(policy),
+      m_MaxCatchUp(5),
+      m_NextTick(0),
+      m_Started(false),
+      m_Ticks(0),
+      m_SkippedTicks(0)
+{
+
+}
+
+s64 TickScheduler::GetTime() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TickScheduler::SetPhase(s64 phase) {
+    m_Phase = ((phase % m_Interval) + m_Interval) % m_Interval;
+    m_Started = false;
+}
+
+void TickScheduler::SetPolicy(TickPolicy policy, u32 maxCatchUp) {
+    m_Policy = policy;
+    m_MaxCatchUp = std::max<u32>(maxCatchUp, 1);
+}
+
+u32 TickScheduler::Poll(s64 now) {
+    if (!m_Started) {
+        // Align to the first boundary at or after now.
+        s64 offset = ((m_Phase - now) % m_Interval + m_Interval) % m_Interval;
+
+        m_NextTick = now + offset;
+        m_Started = true;
+    }
+
+    if (now < m_NextTick) return 0;
+
+    s64 due = (now - m_NextTick) / m_Interval + 1;
+    u32 ticks = 1;
+
+    if (m_Policy == TickPolicy::CatchUp)
+        ticks = (u32)std::min<s64>(due, m_MaxCatchUp);
+
+    m_NextTick += due * m_Interval;
+    m_Ticks += ticks;
+    m_SkippedTicks += due - ticks;
+
+    return ticks;
+}
+
+s64 TickScheduler::GetTimeUntilNextTick(s64 now) const {
+    if (!m_Started) return 0;
+
+    return std::max<s64>(m_NextTick - now, 0);
+}
+
+} // ns util
+} // ns mc
@@ -7,6 +7,7 @@
 #include <mclib/core/PlayerManager.h>
 #include <mclib/entity/EntityManager.h>
 #include <mclib/protocol/Protocol.h>
+#include <mclib/util/Chat.h>
 #include <mclib/world/World.h>
 
 #include <iostream>
@@ -297,12 +298,19 @@ PlayerController::PlayerController(core::Connection* connection, world::World& w
       m_Position(0, 0, 0),
       m_BoundingBox(Vector3d(-0.3, 0, -0.3), Vector3d(0.3, 1.8, 0.3)),
       m_EntityId(-1),
-      m_LastUpdate(GetTime()),
       m_Sprinting(false),
       m_LoadedIn(false),
+      m_HandleFall(true),
       m_MoveSpeed(4.3),
-      m_HandleFall(true)
+      m_StepHeight(1.0),
+      m_OnGround(false),
+      m_TickTime(1000 / 20),
+      m_BlockCache(world, 1),
+      m_HasPathGoal(false),
+      m_PathPlanner(nullptr)
 {
+    UpdateBlockCacheRadius();
+
     m_PlayerManager.RegisterListener(this);
 
     //console.SetImpl(new LoggerConsole("PlayerController.log"));
@@ -310,6 +318,9 @@ PlayerController::PlayerController(core::Connection* connection, world::World& w
 }
 
 PlayerController::~PlayerController() {
+    if (m_PathPlanner)
+        m_PathPlanner->UnregisterWorld(m_World);
+
     m_PlayerManager.UnregisterListener(this);
 }
 
@@ -374,7 +385,42 @@ bool PlayerController::ClearPath(Vector3d target) {
     return true;
 }
 
-void PlayerController::SetMoveSpeed(double speed) { m_MoveSpeed = speed; }
+bool PlayerController::HasLineOfSight(Vector3d target) const {
+    Vector3d eyes = m_Position + Vector3d(0, EyeHeight, 0);
+    Vector3d toTarget = target - eyes;
+
+    world::RaycastResult result = m_World.Raycast(eyes, toTarget, toTarget.Length(), [](block::BlockPtr block, Vector3i /*pos*/) {
+        return block->IsSolid();
+    });
+
+    return !result.hit;
+}
+
+world::RaycastResult PlayerController::GetTargetBlock(double maxDistance) const {
+    return m_World.Raycast(m_Position + Vector3d(0, EyeHeight, 0), GetHeading(), maxDistance);
+}
+
+void PlayerController::SetMoveSpeed(double speed) { m_MoveSpeed = speed; UpdateBlockCacheRadius(); }
+void PlayerController::SetStepHeight(double height) { m_StepHeight = height; UpdateBlockCacheRadius(); }
+void PlayerController::SetTickTime(s64 time) { m_TickTime = time; UpdateBlockCacheRadius(); }
+
+void PlayerController::UpdateBlockCacheRadius() {
+    // The furthest a move in one update can go, walking or falling.
+    double motion = std::max(m_MoveSpeed, FallSpeed) * m_TickTime / 1000.0;
+    double reach = 0.0;
+
+    // The broadphase of ResolveCollisions covers the bounding box, the move and the step height above it.
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        double step = axis == 1 ? std::max(m_StepHeight, 0.0) : 0.0;
+
+        reach = std::max(reach, -m_BoundingBox.min[axis] + motion);
+        reach = std::max(reach, m_BoundingBox.max[axis] + motion + step);
+    }
+
+    // One more block covers the partial block that the player stands in and the block below the area that
+    // GatherColliders checks for tall blocks.
+    m_BlockCache.SetRadius((s32)std::ceil(reach) + 1);
+}
 
 void PlayerController::OnClientSpawn(core::PlayerPtr player) {
     m_Yaw = player->GetEntity()->GetYaw();
@@ -395,6 +441,14 @@ void PlayerController::Dig(Vector3d target) {
 
     if (toTarget.Length() > 6) return;
 
+    // The target block has to be the first block that the ray hits
+    Vector3d eyes = m_Position + Vector3d(0, EyeHeight, 0);
+    Vector3i targetBlock = ToVector3i(target);
+    Vector3d targetCenter = ToVector3d(targetBlock) + Vector3d(0.5, 0.5, 0.5);
+    world::RaycastResult result = m_World.Raycast(eyes, targetCenter - eyes, 6.0);
+
+    if (result.hit && result.position != targetBlock) return;
+
     m_DigQueue.push(target);
 }
 
@@ -420,37 +474,16 @@ void PlayerController::UpdateDigging() {
 
 }
 
-std::vector<std::pair<block::BlockPtr, Vector3i>> PlayerController::GetNearbyBlocks(const s32 radius) {
-    using BlockPos = std::pair<block::BlockPtr, Vector3i>;
-
-    std::vector<BlockPos> nearbyBlocks;
-
-    for (s32 x = -radius; x < radius; ++x) {
-        for (s32 y = -radius; y < radius; ++y) {
-            for (s32 z = -radius; z < radius; ++z) {
-                Vector3d checkPos = m_Position + Vector3d(x, y, z);
-
-                auto state = m_World.GetBlock(checkPos);
-
-                if (state && state->IsSolid())
-                    nearbyBlocks.push_back(std::make_pair<>(state, mc::ToVector3i(checkPos)));
-            }
-        }
-    }
-
-    std::sort(nearbyBlocks.begin(), nearbyBlocks.end(), [](const BlockPos& a, const BlockPos& b) {
-        return a.second < b.second;
-    });
-
-    nearbyBlocks.erase(std::unique(nearbyBlocks.begin(), nearbyBlocks.end()), nearbyBlocks.end());
+const std::vector<std::pair<block::BlockPtr, Vector3i>>& PlayerController::GetNearbyBlocks() {
+    m_BlockCache.SetCenter(m_Position);
 
-    return nearbyBlocks;
+    return m_BlockCache.GetSolidBlocks();
 }
 
 bool PlayerController::HandleJump() {
     AABB playerBounds = m_BoundingBox + m_Position;
 
-    for (const auto& state : GetNearbyBlocks(2)) {
+    for (const auto& state : GetNearbyBlocks()) {
         auto checkBlock = state.first;
         auto pos = state.second;
 
@@ -465,34 +498,120 @@ bool PlayerController::HandleJump() {
 }
 
 bool PlayerController::HandleFall() {
-    double bestDist = FallSpeed;
-    block::BlockPtr bestBlock = nullptr;
-
     if (!InLoadedChunk())
         return false;
 
-    AABB playerBounds = m_BoundingBox + (m_Position - Vector3d(0, FallSpeed, 0));
+    double fallDistance = FallSpeed * m_TickTime / 1000.0;
 
-    for (const auto& state : GetNearbyBlocks(2)) {
-        auto checkBlock = state.first;
+    Vector3d moved = ResolveCollisions(Vector3d(0.0, -fallDistance, 0.0));
+
+    m_Position += moved;
 
-        auto boundingBoxes = checkBlock->GetBoundingBoxes();
-        for (auto blockBounds : boundingBoxes) {
-            AABB checkBounds = blockBounds + state.second;
+    return moved.y <= -fallDistance;
+}
 
-            if (checkBounds.Intersects(playerBounds)) {
-                double penetration = checkBounds.max.y - playerBounds.min.y;
-                double dist = FallSpeed - penetration;
+// The offset along an axis that box can move before hitting other. Only boxes that overlap on the other two axes block.
+static double ClipAxisOffset(const AABB& other, const AABB& box, std::size_t axis, double offset) {
+    for (std::size_t i = 0; i < 3; ++i) {
+        if (i == axis) continue;
+        if (box.max[i] <= other.min[i] || box.min[i] >= other.max[i])
+            return offset;
+    }
 
-                if (dist < bestDist)
-                    bestDist = dist;
+    if (offset > 0.0 && box.max[axis] <= other.min[axis])
+        offset = std::min(offset, other.min[axis] - box.max[axis]);
+    else if (offset < 0.0 && box.min[axis] >= other.max[axis])
+        offset = std::max(offset, other.max[axis] - box.min[axis]);
+
+    return offset;
+}
+
+void PlayerController::GatherColliders(const AABB& area) {
+    m_Colliders.clear();
+
+    m_BlockCache.SetCenter(m_Position);
+
+    // Include the block below the area for blocks that are taller than one block, like fences.
+    Vector3i min = ToVector3i(area.min) - Vector3i(0, 1, 0);
+    Vector3i max = ToVector3i(area.max);
+
+    for (s64 x = min.x; x <= max.x; ++x) {
+        for (s64 y = min.y; y <= max.y; ++y) {
+            for (s64 z = min.z; z <= max.z; ++z) {
+                Vector3i pos(x, y, z);
+                block::BlockPtr block = m_BlockCache.GetBlock(pos);
+
+                if (!block || !block->IsSolid()) continue;
+
+                for (const AABB& bounds : block->GetBoundingBoxes()) {
+                    AABB worldBounds = bounds + pos;
+
+                    if (worldBounds.Intersects(area))
+                        m_Colliders.push_back(worldBounds);
+                }
             }
         }
     }
+}
+
+Vector3d PlayerController::SweepAxes(AABB& bounds, Vector3d delta) const {
+    static const std::size_t order[] = { 1, 0, 2 };
 
-    m_Position -= Vector3d(0.0, bestDist, 0.0);
+    for (std::size_t axis : order) {
+        if (delta[axis] == 0.0) continue;
 
-    return bestDist == FallSpeed;
+        for (const AABB& collider : m_Colliders)
+            delta[axis] = ClipAxisOffset(collider, bounds, axis, delta[axis]);
+
+        bounds.min[axis] += delta[axis];
+        bounds.max[axis] += delta[axis];
+    }
+
+    return delta;
+}
+
+Vector3d PlayerController::ResolveCollisions(Vector3d delta) {
+    AABB bounds = GetBoundingBox();
+
+    // Broadphase: every block box that the swept bounding box can touch, including a possible step up.
+    AABB area(bounds.min, bounds.max);
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        if (delta[axis] < 0.0)
+            area.min[axis] += delta[axis];
+        else
+            area.max[axis] += delta[axis];
+    }
+    area.max.y += m_StepHeight;
+
+    GatherColliders(area);
+
+    AABB moved = bounds;
+    Vector3d result = SweepAxes(moved, delta);
+
+    bool blockedHorizontally = result.x != delta.x || result.z != delta.z;
+    bool landed = delta.y < 0.0 && result.y != delta.y;
+    // A move without vertical motion doesn't say anything about the ground, so the state from the last one is used.
+    bool canStep = m_OnGround || landed;
+
+    if (delta.y != 0.0)
+        m_OnGround = landed;
+
+    if (!blockedHorizontally || m_StepHeight <= 0.0 || !canStep)
+        return result;
+
+    // Try to move up by the step height, then horizontally, then back down onto the block.
+    AABB stepped = bounds;
+    Vector3d stepResult = SweepAxes(stepped, Vector3d(0.0, m_StepHeight, 0.0));
+    Vector3d horizontal = SweepAxes(stepped, Vector3d(delta.x, 0.0, delta.z));
+    Vector3d down = SweepAxes(stepped, Vector3d(0.0, -stepResult.y + std::min(delta.y, 0.0), 0.0));
+
+    stepResult += horizontal;
+    stepResult += down;
+
+    double steppedDistSq = stepResult.x * stepResult.x + stepResult.z * stepResult.z;
+    double resultDistSq = result.x * result.x + result.z * result.z;
+
+    return steppedDistSq > resultDistSq ? stepResult : result;
 }
 
 void PlayerController::SetTargetPosition(Vector3d target) {
@@ -503,17 +622,88 @@ void PlayerController::SetHandleFall(bool handle) {
     m_HandleFall = handle;
 }
 
-void PlayerController::UpdatePosition() {
-    //static const double WalkingSpeed = 4.3; // m/s
-    //static const double WalkingSpeed = 8.6; // m/s
-    static const double TicksPerSecond = 20;
+Pathfinder& PlayerController::GetLocalPathfinder() {
+    if (!m_Pathfinder) {
+        m_PathGrid = std::make_unique<PathGrid>(m_World);
+        m_Pathfinder = std::make_unique<Pathfinder>(*m_PathGrid);
+    }
+
+    return *m_Pathfinder;
+}
+
+void PlayerController::SetPathGoal(Vector3i goal) {
+    m_HasPathGoal = true;
+    m_PathGoal = goal;
+
+    // The shared planner has its own grid, so there's no local one while it's set.
+    if (!m_PathPlanner)
+        GetLocalPathfinder().SetGoal(goal);
+}
+
+void PlayerController::ClearPathGoal() {
+    m_HasPathGoal = false;
 
-    u64 dt = GetTime() - m_LastUpdate;
+    if (m_Pathfinder)
+        m_Pathfinder->ClearGoal();
+
+    m_PlannedPath.clear();
+}
+
+void PlayerController::SetPathPlanner(PathPlanner* planner, const std::string& worldKey) {
+    if (m_PathPlanner)
+        m_PathPlanner->UnregisterWorld(m_World);
+
+    m_PathPlanner = planner;
+    m_PathRequest = std::future<std::vector<Vector3i>>();
+    m_PlannedPath.clear();
+
+    if (m_PathPlanner) {
+        m_PathPlanner->RegisterWorld(m_World, worldKey);
+
+        // Stops listening to the world as well.
+        m_Pathfinder.reset();
+        m_PathGrid.reset();
+    } else if (m_HasPathGoal) {
+        GetLocalPathfinder().SetGoal(m_PathGoal);
+    }
+}
 
-    if (dt < 1000 / TicksPerSecond)
+void PlayerController::UpdatePlannedPath(Vector3i feet) {
+    Vector3i goal = m_PathGoal;
+
+    if (m_PathRequest.valid() && m_PathRequest.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        std::vector<Vector3i> path = m_PathRequest.get();
+
+        // Drop plans for an old goal
+        if (m_PlannedGoal == goal)
+            m_PlannedPath = std::move(path);
+    }
+
+    if (m_PlannedGoal != goal)
+        m_PlannedPath.clear();
+
+    if (!m_PathRequest.valid() && (feet != m_PlannedStart || goal != m_PlannedGoal || m_PlannedPath.empty())) {
+        m_PathRequest = m_PathPlanner->Submit(m_World, feet, goal);
+        m_PlannedStart = feet;
+        m_PlannedGoal = goal;
+    }
+
+    if (m_PlannedPath.empty()) return;
+
+    // Head to the waypoint after the one that the player is on, or the first one if the player is still at the start.
+    auto iter = std::find(m_PlannedPath.begin(), m_PlannedPath.end(), feet);
+
+    if (iter == m_PlannedPath.end())
+        iter = m_PlannedPath.begin();
+    else if (++iter == m_PlannedPath.end())
         return;
 
-    m_LastUpdate = GetTime();
+    m_TargetPos = Vector3d(iter->x + 0.5, (double)iter->y, iter->z + 0.5);
+}
+
+void PlayerController::UpdatePosition() {
+    //static const double WalkingSpeed = 4.3; // m/s
+    //static const double WalkingSpeed = 8.6; // m/s
 
     static int counter = 0;
 
@@ -522,6 +712,27 @@ void PlayerController::UpdatePosition() {
         counter = 0;
     }
 
+    if (m_HasPathGoal) {
+        Vector3i feet((s64)std::floor(m_Position.x), (s64)std::floor(m_Position.y), (s64)std::floor(m_Position.z));
+
+        if (m_PathPlanner) {
+            UpdatePlannedPath(feet);
+        } else {
+            Pathfinder& pathfinder = GetLocalPathfinder();
+
+            pathfinder.SetStart(feet);
+
+            // Keep heading to the last waypoint while in the air.
+            // The target position is used as is once the goal block is reached.
+            if (pathfinder.Plan()) {
+                Vector3i next = pathfinder.GetNextStep();
+
+                if (next != feet)
+                    m_TargetPos = Vector3d(next.x + 0.5, (double)next.y, next.z + 0.5);
+            }
+        }
+    }
+
     Vector3d target = m_TargetPos;
     Vector3d toTarget = target - GetPosition();
     toTarget.y = 0;
@@ -531,7 +742,7 @@ void PlayerController::UpdatePosition() {
         return;
 
     Vector3d n = Vector3Normalize(toTarget);
-    double change = dt / 1000.0;
+    double change = m_TickTime / 1000.0;
 
     n *= m_MoveSpeed * change;
 
@@ -558,12 +769,14 @@ void PlayerController::Update() {
             for (float angle = 0.0f; angle < FullCircle; angle += FullCircle / 8) {
                 Vector3d checkPos = m_Position + Vector3RotateAboutY(Vector3d(0, 0, CheckWidth), angle) - Vector3d(0, 1, 0);
 
-                block::BlockPtr checkBlock = m_World.GetBlock(checkPos);
+                block::BlockPtr checkBlock = m_BlockCache.GetBlock(ToVector3i(checkPos));
                 if (checkBlock && checkBlock->IsSolid()) {
                     onGround = true;
                     break;
                 }
             }
+
+            m_OnGround = onGround;
         } else if (HandleFall()) {
             console << "Falling\n";
             onGround = false;
@@ -609,7 +822,7 @@ void PlayerController::Move(Vector3d delta) {
         }
     }
 
-    m_Position += delta;
+    m_Position += ResolveCollisions(delta);
 }
 
 void PlayerController::SetYaw(float yaw) { m_Yaw = yaw; }
@@ -740,9 +953,7 @@ public:
     }
 
     void HandlePacket(protocol::packets::in::ChatPacket* packet) {
-        const json& root = packet->GetChatData();
-
-        std::string message = ParseChatNode(root);
+        std::string message = ExtractChatText(packet->GetChatJson());
         std::size_t pos = message.find((char)0xA7);
         
         while (pos != std::string::npos) {
@@ -895,7 +1106,12 @@ PlayerFollower::~PlayerFollower() {
 void PlayerFollower::UpdateRotation() {
     if (!m_Following || !m_Following->GetEntity()) return;
 
-    m_PlayerController.LookAt(m_Following->GetEntity()->GetPosition());
+    auto entity = m_Following->GetEntity();
+    // The entity manager might not know the entity yet, its last position is the best guess then.
+    Vector3d position = entity->GetPosition();
+
+    m_EntityManager.GetPredictedPosition(entity->GetEntityId(), position);
+    m_PlayerController.LookAt(position);
     /*static u64 lastUpdate = GetTime();
     u64 ticks = GetTime();
     float dt = (ticks - lastUpdate) / 1000.0f;
@@ -921,6 +1137,7 @@ void PlayerFollower::OnTick() {
     UpdateRotation();
 
     if (!m_Following || !m_Following->GetEntity()) {
+        m_PlayerController.ClearPathGoal();
         m_PlayerController.SetTargetPosition(m_PlayerController.GetPosition());
         return;
     }
@@ -929,8 +1146,11 @@ void PlayerFollower::OnTick() {
     EntityId vid = entity->GetVehicleId();
     Vector3d targetPosition = entity->GetPosition();
 
+    // Both keep the last known position if the entity manager doesn't know the entity.
+    m_EntityManager.GetPredictedPosition(entity->GetEntityId(), targetPosition);
+
     if (vid != -1)
-        targetPosition = m_EntityManager.GetEntity(vid)->GetPosition();
+        m_EntityManager.GetPredictedPosition(vid, targetPosition);
 
     float yaw = (entity->GetYaw() / 256.0f) * 360.0f;
     float pitch = (entity->GetPitch() / 256.0f) * 360.0f;
@@ -950,6 +1170,18 @@ void PlayerFollower::OnTick() {
     //m_PlayerController.SetYaw(yaw);
     m_PlayerController.SetMoveSpeed(4.3 * 1.3);
     m_PlayerController.SetTargetPosition(newPosition);
+
+    // A new goal restarts the search, so the goal only follows the target once it has moved a few blocks away.
+    // The target position is still followed directly in between.
+    const s64 GoalTolerance = 3;
+    Vector3i targetBlock = ToVector3i(targetPosition);
+    Vector3i goalOffset = targetBlock - m_PlayerController.GetPathGoal();
+
+    if (!m_PlayerController.HasPathGoal() || std::abs(goalOffset.x) > GoalTolerance ||
+        std::abs(goalOffset.y) > GoalTolerance || std::abs(goalOffset.z) > GoalTolerance)
+    {
+        m_PlayerController.SetPathGoal(targetBlock);
+    }
 }
 
 bool PlayerFollower::IsIgnored(const std::wstring& name) {
@@ -961,49 +1193,35 @@ bool PlayerFollower::IsIgnored(const std::wstring& name) {
 }
 
 void PlayerFollower::FindClosestPlayer() {
-    double closest = std::numeric_limits<double>::max();
-        
-
     m_Following = nullptr;
 
-    if (!m_Target.empty()) {
+    InternedString target = InternedString::Find(utf16to8(m_Target));
+
+    if (!target.empty()) {
         for (auto& kv : m_PlayerManager) {
             auto player = kv.second;
             auto entity = player->GetEntity();
 
-            if (entity && player->GetName() == m_Target)
+            if (entity && player->GetInternedName() == target)
                 m_Following = player;
         }
     }
 
     if (!m_Following) {
-        for (auto& kv : m_PlayerManager) {
-            core::PlayerPtr player = kv.second;
-
-            if (IsIgnored(player->GetName())) continue;
-
-            auto entity = player->GetEntity();
+        auto playerEntity = m_EntityManager.GetPlayerEntity();
+        EntityId peid = playerEntity ? playerEntity->GetEntityId() : -1;
 
-            if (!entity) continue;
-
-            EntityId peid = m_EntityManager.GetPlayerEntity()->GetEntityId();
-            if (entity->GetEntityId() == peid) continue;
+        auto closest = m_EntityManager.Nearest(m_PlayerController.GetPosition(), 1, [&](const entity::EntityPtr& entity) {
+            if (entity->GetType() != entity::EntityType::Player || entity->GetEntityId() == peid)
+                return false;
 
-            Vector3d pos = entity->GetPosition();
-            EntityId vid = entity->GetVehicleId();
-            if (vid != -1) {
-                entity::EntityPtr vehicle = m_EntityManager.GetEntity(vid);
-                if (vehicle)
-                    pos = vehicle->GetPosition();
-            }
+            core::PlayerPtr player = m_PlayerManager.GetPlayerByEntityId(entity->GetEntityId());
 
-            double dist = pos.Distance(m_PlayerController.GetPosition());
+            return player && !IsIgnored(player->GetName());
+        });
 
-            if (dist < closest) {
-                closest = dist;
-                m_Following = player;
-            }
-        }
+        if (!closest.empty())
+            m_Following = m_PlayerManager.GetPlayerByEntityId(closest.front()->GetEntityId());
     }
 
     static u64 lastOutput = 0;
@@ -0,0 +1,153 @@
+#include <mclib/world/BlockCache.h>
+
+#include <cmath>
+
+namespace mc {
+namespace world {
+
+static s64 PositiveModulo(s64 value, s64 modulus) {
+    s64 result = value % modulus;
+    return result < 0 ? result + modulus : result;
+}
+
+BlockCache::BlockCache(World& world, s32 radius)
+    : m_World(world),
+      m_Radius(radius),
+      m_Size(radius * 2),
+      m_Blocks(radius * 2 * radius * 2 * radius * 2, nullptr),
+      m_Valid(false),
+      m_SolidDirty(true)
+{
+    m_SolidBlocks.reserve(m_Blocks.size());
+    m_World.RegisterListener(this);
+}
+
+BlockCache::~BlockCache() {
+    m_World.UnregisterListener(this);
+}
+
+void BlockCache::SetRadius(s32 radius) {
+    if (radius == m_Radius) return;
+
+    m_Radius = radius;
+    m_Size = radius * 2;
+    m_Blocks.assign(m_Size * m_Size * m_Size, nullptr);
+    m_SolidBlocks.reserve(m_Blocks.size());
+
+    Invalidate();
+}
+
+std::size_t BlockCache::GetIndex(Vector3i position) const {
+    s64 x = PositiveModulo(position.x, m_Size);
+    s64 y = PositiveModulo(position.y, m_Size);
+    s64 z = PositiveModulo(position.z, m_Size);
+
+    return (std::size_t)((x * m_Size + y) * m_Size + z);
+}
+
+bool BlockCache::Contains(Vector3i position) const {
+    return m_Valid &&
+        position.x >= m_Min.x && position.x < m_Min.x + m_Size &&
+        position.y >= m_Min.y && position.y < m_Min.y + m_Size &&
+        position.z >= m_Min.z && position.z < m_Min.z + m_Size;
+}
+
+bool BlockCache::Overlaps(const ChunkColumnMetadata& meta) const {
+    s64 minX = (s64)meta.x * 16;
+    s64 minZ = (s64)meta.z * 16;
+
+    return m_Valid &&
+        minX < m_Min.x + m_Size && minX + 16 > m_Min.x &&
+        minZ < m_Min.z + m_Size && minZ + 16 > m_Min.z;
+}
+
+void BlockCache::SetCenter(Vector3d center) {
+    Vector3i newMin((s64)std::floor(center.x) - m_Radius, (s64)std::floor(center.y) - m_Radius, (s64)std::floor(center.z) - m_Radius);
+
+    if (m_Valid && newMin == m_Min) return;
+
+    Vector3i oldMin = m_Min;
+    bool oldValid = m_Valid;
+
+    m_Min = newMin;
+    m_Valid = true;
+
+    for (s64 x = newMin.x; x < newMin.x + m_Size; ++x) {
+        for (s64 y = newMin.y; y < newMin.y + m_Size; ++y) {
+            for (s64 z = newMin.z; z < newMin.z + m_Size; ++z) {
+                bool cached = oldValid &&
+                    x >= oldMin.x && x < oldMin.x + m_Size &&
+                    y >= oldMin.y && y < oldMin.y + m_Size &&
+                    z >= oldMin.z && z < oldMin.z + m_Size;
+
+                if (cached) continue;
+
+                Vector3i position(x, y, z);
+                m_Blocks[GetIndex(position)] = m_World.GetBlock(position);
+            }
+        }
+    }
+
+    m_SolidDirty = true;
+}
+
+void BlockCache::Invalidate() {
+    m_Valid = false;
+    m_SolidDirty = true;
+}
+
+block::BlockPtr BlockCache::GetBlock(Vector3i position) const {
+    if (!Contains(position))
+        return m_World.GetBlock(position);
+
+    return m_Blocks[GetIndex(position)];
+}
+
+const std::vector<BlockCache::BlockPosition>& BlockCache::GetSolidBlocks() {
+    if (!m_SolidDirty) return m_SolidBlocks;
+
+    m_SolidBlocks.clear();
+
+    if (m_Valid) {
+        for (s64 z = m_Min.z; z < m_Min.z + m_Size; ++z) {
+            for (s64 y = m_Min.y; y < m_Min.y + m_Size; ++y) {
+                for (s64 x = m_Min.x; x < m_Min.x + m_Size; ++x) {
+                    Vector3i position(x, y, z);
+                    block::BlockPtr block = m_Blocks[GetIndex(position)];
+
+                    if (block && block->IsSolid())
+                        m_SolidBlocks.emplace_back(block, position);
+                }
+            }
+        }
+    }
+
+    m_SolidDirty = false;
+    return m_SolidBlocks;
+}
+
+void BlockCache::OnBlockChange(Vector3i position, block::BlockPtr newBlock, block::BlockPtr /*oldBlock*/) {
+    if (!Contains(position)) return;
+
+    m_Blocks[GetIndex(position)] = newBlock;
+    m_SolidDirty = true;
+}
+
+void BlockCache::OnColumnLoad(const ChunkColumn& column, u16 /*changedMask*/) {
+    if (Overlaps(column.GetMetadata()))
+        Invalidate();
+}
+
+void BlockCache::OnChunkUnload(ChunkColumnPtr chunk) {
+    if (chunk && Overlaps(chunk->GetMetadata()))
+        Invalidate();
+}
+
+void BlockCache::OnChunkEvict(ChunkColumnPtr chunk, bool compressed) {
+    // Compressed columns are restored on access, so the cached blocks are still correct.
+    if (!compressed && chunk && Overlaps(chunk->GetMetadata()))
+        Invalidate();
+}
+
+} // ns world
+} // ns mc
@@ -1,28 +1,204 @@
 #include <mclib/world/Chunk.h>
 
 #include <mclib/common/DataBuffer.h>
+#include <mclib/world/ChunkInterner.h>
 
 #include <algorithm>
+#include <stdexcept>
+#include <zlib.h>
 
 namespace mc {
 namespace world {
 
+// Compressed data is prefixed with the raw size so the inflated buffer can be allocated up front.
+// The output is left empty if compression fails.
+static bool DeflateBuffer(const DataBuffer& in, std::string& out) {
+    std::string raw = in.ToString();
+    uLongf size = compressBound((uLong)raw.size());
+
+    out.resize(sizeof(u32) + size);
+    if (compress((Bytef*)&out[sizeof(u32)], &size, (const Bytef*)raw.data(), (uLong)raw.size()) != Z_OK) {
+        std::string().swap(out);
+        return false;
+    }
+    out.resize(sizeof(u32) + size);
+
+    u32 rawSize = (u32)raw.size();
+    memcpy(&out[0], &rawSize, sizeof(u32));
+
+    out.shrink_to_fit();
+    return true;
+}
+
+static bool InflateBuffer(const std::string& in, DataBuffer& out) {
+    if (in.size() < sizeof(u32)) return false;
+
+    u32 rawSize;
+    memcpy(&rawSize, &in[0], sizeof(u32));
+
+    std::string raw;
+    raw.resize(rawSize);
+
+    uLongf size = rawSize;
+    if (uncompress((Bytef*)&raw[0], &size, (const Bytef*)&in[sizeof(u32)], (uLong)(in.size() - sizeof(u32))) != Z_OK)
+        return false;
+
+    out = DataBuffer(raw);
+    return true;
+}
+
+static u32 GetInflatedSize(const std::string& in) {
+    u32 rawSize = 0;
+    if (in.size() >= sizeof(u32))
+        memcpy(&rawSize, &in[0], sizeof(u32));
+    return rawSize;
+}
+
 Chunk::Chunk()
+    : m_BitsPerBlock(4),
+      m_CompressedEmpty(false),
+      m_Interned(false),
+      m_Accessed(true),
+      m_Inflated(false)
 {
-    m_BitsPerBlock = 4;
+
 }
 
-Chunk::Chunk(const Chunk& other) {
-    m_Data = other.m_Data;
-    m_BitsPerBlock = other.m_BitsPerBlock;
+Chunk::Chunk(const Chunk& other)
+    : m_Palette(other.m_Palette),
+      m_Data(other.m_Data),
+      m_Compressed(other.m_Compressed),
+      m_BitsPerBlock(other.m_BitsPerBlock),
+      m_CompressedEmpty(other.m_CompressedEmpty),
+      m_Interned(false),
+      m_Accessed(true),
+      m_Inflated(false)
+{
+
 }
 
 Chunk& Chunk::operator=(const Chunk& other) {
+    m_Palette = other.m_Palette;
     m_Data = other.m_Data;
+    m_Compressed = other.m_Compressed;
     m_BitsPerBlock = other.m_BitsPerBlock;
+    m_CompressedEmpty = other.m_CompressedEmpty;
+    m_Accessed.store(true, std::memory_order_relaxed);
     return *this;
 }
 
+void Chunk::Inflate() const {
+    if (m_Compressed.empty()) return;
+
+    DataBuffer buffer;
+
+    // The compressed data is kept so the chunk stays consistent if the caller recovers.
+    if (!InflateBuffer(m_Compressed, buffer))
+        throw std::runtime_error("Failed to inflate chunk");
+
+    ReadData(buffer);
+
+    std::string().swap(m_Compressed);
+    m_Inflated.store(true, std::memory_order_relaxed);
+}
+
+void Chunk::Decompress() {
+    Inflate();
+}
+
+void Chunk::Compress() {
+    // Other columns could be reading an interned chunk.
+    if (IsCompressed() || m_Data.empty() || m_Interned) return;
+
+    DataBuffer buffer;
+    Serialize(buffer);
+
+    m_CompressedEmpty = IsEmpty();
+
+    // Stay uncompressed if zlib fails.
+    if (!DeflateBuffer(buffer, m_Compressed)) return;
+
+    std::vector<u32>().swap(m_Palette);
+    std::vector<u64>().swap(m_Data);
+}
+
+std::size_t Chunk::GetCompressionSavings() const {
+    if (!IsCompressed()) return 0;
+
+    std::size_t inflated = GetInflatedSize(m_Compressed);
+    return inflated > m_Compressed.capacity() ? inflated - m_Compressed.capacity() : 0;
+}
+
+bool Chunk::operator==(const Chunk& other) const {
+    Inflate();
+    other.Inflate();
+
+    return m_BitsPerBlock == other.m_BitsPerBlock && m_Palette == other.m_Palette && m_Data == other.m_Data;
+}
+
+std::size_t Chunk::GetHash() const {
+    Inflate();
+
+    // FNV-1a over the raw palette and data
+    u64 hash = 14695981039346656037ULL;
+
+    auto mix = [&hash](u64 value) {
+        for (s32 i = 0; i < 8; ++i) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    mix(m_BitsPerBlock);
+    mix(m_Palette.size());
+    for (u32 type : m_Palette)
+        mix(type);
+    for (u64 data : m_Data)
+        mix(data);
+
+    return (std::size_t)hash;
+}
+
+std::size_t Chunk::GetMemoryUsage() const {
+    return sizeof(Chunk) + m_Palette.capacity() * sizeof(u32) + m_Data.capacity() * sizeof(u64) + m_Compressed.capacity();
+}
+
+void Chunk::Serialize(DataBuffer& out) const {
+    Inflate();
+
+    out << m_BitsPerBlock;
+
+    out << (u32)m_Palette.size();
+    for (u32 type : m_Palette)
+        out << type;
+
+    out << (u32)m_Data.size();
+    for (u64 data : m_Data)
+        out << data;
+}
+
+void Chunk::Deserialize(DataBuffer& in) {
+    std::string().swap(m_Compressed);
+    ReadData(in);
+}
+
+void Chunk::ReadData(DataBuffer& in) const {
+    u32 paletteLength;
+    u32 dataLength;
+
+    in >> m_BitsPerBlock;
+
+    in >> paletteLength;
+    m_Palette.resize(paletteLength);
+    for (u32 i = 0; i < paletteLength; ++i)
+        in >> m_Palette[i];
+
+    in >> dataLength;
+    m_Data.resize(dataLength);
+    for (u32 i = 0; i < dataLength; ++i)
+        in >> m_Data[i];
+}
+
 void Chunk::Load(DataBuffer& in, ChunkColumnMetadata* meta, s32 chunkIndex) {
     in >> m_BitsPerBlock;
 
@@ -59,43 +235,41 @@ void Chunk::Load(DataBuffer& in, ChunkColumnMetadata* meta, s32 chunkIndex) {
     }
 }
 
-block::BlockPtr Chunk::GetBlock(Vector3i chunkPosition) const {
-    if (chunkPosition.x < 0 || chunkPosition.x > 15 || chunkPosition.y < 0 || chunkPosition.y > 15 || chunkPosition.z < 0 || chunkPosition.z > 15) {
-        return block::BlockRegistry::GetInstance()->GetBlock(0);
-    }
-
-    const std::size_t index = (std::size_t)(chunkPosition.y * 16 * 16 + chunkPosition.z * 16 + chunkPosition.x);
-    const s32 bitIndex = index * m_BitsPerBlock;
-    const s32 startIndex = bitIndex / 64;
-    const s32 endIndex = (((index + 1) * m_BitsPerBlock) - 1) / 64;
+u32 Chunk::ReadValue(std::size_t index) const {
+    const std::size_t bitIndex = index * m_BitsPerBlock;
+    const std::size_t startIndex = bitIndex / 64;
+    const std::size_t endIndex = (((index + 1) * m_BitsPerBlock) - 1) / 64;
     const s32 startSubIndex = bitIndex % 64;
+    const u64 maxValue = (1ULL << m_BitsPerBlock) - 1;
 
-    const s64 maxValue = (1 << m_BitsPerBlock) - 1;
-    u32 value;
+    if (startIndex == endIndex)
+        return (u32)((m_Data[startIndex] >> startSubIndex) & maxValue);
 
-    if (startIndex == endIndex) {
-        value = (u32)((m_Data[startIndex] >> startSubIndex) & maxValue);
-    } else {
-        const s32 endSubIndex = 64 - startSubIndex;
+    const s32 endSubIndex = 64 - startSubIndex;
 
-        value = (u32)(((m_Data[startIndex] >> startSubIndex) | (m_Data[endIndex] << endSubIndex)) & maxValue);
-    }
+    return (u32)(((m_Data[startIndex] >> startSubIndex) | (m_Data[endIndex] << endSubIndex)) & maxValue);
+}
 
-    const u16 blockType = m_BitsPerBlock < 9 ? m_Palette[value] : value;
+void Chunk::WriteValue(std::size_t index, u32 value) {
+    const std::size_t bitIndex = index * m_BitsPerBlock;
+    const std::size_t startIndex = bitIndex / 64;
+    const std::size_t endIndex = (((index + 1) * m_BitsPerBlock) - 1) / 64;
+    const s32 startSubIndex = bitIndex % 64;
+    const u64 maxValue = (1ULL << m_BitsPerBlock) - 1;
 
-    return block::BlockRegistry::GetInstance()->GetBlock(blockType);
-}
+    // Erase old value in data entry and OR with new data
+    m_Data[startIndex] = (m_Data[startIndex] & ~(maxValue << startSubIndex)) | (((u64)value & maxValue) << startSubIndex);
 
-void Chunk::SetBlock(Vector3i chunkPosition, block::BlockPtr block) {
-    std::size_t index = (std::size_t)(chunkPosition.y * 16 * 16 + chunkPosition.z * 16 + chunkPosition.x);
-    s32 bitIndex = index * m_BitsPerBlock;
-    s32 startIndex = bitIndex / 64;
-    s32 endIndex = (((index + 1) * m_BitsPerBlock) - 1) / 64;
-    s32 startSubIndex = bitIndex % 64;
+    if (startIndex != endIndex) {
+        const s32 endSubIndex = 64 - startSubIndex;
+        const u64 endMask = (1ULL << (m_BitsPerBlock - endSubIndex)) - 1;
 
-    s64 maxValue = (1 << m_BitsPerBlock) - 1;
-    u32 blockType = block->GetType();
+        // Erase the part of the value that overflowed into the next entry and then OR with new data
+        m_Data[endIndex] = (m_Data[endIndex] & ~endMask) | (((u64)value & maxValue) >> endSubIndex);
+    }
+}
 
+void Chunk::InitializeData() {
     if (m_BitsPerBlock == 0) {
         m_BitsPerBlock = 4;
     }
@@ -107,29 +281,133 @@ void Chunk::SetBlock(Vector3i chunkPosition, block::BlockPtr block) {
         m_Data.resize(size);
         memset(&m_Data[0], 0, size * sizeof(m_Data[0]));
     }
+}
 
-    auto iter = std::find_if(m_Palette.begin(), m_Palette.end(), [blockType](u32 ptype) {
-        return ptype == blockType;
-    });
+void Chunk::Repack(u8 bitsPerBlock) {
+    std::vector<u32> values(16 * 16 * 16);
+    const bool toGlobal = bitsPerBlock > 8 && m_BitsPerBlock < 9;
 
-    if (iter == m_Palette.end())
-        iter = m_Palette.insert(m_Palette.end(), blockType);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        u32 value = ReadValue(i);
 
-    s32 value = std::distance(m_Palette.begin(), iter);
+        values[i] = toGlobal ? m_Palette[value] : value;
+    }
 
-    // Erase old value in data entry and OR with new data
-    m_Data[startIndex] = (m_Data[startIndex] & ~(maxValue << startSubIndex)) | (((s64)value & maxValue) << startSubIndex);
+    if (toGlobal)
+        m_Palette.clear();
 
-    if (startIndex != endIndex) {
-        s32 endSubIndex = 64 - startSubIndex;
+    m_BitsPerBlock = bitsPerBlock;
+    m_Data.assign((values.size() * m_BitsPerBlock + 63) / 64, 0);
+
+    for (std::size_t i = 0; i < values.size(); ++i)
+        WriteValue(i, values[i]);
+}
+
+u32 Chunk::GetPaletteValue(u32 blockType) {
+    // The global palette stores the block type directly
+    if (m_BitsPerBlock > 8) return blockType;
+
+    auto iter = std::find(m_Palette.begin(), m_Palette.end(), blockType);
+
+    if (iter != m_Palette.end())
+        return (u32)std::distance(m_Palette.begin(), iter);
+
+    m_Palette.push_back(blockType);
+
+    if (m_Palette.size() > (1ULL << m_BitsPerBlock)) {
+        Repack(m_BitsPerBlock < 8 ? m_BitsPerBlock + 1 : GlobalPaletteBits);
+
+        if (m_BitsPerBlock > 8) return blockType;
+    }
+
+    return (u32)(m_Palette.size() - 1);
+}
 
-        // Erase beginning of data and then OR with new data
-        m_Data[endIndex] = (m_Data[endIndex] >> endSubIndex << endSubIndex) | ((s64)value & maxValue) >> endSubIndex;
+bool Chunk::IsEmpty() const {
+    if (!m_Compressed.empty())
+        return m_CompressedEmpty;
+
+    if (m_Data.empty()) return true;
+    if (m_BitsPerBlock > 8) return false;
+
+    return std::all_of(m_Palette.begin(), m_Palette.end(), [](u32 type) { return type == 0; });
+}
+
+block::BlockPtr Chunk::GetBlock(Vector3i chunkPosition) const {
+    if (chunkPosition.x < 0 || chunkPosition.x > 15 || chunkPosition.y < 0 || chunkPosition.y > 15 || chunkPosition.z < 0 || chunkPosition.z > 15) {
+        return block::BlockRegistry::GetInstance()->GetBlock(0);
+    }
+
+    // Only written when it changes, so readers of a shared chunk don't keep invalidating its cache line.
+    if (!m_Accessed.load(std::memory_order_relaxed))
+        m_Accessed.store(true, std::memory_order_relaxed);
+
+    if (!m_Compressed.empty())
+        Inflate();
+
+    const std::size_t index = (std::size_t)(chunkPosition.y * 16 * 16 + chunkPosition.z * 16 + chunkPosition.x);
+    const u32 value = ReadValue(index);
+    const u16 blockType = m_BitsPerBlock < 9 ? m_Palette[value] : value;
+
+    return block::BlockRegistry::GetInstance()->GetBlock(blockType);
+}
+
+void Chunk::SetBlock(Vector3i chunkPosition, block::BlockPtr block) {
+    std::size_t index = (std::size_t)(chunkPosition.y * 16 * 16 + chunkPosition.z * 16 + chunkPosition.x);
+
+    m_Accessed.store(true, std::memory_order_relaxed);
+    if (!m_Compressed.empty())
+        Inflate();
+
+    InitializeData();
+
+    WriteValue(index, GetPaletteValue(block->GetType()));
+}
+
+void Chunk::SetBlocks(const std::vector<std::pair<Vector3i, block::BlockPtr>>& blocks) {
+    if (blocks.empty()) return;
+
+    m_Accessed.store(true, std::memory_order_relaxed);
+    if (!m_Compressed.empty())
+        Inflate();
+
+    InitializeData();
+
+    // Add all of the new types to the palette before writing anything, so the data only gets repacked
+    // while the palette grows and the stored values stay valid afterwards.
+    std::vector<std::pair<u32, u32>> typeValues;
+
+    for (const auto& entry : blocks) {
+        u32 blockType = entry.second->GetType();
+
+        auto iter = std::find_if(typeValues.begin(), typeValues.end(), [blockType](const std::pair<u32, u32>& typeValue) {
+            return typeValue.first == blockType;
+        });
+
+        if (iter == typeValues.end()) {
+            typeValues.emplace_back(blockType, 0);
+            GetPaletteValue(blockType);
+        }
+    }
+
+    for (auto& typeValue : typeValues)
+        typeValue.second = GetPaletteValue(typeValue.first);
+
+    for (const auto& entry : blocks) {
+        const Vector3i& pos = entry.first;
+        u32 blockType = entry.second->GetType();
+
+        auto iter = std::find_if(typeValues.begin(), typeValues.end(), [blockType](const std::pair<u32, u32>& typeValue) {
+            return typeValue.first == blockType;
+        });
+
+        WriteValue((std::size_t)(pos.y * 16 * 16 + pos.z * 16 + pos.x), iter->second);
     }
 }
 
 ChunkColumn::ChunkColumn(ChunkColumnMetadata metadata)
-    : m_Metadata(metadata)
+    : m_Metadata(metadata),
+      m_LastAccess(0)
 {
     for (std::size_t i = 0; i < m_Chunks.size(); ++i)
         m_Chunks[i] = nullptr;
@@ -139,11 +417,149 @@ block::BlockPtr ChunkColumn::GetBlock(Vector3i position) {
     s32 chunkIndex = (s32)(position.y / 16);
     Vector3i relativePosition(position.x, position.y % 16, position.z);
 
+    // The chunks are null while the column is compressed, so they would read as air.
+    Decompress();
+
     if (chunkIndex < 0 || chunkIndex > 15 || !m_Chunks[chunkIndex]) return block::BlockRegistry::GetInstance()->GetBlock(0);
 
     return m_Chunks[chunkIndex]->GetBlock(relativePosition);
 }
 
+ChunkPtr& ChunkColumn::GetWritableChunk(s32 chunkIndex) {
+    ChunkPtr& chunk = m_Chunks[chunkIndex];
+
+    if (!chunk)
+        chunk = std::make_shared<Chunk>();
+    else if (chunk->IsInterned())
+        chunk = std::make_shared<Chunk>(*chunk);
+
+    return chunk;
+}
+
+void ChunkColumn::SetBlock(Vector3i position, block::BlockPtr block) {
+    s32 chunkIndex = (s32)(position.y / 16);
+
+    if (chunkIndex < 0 || chunkIndex > 15) return;
+
+    Decompress();
+
+    GetWritableChunk(chunkIndex)->SetBlock(Vector3i(position.x, position.y % 16, position.z), block);
+}
+
+void ChunkColumn::SetBlocks(const std::vector<std::pair<Vector3i, block::BlockPtr>>& blocks) {
+    std::array<std::vector<std::pair<Vector3i, block::BlockPtr>>, ChunksPerColumn> chunkBlocks;
+
+    for (const auto& entry : blocks) {
+        s32 chunkIndex = (s32)(entry.first.y / 16);
+
+        if (chunkIndex < 0 || chunkIndex > 15) continue;
+
+        chunkBlocks[chunkIndex].emplace_back(Vector3i(entry.first.x, entry.first.y % 16, entry.first.z), entry.second);
+    }
+
+    Decompress();
+
+    for (s32 i = 0; i < ChunksPerColumn; ++i) {
+        if (chunkBlocks[i].empty()) continue;
+
+        GetWritableChunk(i)->SetBlocks(chunkBlocks[i]);
+    }
+}
+
+void ChunkColumn::ReplaceChunks(const ChunkColumn& other, u16 mask) {
+    for (s32 i = 0; i < ChunksPerColumn; ++i) {
+        if (mask & (1 << i))
+            m_Chunks[i] = other.m_Chunks[i];
+    }
+}
+
+void ChunkColumn::Intern(ChunkInterner& interner) {
+    for (ChunkPtr& chunk : m_Chunks) {
+        if (chunk)
+            chunk = interner.Intern(chunk);
+    }
+}
+
+void ChunkColumn::CompressIdleChunks(u64& compressions, u64& inflations) {
+    for (ChunkPtr& chunk : m_Chunks) {
+        if (!chunk) continue;
+
+        if (chunk->ConsumeInflated())
+            ++inflations;
+
+        // A chunk is idle if it wasn't accessed during the entire time since the last check.
+        if (chunk->ConsumeAccessed() || chunk->IsCompressed()) continue;
+
+        if (chunk->IsInterned()) {
+            // Still used by another column, so compressing a copy wouldn't free anything.
+            if (chunk.use_count() > 1) continue;
+
+            // The interner could hand the chunk to another column at any time, so it's never compressed in place.
+            chunk = std::make_shared<Chunk>(*chunk);
+        }
+
+        chunk->Compress();
+
+        if (chunk->IsCompressed())
+            ++compressions;
+    }
+}
+
+std::size_t ChunkColumn::GetMemoryUsage() const {
+    std::size_t usage = sizeof(ChunkColumn);
+
+    for (const ChunkPtr& chunk : m_Chunks) {
+        if (chunk)
+            usage += chunk->GetMemoryUsage();
+    }
+
+    usage += m_BlockEntities.size() * (sizeof(Vector3i) + sizeof(block::BlockEntityPtr));
+    usage += m_CompressedChunks.capacity();
+
+    return usage;
+}
+
+void ChunkColumn::Compress() {
+    if (IsCompressed()) return;
+
+    DataBuffer buffer;
+
+    for (const ChunkPtr& chunk : m_Chunks) {
+        buffer << (u8)(chunk != nullptr);
+
+        if (chunk)
+            chunk->Serialize(buffer);
+    }
+
+    // The chunks are only released once their compressed copy exists.
+    if (!DeflateBuffer(buffer, m_CompressedChunks)) return;
+
+    for (ChunkPtr& chunk : m_Chunks)
+        chunk = nullptr;
+}
+
+void ChunkColumn::Decompress() {
+    if (!IsCompressed()) return;
+
+    DataBuffer buffer;
+    if (!InflateBuffer(m_CompressedChunks, buffer))
+        throw std::runtime_error("Failed to inflate chunk column");
+
+    std::string().swap(m_CompressedChunks);
+
+    for (ChunkPtr& chunk : m_Chunks) {
+        u8 present;
+        buffer >> present;
+
+        if (present) {
+            chunk = std::make_shared<Chunk>();
+            chunk->Deserialize(buffer);
+        } else {
+            chunk = nullptr;
+        }
+    }
+}
+
 block::BlockEntityPtr ChunkColumn::GetBlockEntity(Vector3i worldPos) {
     auto iter = m_BlockEntities.find(worldPos);
     if (iter == m_BlockEntities.end()) return nullptr;
@@ -0,0 +1,72 @@
+#include <mclib/world/ChunkInterner.h>
+
+namespace mc {
+namespace world {
+
+ChunkInterner::ChunkInterner()
+    : m_Hits(0),
+      m_Misses(0),
+      m_InsertsSincePrune(0)
+{
+
+}
+
+void ChunkInterner::Prune() {
+    for (auto iter = m_Chunks.begin(); iter != m_Chunks.end();) {
+        if (iter->second.expired())
+            iter = m_Chunks.erase(iter);
+        else
+            ++iter;
+    }
+
+    m_InsertsSincePrune = 0;
+}
+
+ChunkPtr ChunkInterner::Intern(ChunkPtr chunk) {
+    if (!chunk || chunk->IsInterned()) return chunk;
+
+    // Interned chunks are shared read-only, so they have to be inflated before anyone else can see them.
+    chunk->Decompress();
+
+    std::size_t hash = chunk->GetHash();
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto range = m_Chunks.equal_range(hash);
+    for (auto iter = range.first; iter != range.second;) {
+        ChunkPtr existing = iter->second.lock();
+
+        if (!existing) {
+            iter = m_Chunks.erase(iter);
+            continue;
+        }
+
+        if (*existing == *chunk) {
+            ++m_Hits;
+            return existing;
+        }
+
+        ++iter;
+    }
+
+    chunk->SetInterned(true);
+    m_Chunks.insert(std::make_pair(hash, std::weak_ptr<Chunk>(chunk)));
+    ++m_Misses;
+
+    // Expired entries are only removed when their bucket is searched, so sweep everything once in a while.
+    if (++m_InsertsSincePrune >= 4096)
+        Prune();
+
+    return chunk;
+}
+
+std::size_t ChunkInterner::GetSize() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    Prune();
+
+    return m_Chunks.size();
+}
+
+} // ns world
+} // ns mc
@@ -1,10 +1,26 @@
 #include <mclib/world/World.h>
 
+#include <mclib/util/Utility.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 namespace mc {
 namespace world {
 
 World::World(protocol::packets::PacketDispatcher* dispatcher)
-    : protocol::packets::PacketHandler(dispatcher)
+    : protocol::packets::PacketHandler(dispatcher),
+      m_MemoryBudget(0),
+      m_EvictionPolicy(EvictionPolicy::LeastRecentlyUsed),
+      m_CompressEvicted(false),
+      m_AccessCounter(0),
+      m_StoragePolicy(ChunkStoragePolicy::Uncompressed),
+      m_IdleTime(30000),
+      m_LastIdleCheck(0)
 {
     dispatcher->RegisterHandler(protocol::State::Play, protocol::play::MultiBlockChange, this);
     dispatcher->RegisterHandler(protocol::State::Play, protocol::play::BlockChange, this);
@@ -20,7 +36,7 @@ World::~World() {
 }
 
 bool World::SetBlock(Vector3i position, u32 blockData) {
-    ChunkColumnPtr chunk = GetChunk(position);
+    ChunkColumnPtr chunk = RestoreChunk(position);
     if (!chunk) return false;
 
     Vector3i relative(position);
@@ -33,32 +49,47 @@ bool World::SetBlock(Vector3i position, u32 blockData) {
     if (relative.z < 0)
         relative.z += 16;
 
-    std::size_t index = (std::size_t)position.y / 16;
-    if ((*chunk)[index] == nullptr) {
-        ChunkPtr section = std::make_shared<Chunk>();
-
-        (*chunk)[index] = section;
-    }
-
-    relative.y %= 16;
-    (*chunk)[index]->SetBlock(relative, block::BlockRegistry::GetInstance()->GetBlock(blockData));
+    chunk->SetBlock(relative, block::BlockRegistry::GetInstance()->GetBlock(blockData));
     return true;
 }
 
 void World::HandlePacket(protocol::packets::in::ExplosionPacket* packet) {
     Vector3d position = packet->GetPosition();
+    block::BlockPtr newBlock = block::BlockRegistry::GetInstance()->GetBlock(0);
+    const auto& affectedBlocks = packet->GetAffectedBlocks();
+    std::vector<BlockChange> blockChanges;
+    std::map<ChunkCoord, std::vector<std::pair<Vector3i, block::BlockPtr>>> columnBlocks;
+    std::unordered_set<Vector3i, Vector3Hash<s64>> changed;
 
-    for (Vector3s offset : packet->GetAffectedBlocks()) {
-        Vector3d absolute = position + ToVector3d(offset);
+    blockChanges.reserve(affectedBlocks.size());
 
-        block::BlockPtr oldBlock = GetBlock(absolute);
+    for (Vector3s offset : affectedBlocks) {
+        Vector3i absolute = ToVector3i(position + ToVector3d(offset));
+        s32 chunkX = (s32)std::floor(absolute.x / 16.0);
+        s32 chunkZ = (s32)std::floor(absolute.z / 16.0);
+
+        // A block that was already listed is air by now.
+        block::BlockPtr oldBlock = changed.insert(absolute).second ? GetBlock(absolute) : newBlock;
 
         // Set all affected blocks to air
-        SetBlock(ToVector3i(absolute), 0);
+        Vector3i relative(absolute.x - chunkX * 16, absolute.y, absolute.z - chunkZ * 16);
+        columnBlocks[ChunkCoord(chunkX, chunkZ)].emplace_back(relative, newBlock);
+
+        blockChanges.emplace_back(absolute, newBlock, oldBlock);
+    }
+
+    // Each column is updated in one batch. GetBlock above already restored the columns that were compressed.
+    for (const auto& kv : columnBlocks) {
+        auto iter = m_Chunks.find(kv.first);
 
-        block::BlockPtr newBlock = block::BlockRegistry::GetInstance()->GetBlock(0);
-        NotifyListeners(&WorldListener::OnBlockChange, ToVector3i(absolute), newBlock, oldBlock);
+        if (iter != m_Chunks.end() && iter->second)
+            iter->second->SetBlocks(kv.second);
     }
+
+    for (const BlockChange& change : blockChanges)
+        NotifyListeners(&WorldListener::OnBlockChange, change.position, change.newBlock, change.oldBlock);
+
+    NotifyListeners(&WorldListener::OnBlockChanges, std::cref(blockChanges));
 }
 
 void World::HandlePacket(protocol::packets::in::ChunkDataPacket* packet) {
@@ -71,26 +102,42 @@ void World::HandlePacket(protocol::packets::in::ChunkDataPacket* packet) {
         return;
     }
 
+    if (m_ChunkInterner)
+        col->Intern(*m_ChunkInterner);
+
     auto iter = m_Chunks.find(key);
+    ChunkColumnPtr stored = col;
 
     if (!meta.continuous) {
+        if (iter == m_Chunks.end() || !iter->second) return;
+
+        stored = iter->second;
+        RestoreColumn(stored);
+
         // This isn't an entire column of chunks, so just update the existing chunk column with the provided chunks.
-        for (s16 i = 0; i < ChunkColumn::ChunksPerColumn; ++i) {
-            // The section mask says whether or not there is data in this chunk.
-            if (meta.sectionmask & (1 << i)) {
-                (*iter->second)[i] = (*col)[i];
-            }
-        }
+        // The section mask says whether or not there is data in this chunk.
+        stored->ReplaceChunks(*col, meta.sectionmask);
     } else {
         // This is an entire column of chunks, so just replace the entire column with the new one.
         m_Chunks[key] = col;
+        col->SetLastAccess(++m_AccessCounter);
     }
 
+    void (WorldListener::*onChunkLoad)(ConstChunkPtr, const ChunkColumnMetadata&, u16) = &WorldListener::OnChunkLoad;
+
     for (s32 i = 0; i < ChunkColumn::ChunksPerColumn; ++i) {
-        ChunkPtr chunk = (*col)[i];
+        // Chunks that weren't sent in a partial update are unchanged
+        if (!meta.continuous && !(meta.sectionmask & (1 << i))) continue;
+
+        ConstChunkPtr chunk = (*col)[i];
 
-        NotifyListeners(&WorldListener::OnChunkLoad, chunk, meta, i);
+        NotifyListeners(onChunkLoad, chunk, meta, i);
     }
+
+    NotifyListeners(&WorldListener::OnColumnLoad, std::cref(*stored), meta.sectionmask);
+
+    if (m_MemoryBudget > 0)
+        EnforceMemoryBudget();
 }
 
 void World::HandlePacket(protocol::packets::in::MultiBlockChangePacket* packet) {
@@ -102,30 +149,39 @@ void World::HandlePacket(protocol::packets::in::MultiBlockChangePacket* packet)
     if (!chunk)
         return;
 
+    RestoreColumn(chunk);
+
     const auto& changes = packet->GetBlockChanges();
+    std::vector<std::pair<Vector3i, block::BlockPtr>> newBlocks;
+    std::vector<BlockChange> blockChanges;
+    // The block each position will have once the changes before the current one are applied.
+    std::unordered_map<Vector3i, block::BlockPtr, Vector3Hash<s64>> pending;
+
+    newBlocks.reserve(changes.size());
+    blockChanges.reserve(changes.size());
+
     for (const auto& change : changes) {
         Vector3i relative(change.x, change.y, change.z);
+        Vector3i blockChangePos = chunkStart + relative;
 
-        chunk->RemoveBlockEntity(chunkStart + relative);
+        chunk->RemoveBlockEntity(blockChangePos);
 
-        std::size_t index = change.y / 16;
-        block::BlockPtr oldBlock = block::BlockRegistry::GetInstance()->GetBlock(0);
-        if ((*chunk)[index] == nullptr) {
-            ChunkPtr section = std::make_shared<Chunk>();
+        block::BlockPtr newBlock = block::BlockRegistry::GetInstance()->GetBlock(change.blockData);
+        block::BlockPtr& pendingBlock = pending[relative];
+        // A position can be changed more than once in the same packet, so the old block is the result of the previous change.
+        block::BlockPtr oldBlock = pendingBlock ? pendingBlock : chunk->GetBlock(relative);
 
-            (*chunk)[index] = section;
-        } else {
-            oldBlock = chunk->GetBlock(relative);
-        }
+        pendingBlock = newBlock;
+        newBlocks.emplace_back(relative, newBlock);
+        blockChanges.emplace_back(blockChangePos, newBlock, oldBlock);
+    }
 
-        block::BlockPtr newBlock = block::BlockRegistry::GetInstance()->GetBlock(change.blockData);
+    chunk->SetBlocks(newBlocks);
 
-        Vector3i blockChangePos = chunkStart + relative;
+    for (const BlockChange& change : blockChanges)
+        NotifyListeners(&WorldListener::OnBlockChange, change.position, change.newBlock, change.oldBlock);
 
-        relative.y %= 16;
-        (*chunk)[index]->SetBlock(relative, newBlock);
-        NotifyListeners(&WorldListener::OnBlockChange, blockChangePos, newBlock, oldBlock);
-    }
+    NotifyListeners(&WorldListener::OnBlockChanges, std::cref(blockChanges));
 }
 
 void World::HandlePacket(protocol::packets::in::BlockChangePacket* packet) {
@@ -136,7 +192,7 @@ void World::HandlePacket(protocol::packets::in::BlockChangePacket* packet) {
 
     NotifyListeners(&WorldListener::OnBlockChange, packet->GetPosition(), newBlock, oldBlock);
 
-    ChunkColumnPtr col = GetChunk(packet->GetPosition());
+    ChunkColumnPtr col = RestoreChunk(packet->GetPosition());
     if (col) {
         col->RemoveBlockEntity(packet->GetPosition());
     }
@@ -192,6 +248,162 @@ ChunkColumnPtr World::GetChunk(Vector3i pos) const {
     return iter->second;
 }
 
+ChunkColumnPtr World::RestoreChunk(Vector3i pos) {
+    ChunkColumnPtr column = GetChunk(pos);
+
+    if (column)
+        RestoreColumn(column);
+
+    return column;
+}
+
+void World::RestoreColumn(const ChunkColumnPtr& column) const {
+    column->SetLastAccess(++m_AccessCounter);
+
+    if (!column->IsCompressed()) return;
+
+    column->Decompress();
+
+    if (m_ChunkInterner)
+        column->Intern(*m_ChunkInterner);
+}
+
+void World::EvictColumn(std::map<ChunkCoord, ChunkColumnPtr>::iterator iter, bool compress) {
+    ChunkColumnPtr column = iter->second;
+
+    if (compress) {
+        column->Compress();
+    } else {
+        m_Chunks.erase(iter);
+    }
+
+    NotifyListeners(&WorldListener::OnChunkEvict, column, compress);
+}
+
+void World::CompressIdleChunks() {
+    std::size_t compressedChunks = 0;
+    std::size_t bytesSaved = 0;
+
+    for (const auto& kv : m_Chunks) {
+        ChunkColumnPtr column = kv.second;
+
+        if (!column || column->IsCompressed()) continue;
+
+        column->CompressIdleChunks(m_StorageStats.compressions, m_StorageStats.inflations);
+
+        for (s32 i = 0; i < ChunkColumn::ChunksPerColumn; ++i) {
+            ConstChunkPtr chunk = (*column)[i];
+
+            if (chunk && chunk->IsCompressed()) {
+                ++compressedChunks;
+                bytesSaved += chunk->GetCompressionSavings();
+            }
+        }
+    }
+
+    m_StorageStats.compressedChunks = compressedChunks;
+    m_StorageStats.bytesSaved = bytesSaved;
+}
+
+void World::Update() {
+    if (m_StoragePolicy != ChunkStoragePolicy::CompressIdle) return;
+
+    s64 time = util::GetTime();
+
+    if (time - m_LastIdleCheck < m_IdleTime) return;
+
+    CompressIdleChunks();
+    m_LastIdleCheck = time;
+}
+
+std::size_t World::GetMemoryUsage() const {
+    std::size_t usage = 0;
+
+    for (const auto& kv : m_Chunks) {
+        if (kv.second)
+            usage += kv.second->GetMemoryUsage();
+    }
+
+    return usage;
+}
+
+void World::EnforceMemoryBudget() {
+    if (m_MemoryBudget == 0) return;
+
+    std::size_t usage = GetMemoryUsage();
+    if (usage <= m_MemoryBudget) return;
+
+    // Evict below the budget so the next column that's loaded doesn't start another eviction right away.
+    const std::size_t target = m_MemoryBudget - m_MemoryBudget / 8;
+    const std::size_t compressedLimit = m_MemoryBudget / 2;
+
+    // Higher score gets evicted first
+    typedef std::pair<double, ChunkCoord> Candidate;
+    std::vector<Candidate> candidates;
+    std::vector<Candidate> compressedCandidates;
+    std::size_t compressedUsage = 0;
+
+    candidates.reserve(m_Chunks.size());
+
+    for (const auto& kv : m_Chunks) {
+        if (!kv.second) continue;
+
+        double dx = kv.first.first * 16.0 + 8.0 - m_EvictionCenter.x;
+        double dz = kv.first.second * 16.0 + 8.0 - m_EvictionCenter.z;
+        double distanceSq = dx * dx + dz * dz;
+
+        // Compressed columns aren't accessed until they are restored, so they are always removed by distance.
+        if (kv.second->IsCompressed()) {
+            compressedUsage += kv.second->GetMemoryUsage();
+            compressedCandidates.emplace_back(distanceSq, kv.first);
+            continue;
+        }
+
+        double score;
+        if (m_EvictionPolicy == EvictionPolicy::Distance) {
+            score = distanceSq;
+        } else {
+            score = -(double)kv.second->GetLastAccess();
+        }
+
+        candidates.emplace_back(score, kv.first);
+    }
+
+    auto compare = [](const Candidate& a, const Candidate& b) {
+        return a.first > b.first;
+    };
+
+    std::sort(candidates.begin(), candidates.end(), compare);
+    std::sort(compressedCandidates.begin(), compressedCandidates.end(), compare);
+
+    auto next = candidates.begin();
+    auto nextCompressed = compressedCandidates.begin();
+
+    while (usage > target) {
+        // Uncompressed columns are only evicted while the compressed ones stay within their share of the budget,
+        // otherwise the compressed columns would end up pushing every uncompressed column out.
+        bool removeCompressed = nextCompressed != compressedCandidates.end() && (compressedUsage > compressedLimit || next == candidates.end());
+
+        if (!removeCompressed && next == candidates.end()) break;
+
+        const Candidate& candidate = removeCompressed ? *nextCompressed++ : *next++;
+        auto iter = m_Chunks.find(candidate.second);
+        ChunkColumnPtr column = iter->second;
+        bool compress = !removeCompressed && m_CompressEvicted;
+        std::size_t before = column->GetMemoryUsage();
+
+        EvictColumn(iter, compress);
+
+        std::size_t after = compress ? column->GetMemoryUsage() : 0;
+        usage -= std::min(usage, before - std::min(before, after));
+
+        if (removeCompressed)
+            compressedUsage -= std::min(compressedUsage, before);
+        else if (compress)
+            compressedUsage += after;
+    }
+}
+
 block::BlockPtr World::GetBlock(Vector3f pos) const {
     return GetBlock(Vector3i((s64)std::floor(pos.x), (s64)std::floor(pos.y), (s64)std::floor(pos.z)));
 }
@@ -205,6 +417,8 @@ block::BlockPtr World::GetBlock(Vector3i pos) const {
 
     if (!col) return block::BlockRegistry::GetInstance()->GetBlock(0);
 
+    RestoreColumn(col);
+
     s64 x = pos.x % 16;
     s64 z = pos.z % 16;
 
@@ -216,6 +430,172 @@ block::BlockPtr World::GetBlock(Vector3i pos) const {
     return col->GetBlock(Vector3i(x, pos.y, z));
 }
 
+// Gets the face of the box that contains the point
+static Face GetHitFace(const AABB& box, Vector3d point) {
+    const std::pair<double, Face> faces[] = {
+        { std::abs(point.y - box.min.y), Face::Bottom },
+        { std::abs(point.y - box.max.y), Face::Top },
+        { std::abs(point.z - box.min.z), Face::North },
+        { std::abs(point.z - box.max.z), Face::South },
+        { std::abs(point.x - box.min.x), Face::West },
+        { std::abs(point.x - box.max.x), Face::East },
+    };
+
+    auto best = std::min_element(std::begin(faces), std::end(faces), [](const std::pair<double, Face>& a, const std::pair<double, Face>& b) {
+        return a.first < b.first;
+    });
+
+    return best->second;
+}
+
+RaycastResult World::Raycast(Vector3d origin, Vector3d direction, double maxDistance, RaycastFilter filter) {
+    RaycastResult result;
+
+    if (direction.LengthSq() <= 0.0) return result;
+
+    direction.Normalize();
+
+    const Ray ray(origin, direction);
+    const double Infinity = std::numeric_limits<double>::infinity();
+
+    Vector3i current((s64)std::floor(origin.x), (s64)std::floor(origin.y), (s64)std::floor(origin.z));
+    Vector3i step;
+    Vector3d tMax;
+    Vector3d tDelta;
+
+    // Distance along the ray to the first block boundary on each axis, and between boundaries.
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+        if (direction[axis] > 0.0) {
+            step[axis] = 1;
+            tMax[axis] = (current[axis] + 1 - origin[axis]) / direction[axis];
+            tDelta[axis] = 1.0 / direction[axis];
+        } else if (direction[axis] < 0.0) {
+            step[axis] = -1;
+            tMax[axis] = (current[axis] - origin[axis]) / direction[axis];
+            tDelta[axis] = -1.0 / direction[axis];
+        } else {
+            step[axis] = 0;
+            tMax[axis] = Infinity;
+            tDelta[axis] = Infinity;
+        }
+    }
+
+    // The chunk of the current block is cached until the ray leaves it.
+    bool cached = false;
+    s64 chunkX = 0, chunkY = 0, chunkZ = 0;
+    ConstChunkPtr chunk;
+
+    double t = 0.0;
+
+    while (t <= maxDistance) {
+        s64 currentChunkX = (s64)std::floor(current.x / 16.0);
+        s64 currentChunkY = (s64)std::floor(current.y / 16.0);
+        s64 currentChunkZ = (s64)std::floor(current.z / 16.0);
+
+        if (!cached || currentChunkX != chunkX || currentChunkY != chunkY || currentChunkZ != chunkZ) {
+            chunkX = currentChunkX;
+            chunkY = currentChunkY;
+            chunkZ = currentChunkZ;
+            chunk = nullptr;
+            cached = true;
+
+            if (chunkY >= 0 && chunkY < ChunkColumn::ChunksPerColumn) {
+                ChunkColumnPtr column = RestoreChunk(current);
+
+                if (column) {
+                    chunk = (*column)[(std::size_t)chunkY];
+
+                    if (chunk && chunk->IsEmpty())
+                        chunk = nullptr;
+                }
+            }
+        }
+
+        if (!chunk) {
+            // Nothing in this section can be hit, so jump to where the ray leaves it instead of walking each block.
+            const Vector3i sectionMin(chunkX * 16, chunkY * 16, chunkZ * 16);
+            Vector3i steps;
+            std::size_t exitAxis = 0;
+            double exitTime = Infinity;
+
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                if (step[axis] == 0) continue;
+
+                // Number of steps along this axis until the ray is in the next section.
+                steps[axis] = step[axis] > 0 ? sectionMin[axis] + 16 - current[axis] : current[axis] - sectionMin[axis] + 1;
+
+                double crossTime = tMax[axis] + (steps[axis] - 1) * tDelta[axis];
+
+                if (crossTime < exitTime) {
+                    exitTime = crossTime;
+                    exitAxis = axis;
+                }
+            }
+
+            // The other axes take every step that the block walk would take before the ray leaves the section.
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+                if (step[axis] == 0) continue;
+
+                s64 count = steps[axis];
+
+                if (axis != exitAxis) {
+                    count = (s64)std::ceil((exitTime - tMax[axis]) / tDelta[axis]);
+                    count = std::max<s64>(0, std::min<s64>(count, steps[axis] - 1));
+                }
+
+                current[axis] += step[axis] * count;
+                tMax[axis] += tDelta[axis] * count;
+            }
+
+            t = exitTime;
+            continue;
+        }
+
+        Vector3i local(current.x - chunkX * 16, current.y - chunkY * 16, current.z - chunkZ * 16);
+        block::BlockPtr block = chunk->GetBlock(local);
+
+        if (block && block->GetType() != 0 && (!filter || filter(block, current))) {
+            double closest = Infinity;
+            AABB closestBounds;
+
+            for (const AABB& bounds : block->GetBoundingBoxes()) {
+                AABB worldBounds = bounds + current;
+                double length = 0.0;
+
+                if (worldBounds.Intersects(ray, &length)) {
+                    // Negative length means the origin is inside of the box
+                    length = std::max(length, 0.0);
+
+                    if (length < closest) {
+                        closest = length;
+                        closestBounds = worldBounds;
+                    }
+                }
+            }
+
+            if (closest <= maxDistance) {
+                result.hit = true;
+                result.position = current;
+                result.point = origin + direction * closest;
+                result.face = GetHitFace(closestBounds, result.point);
+                result.distance = closest;
+                result.block = block;
+                return result;
+            }
+        }
+
+        std::size_t axis = 0;
+        if (tMax[1] < tMax[axis]) axis = 1;
+        if (tMax[2] < tMax[axis]) axis = 2;
+
+        t = tMax[axis];
+        current[axis] += step[axis];
+        tMax[axis] += tDelta[axis];
+    }
+
+    return result;
+}
+
 block::BlockEntityPtr World::GetBlockEntity(Vector3i pos) const {
     ChunkColumnPtr col = GetChunk(pos);
 
@@ -0,0 +1,179 @@
+#include "catch.hpp"
+
+#include <mclib/block/Block.h>
+#include <mclib/world/Chunk.h>
+#include <mclib/world/ChunkInterner.h>
+
+#include <memory>
+
+namespace {
+
+mc::block::BlockPtr GetStone() {
+    static bool registered = false;
+
+    if (!registered) {
+        mc::block::BlockRegistry::GetInstance()->RegisterVanillaBlocks(mc::protocol::Version::Minecraft_1_12_2);
+        registered = true;
+    }
+
+    return mc::block::BlockRegistry::GetInstance()->GetBlock(1, 0);
+}
+
+// Stone floor at y = 0 with a pillar in the middle.
+mc::world::ChunkPtr CreateChunk() {
+    auto chunk = std::make_shared<mc::world::Chunk>();
+
+    for (s32 x = 0; x < 16; ++x) {
+        for (s32 z = 0; z < 16; ++z)
+            chunk->SetBlock(mc::Vector3i(x, 0, z), GetStone());
+    }
+
+    for (s32 y = 1; y < 16; ++y)
+        chunk->SetBlock(mc::Vector3i(8, y, 8), GetStone());
+
+    return chunk;
+}
+
+mc::world::ChunkColumnMetadata CreateMetadata() {
+    mc::world::ChunkColumnMetadata meta;
+
+    meta.x = 0;
+    meta.z = 0;
+    meta.sectionmask = 1;
+    meta.continuous = true;
+    meta.skylight = true;
+
+    return meta;
+}
+
+} // ns
+
+TEST_CASE("Chunk compresses and inflates its blocks", "[Chunk]") {
+    mc::world::ChunkPtr chunk = CreateChunk();
+    mc::world::Chunk original(*chunk);
+
+    chunk->Compress();
+
+    REQUIRE(chunk->IsCompressed());
+    REQUIRE(chunk->GetCompressionSavings() > 0);
+    REQUIRE_FALSE(chunk->IsEmpty());
+
+    SECTION("reading a block inflates the chunk") {
+        REQUIRE(chunk->GetBlock(mc::Vector3i(8, 5, 8)) == GetStone());
+        REQUIRE(chunk->GetBlock(mc::Vector3i(1, 5, 1))->GetType() == 0);
+        REQUIRE_FALSE(chunk->IsCompressed());
+        REQUIRE(chunk->ConsumeInflated());
+        REQUIRE(*chunk == original);
+    }
+
+    SECTION("writing a block inflates the chunk") {
+        chunk->SetBlock(mc::Vector3i(8, 5, 8), mc::block::BlockRegistry::GetInstance()->GetBlock(0));
+
+        REQUIRE_FALSE(chunk->IsCompressed());
+        REQUIRE(chunk->GetBlock(mc::Vector3i(8, 5, 8))->GetType() == 0);
+        REQUIRE(chunk->GetBlock(mc::Vector3i(8, 6, 8)) == GetStone());
+    }
+
+    SECTION("empty chunks stay empty while compressed") {
+        mc::world::Chunk empty;
+
+        empty.Compress();
+
+        REQUIRE(empty.IsEmpty());
+    }
+}
+
+TEST_CASE("ChunkInterner shares equal chunks", "[Chunk]") {
+    mc::world::ChunkInterner interner;
+
+    mc::world::ChunkPtr first = interner.Intern(CreateChunk());
+    mc::world::ChunkPtr second = interner.Intern(CreateChunk());
+
+    REQUIRE(first == second);
+    REQUIRE(first->IsInterned());
+    REQUIRE(interner.GetHits() == 1);
+    REQUIRE(interner.GetMisses() == 1);
+
+    SECTION("different chunks aren't shared") {
+        mc::world::ChunkPtr other = std::make_shared<mc::world::Chunk>();
+        other->SetBlock(mc::Vector3i(0, 0, 0), GetStone());
+
+        REQUIRE(interner.Intern(other) != first);
+        REQUIRE(interner.GetSize() == 2);
+    }
+
+    SECTION("unused chunks are released") {
+        first.reset();
+        second.reset();
+
+        REQUIRE(interner.GetSize() == 0);
+    }
+}
+
+TEST_CASE("ChunkColumn copies interned chunks before writing", "[Chunk]") {
+    mc::world::ChunkInterner interner;
+    mc::world::ChunkColumn first(CreateMetadata());
+    mc::world::ChunkColumn second(CreateMetadata());
+
+    first.SetBlock(mc::Vector3i(8, 1, 8), GetStone());
+    second.SetBlock(mc::Vector3i(8, 1, 8), GetStone());
+    first.Intern(interner);
+    second.Intern(interner);
+
+    REQUIRE(first[0] == second[0]);
+
+    second.SetBlock(mc::Vector3i(8, 2, 8), GetStone());
+
+    REQUIRE(first[0] != second[0]);
+    REQUIRE(first.GetBlock(mc::Vector3i(8, 2, 8))->GetType() == 0);
+    REQUIRE(second.GetBlock(mc::Vector3i(8, 2, 8)) == GetStone());
+}
+
+TEST_CASE("ChunkInterner doesn't share compressed chunks", "[Chunk]") {
+    mc::world::ChunkInterner interner;
+    mc::world::ChunkPtr first = interner.Intern(CreateChunk());
+
+    SECTION("compressed chunks are inflated before they are shared") {
+        mc::world::ChunkPtr compressed = CreateChunk();
+        compressed->Compress();
+
+        REQUIRE(interner.Intern(compressed) == first);
+        REQUIRE_FALSE(first->IsCompressed());
+    }
+
+    SECTION("interned chunks aren't compressed") {
+        first->Compress();
+
+        REQUIRE_FALSE(first->IsCompressed());
+    }
+
+    SECTION("idle chunks that are still shared aren't compressed") {
+        mc::world::ChunkColumn column(CreateMetadata());
+        column.SetBlock(mc::Vector3i(8, 1, 8), GetStone());
+        column.Intern(interner);
+
+        mc::world::ChunkColumn copy(column);
+        u64 compressions = 0;
+        u64 inflations = 0;
+
+        column.CompressIdleChunks(compressions, inflations);
+        column.CompressIdleChunks(compressions, inflations);
+
+        REQUIRE(compressions == 0);
+        REQUIRE_FALSE(column[0]->IsCompressed());
+    }
+}
+
+TEST_CASE("ChunkColumn compresses all of its chunks", "[Chunk]") {
+    mc::world::ChunkColumn column(CreateMetadata());
+
+    column.SetBlock(mc::Vector3i(8, 1, 8), GetStone());
+    column.Compress();
+
+    REQUIRE(column.IsCompressed());
+
+    SECTION("compressed columns are restored on access") {
+        REQUIRE(column.GetBlock(mc::Vector3i(8, 1, 8)) == GetStone());
+        REQUIRE_FALSE(column.IsCompressed());
+    }
+}
@@ -0,0 +1,227 @@
+#include "catch.hpp"
+
+#include <mclib/core/Connection.h>
+#include <mclib/inventory/Inventory.h>
+#include <mclib/protocol/packets/PacketDispatcher.h>
+
+namespace {
+
+const s32 StoneId = 1;
+
+class InventoryFixture {
+public:
+    mc::protocol::packets::PacketDispatcher dispatcher;
+    // Never connected, so clicks aren't sent anywhere.
+    mc::core::Connection connection;
+    mc::inventory::InventoryManager manager;
+
+    InventoryFixture()
+        : connection(&dispatcher, mc::protocol::Version::Minecraft_1_12_2),
+          manager(&dispatcher, &connection)
+    {
+    }
+
+    void SetSlot(s8 windowId, s16 index, const mc::inventory::Slot& slot) {
+        mc::DataBuffer buffer;
+        // 1.12.2 slot data without NBT
+        buffer << windowId << index << (s16)slot.GetItemId();
+        if (slot.GetItemId() != -1)
+            buffer << slot.GetItemCount() << slot.GetItemDamage() << (u8)0;
+
+        mc::protocol::packets::in::SetSlotPacket packet;
+        packet.SetProtocolVersion(mc::protocol::Version::Minecraft_1_12_2);
+        packet.Deserialize(buffer, buffer.GetSize());
+        manager.HandlePacket(&packet);
+    }
+
+    void Confirm(u8 windowId, s16 action, bool accepted) {
+        mc::DataBuffer buffer;
+        buffer << windowId << action << accepted;
+
+        mc::protocol::packets::in::ConfirmTransactionPacket packet;
+        packet.Deserialize(buffer, buffer.GetSize());
+        manager.HandlePacket(&packet);
+    }
+};
+
+} // ns
+
+TEST_CASE("Inventory predicts clicks", "[Inventory]") {
+    InventoryFixture fixture;
+
+    fixture.SetSlot(0, 36, mc::inventory::Slot(StoneId, 10, 0));
+
+    mc::inventory::Inventory* inventory = fixture.manager.GetPlayerInventory();
+    REQUIRE(inventory != nullptr);
+
+    SECTION("picking up and placing moves the stack") {
+        REQUIRE(inventory->PickUp(fixture.connection, 36));
+        REQUIRE(inventory->GetItem(36).GetItemId() == -1);
+        REQUIRE(inventory->GetCursorItem().GetItemCount() == 10);
+
+        REQUIRE(inventory->Place(fixture.connection, 37));
+        REQUIRE(inventory->GetItem(37).GetItemCount() == 10);
+        REQUIRE(inventory->GetCursorItem().GetItemId() == -1);
+        REQUIRE(inventory->FindItemById(StoneId) == 37);
+        REQUIRE(inventory->HasPendingClicks());
+    }
+
+    SECTION("placing onto the same item merges up to its max stack size") {
+        mc::inventory::Inventory::SetMaxStackSize(StoneId, 64);
+        fixture.SetSlot(0, 37, mc::inventory::Slot(StoneId, 60, 0));
+
+        REQUIRE(inventory->PickUp(fixture.connection, 36));
+        REQUIRE(inventory->Place(fixture.connection, 37));
+
+        REQUIRE(inventory->GetItem(37).GetItemCount() == 64);
+        REQUIRE(inventory->GetCursorItem().GetItemCount() == 6);
+        REQUIRE(inventory->GetItemCount(StoneId) == 64);
+
+        mc::inventory::Inventory::SetMaxStackSize(StoneId, 0);
+    }
+
+    SECTION("merges aren't predicted for items without a known max stack size") {
+        const s32 EnderPearlId = 368;
+
+        fixture.SetSlot(0, 38, mc::inventory::Slot(EnderPearlId, 10, 0));
+        fixture.SetSlot(0, 39, mc::inventory::Slot(EnderPearlId, 10, 0));
+
+        REQUIRE(inventory->PickUp(fixture.connection, 38));
+        REQUIRE(inventory->Place(fixture.connection, 39));
+
+        REQUIRE(inventory->GetItem(39).GetItemCount() == 10);
+        REQUIRE(inventory->GetCursorItem().GetItemCount() == 10);
+
+        mc::inventory::Inventory::SetMaxStackSize(EnderPearlId, 16);
+
+        REQUIRE(inventory->Place(fixture.connection, 39));
+        REQUIRE(inventory->GetItem(39).GetItemCount() == 16);
+        REQUIRE(inventory->GetCursorItem().GetItemCount() == 4);
+
+        mc::inventory::Inventory::SetMaxStackSize(EnderPearlId, 0);
+    }
+
+    SECTION("clicks outside of the window are refused") {
+        REQUIRE_FALSE(inventory->Click(fixture.connection, -1));
+        REQUIRE_FALSE(inventory->Click(fixture.connection, 46));
+        REQUIRE_FALSE(inventory->HasPendingClicks());
+    }
+}
+
+TEST_CASE("Inventory rolls back rejected clicks", "[Inventory]") {
+    InventoryFixture fixture;
+
+    fixture.SetSlot(0, 36, mc::inventory::Slot(StoneId, 10, 0));
+    fixture.SetSlot(0, 38, mc::inventory::Slot(StoneId, 5, 0));
+
+    mc::inventory::Inventory* inventory = fixture.manager.GetPlayerInventory();
+
+    // Actions are numbered from 1.
+    REQUIRE(fixture.manager.Click(0, { 36, 37, 38 }) == 3);
+    REQUIRE(inventory->GetItem(37).GetItemCount() == 10);
+    REQUIRE(inventory->GetItem(38).GetItemId() == -1);
+    REQUIRE(inventory->GetCursorItem().GetItemCount() == 5);
+
+    SECTION("a rejected click undoes the clicks that were sent after it") {
+        fixture.Confirm(0, 2, false);
+
+        REQUIRE(inventory->GetItem(36).GetItemId() == -1);
+        REQUIRE(inventory->GetItem(37).GetItemId() == -1);
+        REQUIRE(inventory->GetItem(38).GetItemCount() == 5);
+        REQUIRE(inventory->GetCursorItem().GetItemCount() == 10);
+        REQUIRE(inventory->GetItemCount(StoneId) == 5);
+        REQUIRE(inventory->HasPendingClicks());
+
+        fixture.Confirm(0, 1, true);
+        REQUIRE_FALSE(inventory->HasPendingClicks());
+    }
+
+    SECTION("rejecting the first click restores the original slots") {
+        fixture.Confirm(0, 1, false);
+
+        REQUIRE(inventory->GetItem(36).GetItemCount() == 10);
+        REQUIRE(inventory->GetItem(37).GetItemId() == -1);
+        REQUIRE(inventory->GetItem(38).GetItemCount() == 5);
+        REQUIRE(inventory->GetCursorItem().GetItemId() == -1);
+        REQUIRE(inventory->FindItemsById(StoneId) == std::vector<s32>({ 36, 38 }));
+        REQUIRE_FALSE(inventory->HasPendingClicks());
+    }
+
+    SECTION("confirming the last click confirms the earlier ones") {
+        fixture.Confirm(0, 3, true);
+
+        REQUIRE_FALSE(inventory->HasPendingClicks());
+        REQUIRE(inventory->GetItem(37).GetItemCount() == 10);
+    }
+}
+
+TEST_CASE("Inventory confirms clicks on every slot of the player's window", "[Inventory]") {
+    InventoryFixture fixture;
+
+    // Armor, main inventory and hotbar
+    fixture.SetSlot(0, 5, mc::inventory::Slot(StoneId, 1, 0));
+    fixture.SetSlot(0, 9, mc::inventory::Slot(StoneId, 10, 0));
+    fixture.SetSlot(0, 36, mc::inventory::Slot(StoneId, 5, 0));
+
+    mc::inventory::Inventory* inventory = fixture.manager.GetPlayerInventory();
+
+    REQUIRE(fixture.manager.Click(0, { 9, 10, 5 }) == 3);
+    REQUIRE(inventory->GetItem(10).GetItemCount() == 10);
+    REQUIRE(inventory->GetCursorItem().GetItemCount() == 1);
+
+    SECTION("window 0 confirms the clicks") {
+        fixture.Confirm(0, 3, true);
+
+        REQUIRE_FALSE(inventory->HasPendingClicks());
+        REQUIRE(inventory->GetItem(5).GetItemId() == -1);
+    }
+
+    SECTION("window 0 rolls back the clicks") {
+        fixture.Confirm(0, 1, false);
+
+        REQUIRE_FALSE(inventory->HasPendingClicks());
+        REQUIRE(inventory->GetItem(5).GetItemCount() == 1);
+        REQUIRE(inventory->GetItem(9).GetItemCount() == 10);
+        REQUIRE(inventory->GetItem(10).GetItemId() == -1);
+        REQUIRE(inventory->GetCursorItem().GetItemId() == -1);
+    }
+}
+
+TEST_CASE("InventoryManager shares the cursor between windows", "[Inventory]") {
+    InventoryFixture fixture;
+
+    fixture.SetSlot(-1, -1, mc::inventory::Slot(StoneId, 3, 0));
+
+    REQUIRE(fixture.manager.GetInventory(-1) == nullptr);
+    REQUIRE(fixture.manager.GetCursorItem().GetItemCount() == 3);
+
+    fixture.SetSlot(0, 36, mc::inventory::Slot(StoneId, 1, 0));
+    mc::inventory::Inventory* player = fixture.manager.GetPlayerInventory();
+
+    REQUIRE(player->GetCursorItem().GetItemCount() == 3);
+
+    SECTION("clicks in another window move the cursor of every window") {
+        fixture.SetSlot(1, 0, mc::inventory::Slot());
+        mc::inventory::Inventory* chest = fixture.manager.GetInventory(1);
+
+        REQUIRE(chest->Place(fixture.connection, 0));
+        REQUIRE(chest->GetItem(0).GetItemCount() == 3);
+        REQUIRE(player->GetCursorItem().GetItemId() == -1);
+
+        fixture.Confirm(1, 1, false);
+        REQUIRE(player->GetCursorItem().GetItemCount() == 3);
+    }
+
+    SECTION("windows opened later share the cursor") {
+        fixture.SetSlot(1, 0, mc::inventory::Slot());
+
+        REQUIRE(fixture.manager.GetInventory(1)->GetCursorItem().GetItemCount() == 3);
+    }
+
+    SECTION("window -2 sets slots of the player's inventory") {
+        fixture.SetSlot(-2, 37, mc::inventory::Slot(StoneId, 7, 0));
+
+        REQUIRE(fixture.manager.GetInventory(-2) == nullptr);
+        REQUIRE(player->GetItem(37).GetItemCount() == 7);
+    }
+}
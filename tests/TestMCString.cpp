@@ -0,0 +1,98 @@
+#include "catch.hpp"
+
+#include <mclib/common/MCString.h>
+#include <mclib/common/DataBuffer.h>
+#include <mclib/common/VarInt.h>
+
+#include <string>
+
+TEST_CASE("MCString round trips text in the basic multilingual plane", "[MCString]") {
+    const std::string Text = u8"abc éß 世界";
+
+    mc::MCString str(Text);
+
+    REQUIRE(str.GetUTF8() == Text);
+    REQUIRE(mc::utf16to8(str.GetUTF16()) == Text);
+    REQUIRE(mc::MCString(str.GetUTF16()).GetUTF8() == Text);
+}
+
+TEST_CASE("MCString round trips characters outside of the basic multilingual plane", "[MCString]") {
+    // U+1F600, four bytes in UTF-8 and a surrogate pair in UTF-16
+    const std::string Text = "a\xF0\x9F\x98\x80z";
+
+    std::wstring wide = mc::utf8to16(Text);
+
+    if (sizeof(wchar_t) == 2) {
+        REQUIRE(wide.size() == 4);
+        REQUIRE(wide[1] == (wchar_t)0xD83D);
+        REQUIRE(wide[2] == (wchar_t)0xDE00);
+    } else {
+        REQUIRE(wide.size() == 3);
+        REQUIRE((u32)wide[1] == 0x1F600);
+    }
+
+    REQUIRE(mc::utf16to8(wide) == Text);
+}
+
+TEST_CASE("MCString replaces invalid UTF-8", "[MCString]") {
+    const std::string Replacement = "\xEF\xBF\xBD";
+
+    SECTION("stray continuation bytes") {
+        REQUIRE_FALSE(mc::IsValidUTF8("a\x80z", 3));
+        REQUIRE(mc::MCString(std::string("a\x80z")).GetUTF8() == "a" + Replacement + "z");
+    }
+
+    SECTION("truncated sequences") {
+        std::string truncated = "ab\xE4\xB8";
+
+        REQUIRE_FALSE(mc::IsValidUTF8(truncated.data(), truncated.size()));
+        REQUIRE(mc::SanitizeUTF8(truncated) == "ab" + Replacement + Replacement);
+    }
+
+    SECTION("overlong encodings") {
+        std::string overlong = "\xC0\xAF";
+
+        REQUIRE_FALSE(mc::IsValidUTF8(overlong.data(), overlong.size()));
+        REQUIRE(mc::SanitizeUTF8(overlong) == Replacement + Replacement);
+    }
+
+    SECTION("encoded surrogates") {
+        std::string surrogate = "\xED\xA0\x80";
+
+        REQUIRE_FALSE(mc::IsValidUTF8(surrogate.data(), surrogate.size()));
+        REQUIRE(mc::SanitizeUTF8(surrogate) == Replacement + Replacement + Replacement);
+    }
+
+    SECTION("unpaired UTF-16 surrogates") {
+        std::wstring unpaired;
+        unpaired.push_back((wchar_t)0xD800);
+        unpaired.push_back(L'a');
+
+        REQUIRE(mc::utf16to8(unpaired) == Replacement + "a");
+    }
+}
+
+TEST_CASE("MCString serializes and deserializes", "[MCString]") {
+    mc::DataBuffer buffer;
+
+    SECTION("valid strings are read back unchanged") {
+        mc::MCString str(std::string(u8"hello 世界"));
+        buffer << str;
+
+        mc::MCString result;
+        buffer >> result;
+
+        REQUIRE(result.GetUTF8() == str.GetUTF8());
+        REQUIRE(buffer.IsFinished());
+    }
+
+    SECTION("invalid strings are sanitized when read") {
+        std::string invalid = "a\xFFz";
+        buffer << mc::VarInt((s32)invalid.size()) << invalid;
+
+        mc::MCString result;
+        buffer >> result;
+
+        REQUIRE(result.GetUTF8() == "a\xEF\xBF\xBDz");
+    }
+}
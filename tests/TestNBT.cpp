@@ -0,0 +1,155 @@
+#include "catch.hpp"
+
+#include <mclib/common/DataBuffer.h>
+#include <mclib/nbt/NBTReader.h>
+#include <mclib/nbt/NBTView.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+void WriteName(std::string& out, mc::nbt::TagType type, const std::string& name) {
+    out.push_back((char)type);
+    out.push_back((char)(name.size() >> 8));
+    out.push_back((char)(name.size() & 0xFF));
+    out += name;
+}
+
+void WriteInt(std::string& out, s32 value) {
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back((char)((value >> shift) & 0xFF));
+}
+
+// { "root": { "b": 5b, "i": 1234, "list": [1, 2, 3], "s": "text" } }
+std::string CreateNBT() {
+    using mc::nbt::TagType;
+
+    std::string data;
+
+    WriteName(data, TagType::Compound, "root");
+
+    WriteName(data, TagType::Int, "i");
+    WriteInt(data, 1234);
+
+    WriteName(data, TagType::String, "s");
+    data.push_back(0);
+    data.push_back(4);
+    data += "text";
+
+    WriteName(data, TagType::List, "list");
+    data.push_back((char)TagType::Int);
+    WriteInt(data, 3);
+    WriteInt(data, 1);
+    WriteInt(data, 2);
+    WriteInt(data, 3);
+
+    WriteName(data, TagType::Byte, "b");
+    data.push_back(5);
+
+    data.push_back((char)TagType::End);
+    return data;
+}
+
+class CountingVisitor : public mc::nbt::NBTVisitor {
+public:
+    int ints = 0;
+
+    void OnInt(const std::string& /*name*/, s32 /*value*/) override { ++ints; }
+};
+
+} // ns
+
+TEST_CASE("NBTReader visits every tag and checks its bounds", "[NBT]") {
+    std::string data = CreateNBT();
+
+    SECTION("complete data") {
+        CountingVisitor visitor;
+        mc::nbt::NBTReader reader((const u8*)data.data(), data.size());
+
+        REQUIRE(reader.Read(visitor));
+        REQUIRE(visitor.ints == 4);
+        REQUIRE(reader.GetOffset() == data.size());
+    }
+
+    SECTION("truncated data") {
+        for (std::size_t size = 1; size < data.size(); ++size) {
+            CountingVisitor visitor;
+            mc::nbt::NBTReader reader((const u8*)data.data(), size);
+
+            REQUIRE_THROWS_AS(reader.Read(visitor), std::runtime_error);
+        }
+    }
+
+    SECTION("skipping truncated data") {
+        mc::nbt::NBTReader reader((const u8*)data.data(), data.size() - 1);
+
+        REQUIRE_THROWS_AS(reader.Skip(), std::runtime_error);
+    }
+}
+
+TEST_CASE("NBTView reads the values of a compound", "[NBT]") {
+    mc::nbt::NBTView root = mc::nbt::NBTView::Parse(CreateNBT());
+
+    REQUIRE(root.IsValid());
+    REQUIRE(root.GetName() == "root");
+    REQUIRE(root.GetSize() == 4);
+    REQUIRE(root["i"].GetInt() == 1234);
+    REQUIRE(root["s"].GetString() == "text");
+    REQUIRE(root["b"].GetByte() == 5);
+
+    mc::nbt::NBTView list = root["list"];
+
+    REQUIRE(list.GetElementType() == mc::nbt::TagType::Int);
+    REQUIRE(list.GetSize() == 3);
+    REQUIRE(list[2].GetInt() == 3);
+}
+
+TEST_CASE("NBTView returns invalid views outside of its bounds", "[NBT]") {
+    mc::nbt::NBTView root = mc::nbt::NBTView::Parse(CreateNBT());
+
+    REQUIRE_FALSE(root["missing"].IsValid());
+    REQUIRE_FALSE(root[4].IsValid());
+    REQUIRE_FALSE(root["list"][3].IsValid());
+    // Values of the wrong type read as 0
+    REQUIRE(root["s"].GetInt() == 0);
+    REQUIRE(root["i"].GetSize() == 0);
+}
+
+TEST_CASE("NBTView rejects NBT that ends early", "[NBT]") {
+    std::string data = CreateNBT();
+
+    for (std::size_t size = 1; size < data.size(); ++size)
+        REQUIRE_THROWS_AS(mc::nbt::NBTView::Parse(data.substr(0, size)), std::runtime_error);
+}
+
+TEST_CASE("NBTView rejects lengths that point past the end", "[NBT]") {
+    std::string data;
+
+    WriteName(data, mc::nbt::TagType::Compound, "");
+    WriteName(data, mc::nbt::TagType::ByteArray, "a");
+    WriteInt(data, 0x7FFFFFFF);
+    data.push_back((char)mc::nbt::TagType::End);
+
+    REQUIRE_THROWS_AS(mc::nbt::NBTView::Parse(data), std::runtime_error);
+}
+
+TEST_CASE("NBTView reads from a DataBuffer", "[NBT]") {
+    std::string data = CreateNBT();
+    mc::DataBuffer buffer;
+
+    buffer << data << (u8)0x42;
+
+    mc::nbt::NBTView root = mc::nbt::NBTView::Read(buffer);
+
+    REQUIRE(root["i"].GetInt() == 1234);
+    REQUIRE(buffer.GetReadOffset() == data.size());
+
+    SECTION("an end tag is no NBT") {
+        mc::DataBuffer empty;
+        empty << (u8)0;
+
+        REQUIRE_FALSE(mc::nbt::NBTView::Read(empty).IsValid());
+        REQUIRE(empty.IsFinished());
+    }
+}
@@ -0,0 +1,73 @@
+#include "catch.hpp"
+
+#include <mclib/util/TickScheduler.h>
+
+TEST_CASE("TickScheduler ticks on the boundaries of its phase", "[TickScheduler]") {
+    mc::util::TickScheduler scheduler(50);
+
+    scheduler.SetPhase(20);
+
+    // The first tick is on the next boundary at or after the first poll.
+    REQUIRE(scheduler.Poll(1001) == 0);
+    REQUIRE(scheduler.GetNextTick() == 1020);
+    REQUIRE(scheduler.GetTimeUntilNextTick(1001) == 19);
+
+    REQUIRE(scheduler.Poll(1019) == 0);
+    REQUIRE(scheduler.Poll(1020) == 1);
+    REQUIRE(scheduler.Poll(1021) == 0);
+    REQUIRE(scheduler.GetNextTick() == 1070);
+
+    // Late polls don't move the boundaries.
+    REQUIRE(scheduler.Poll(1085) == 1);
+    REQUIRE(scheduler.GetNextTick() == 1120);
+    REQUIRE(scheduler.GetTickCount() == 2);
+}
+
+TEST_CASE("TickScheduler wraps phases into the interval", "[TickScheduler]") {
+    mc::util::TickScheduler scheduler(50);
+
+    scheduler.SetPhase(130);
+    REQUIRE(scheduler.GetPhase() == 30);
+
+    scheduler.SetPhase(-10);
+    REQUIRE(scheduler.GetPhase() == 40);
+
+    REQUIRE(scheduler.Poll(0) == 0);
+    REQUIRE(scheduler.GetNextTick() == 40);
+}
+
+TEST_CASE("TickScheduler handles missed ticks by its policy", "[TickScheduler]") {
+    mc::util::TickScheduler scheduler(50);
+
+    REQUIRE(scheduler.Poll(0) == 1);
+
+    SECTION("skip runs a single tick") {
+        REQUIRE(scheduler.Poll(260) == 1);
+        REQUIRE(scheduler.GetSkippedTicks() == 4);
+        REQUIRE(scheduler.GetNextTick() == 300);
+    }
+
+    SECTION("catch up runs the missed ticks up to the limit") {
+        scheduler.SetPolicy(mc::util::TickPolicy::CatchUp, 3);
+
+        REQUIRE(scheduler.Poll(160) == 3);
+        REQUIRE(scheduler.GetSkippedTicks() == 0);
+
+        REQUIRE(scheduler.Poll(460) == 3);
+        REQUIRE(scheduler.GetSkippedTicks() == 3);
+        REQUIRE(scheduler.GetNextTick() == 500);
+    }
+}
+
+TEST_CASE("TickScheduler restarts the schedule", "[TickScheduler]") {
+    mc::util::TickScheduler scheduler(50);
+
+    REQUIRE(scheduler.Poll(0) == 1);
+    REQUIRE(scheduler.GetTimeUntilNextTick(10) == 40);
+
+    scheduler.Reset();
+
+    REQUIRE(scheduler.GetTimeUntilNextTick(10) == 0);
+    REQUIRE(scheduler.Poll(1010) == 0);
+    REQUIRE(scheduler.GetNextTick() == 1050);
+}